@@ -0,0 +1,636 @@
+/*
+ * File:	IR.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the intermediate representation: instructions, basic
+ *		blocks, flow graphs, and the builder used during lowering.
+ *
+ *		The write functions produce the listing for -emit-ir.  The
+ *		syntax is loosely modeled on other three-address listings:
+ *		each virtual register is written as %n, each variable by
+ *		its name, and each block by its label.
+ */
+
+# include <set>
+# include <cassert>
+# include <algorithm>
+# include "IR.h"
+
+using namespace std;
+
+static const char *names[] = {
+    "const", "fconst", "string", "addr", "gaddr", "load", "store",
+    "loadvar", "storevar", "copy", "add", "sub", "mul", "div", "rem",
+    "neg", "not", "lt", "gt", "le", "ge", "eq", "ne", "itod", "dtoi",
+    "trunc", "select", "vload", "vstore", "vsplat", "vadd", "vsub", "vmul", "vdiv",
+    "call", "phi", "jump", "branch", "switch", "ret"
+};
+
+
+/*
+ * Function:	reg (private)
+ *
+ * Description:	Write a virtual register to a stream.
+ */
+
+static void reg(ostream &ostr, int n)
+{
+    ostr << "%" << n;
+}
+
+
+/*
+ * Function:	Instruction::Instruction (constructor)
+ *
+ * Description:	Initialize an instruction with no operands.
+ */
+
+Instruction::Instruction(Opcode opcode, int dst)
+    : _opcode(opcode), _dst(dst), _var(-1), _symbol(nullptr), _value(0),
+      _size(0)
+{
+    _targets[0] = _targets[1] = nullptr;
+}
+
+
+/*
+ * Function:	Instruction::isTerminator
+ *
+ * Description:	Return whether this instruction ends a basic block.
+ */
+
+bool Instruction::isTerminator() const
+{
+    return _opcode == JUMP || _opcode == BRANCH || _opcode == SWITCH ||
+	_opcode == RET;
+}
+
+
+/*
+ * Function:	Instruction::isCompare
+ *
+ * Description:	Return whether this instruction is a relational or
+ *		equality operator.
+ */
+
+bool Instruction::isCompare() const
+{
+    return _opcode >= LT && _opcode <= NE;
+}
+
+
+/*
+ * Function:	Instruction::isVector
+ *
+ * Description:	Return whether this instruction operates on vectors.
+ */
+
+bool Instruction::isVector() const
+{
+    return _opcode >= VLOAD && _opcode <= VDIV;
+}
+
+
+/*
+ * Function:	Instruction::hasSideEffects
+ *
+ * Description:	Return whether this instruction does anything other than
+ *		compute its result.  Such instructions may never be
+ *		deleted, even if their result is unused.
+ */
+
+bool Instruction::hasSideEffects() const
+{
+    return _opcode == STORE || _opcode == STOREVAR || _opcode == VSTORE ||
+	_opcode == CALL || isTerminator();
+}
+
+
+/*
+ * Function:	Instruction::write
+ *
+ * Description:	Write this instruction to the specified stream.
+ */
+
+void Instruction::write(ostream &ostr) const
+{
+    ostr << "\t";
+
+    if (_dst >= 0) {
+	reg(ostr, _dst);
+	ostr << " = ";
+    }
+
+    ostr << names[_opcode];
+
+    if (_opcode == LOAD || _opcode == STORE || isVector())
+	ostr << _size;
+
+    if (_opcode == CONST || _opcode == SWITCH)
+	ostr << " " << _value;
+    else if (_opcode == FCONST || _opcode == STRING)
+	ostr << " " << _text;
+    else if (_symbol != nullptr)
+	ostr << " " << _symbol->name();
+    else if (_var >= 0)
+	ostr << " $" << _var;
+
+    for (unsigned i = 0; i < _args.size(); i ++) {
+	ostr << (i > 0 || _symbol != nullptr || _var >= 0 || _opcode == SWITCH ? ", " : " ");
+
+	if (_opcode == PHI) {
+	    ostr << "[";
+	    reg(ostr, _args[i]);
+	    ostr << ", " << _sources[i] << "]";
+	} else
+	    reg(ostr, _args[i]);
+    }
+
+    for (unsigned i = 0; i < 2; i ++)
+	if (_targets[i] != nullptr)
+	    ostr << (i > 0 || !_args.empty() ? ", " : " ") << _targets[i];
+
+    for (unsigned i = 0; i < _table.size(); i ++)
+	ostr << (i > 0 ? ", " : " [") << _table[i];
+
+    ostr << (_table.empty() ? "" : "]") << endl;
+}
+
+
+/*
+ * Function:	BasicBlock::BasicBlock (constructor)
+ *
+ * Description:	Initialize an empty basic block.
+ */
+
+BasicBlock::BasicBlock()
+    : _idom(nullptr), _number(-1), _index(-1), _align(false)
+{
+}
+
+
+/*
+ * Function:	BasicBlock::terminator
+ *
+ * Description:	Return the terminator of this block, or a null pointer if
+ *		the block has not yet been terminated.
+ */
+
+Instruction *BasicBlock::terminator() const
+{
+    if (_insns.empty() || !_insns.back()->isTerminator())
+	return nullptr;
+
+    return _insns.back();
+}
+
+
+/*
+ * Function:	BasicBlock::write
+ *
+ * Description:	Write this block to the specified stream, along with its
+ *		predecessors for readability.
+ */
+
+void BasicBlock::write(ostream &ostr) const
+{
+    ostr << this << ":";
+
+    if (!_preds.empty()) {
+	ostr << "\t\t\t# preds:";
+
+	for (unsigned i = 0; i < _preds.size(); i ++)
+	    ostr << " " << _preds[i];
+    }
+
+    ostr << endl;
+
+    for (unsigned i = 0; i < _insns.size(); i ++)
+	_insns[i]->write(ostr);
+}
+
+
+/*
+ * Function:	operator <<
+ *
+ * Description:	Write the label of a basic block to a stream.
+ */
+
+ostream &operator <<(ostream &ostr, const BasicBlock *block)
+{
+    return ostr << block->_label;
+}
+
+
+/*
+ * Function:	FlowGraph::FlowGraph (constructor)
+ *
+ * Description:	Initialize an empty flow graph for the given function.
+ */
+
+FlowGraph::FlowGraph(const Symbol *id)
+    : _id(id)
+{
+}
+
+
+/*
+ * Function:	FlowGraph::~FlowGraph (destructor)
+ *
+ * Description:	Delete the blocks of this flow graph and their
+ *		instructions.
+ */
+
+FlowGraph::~FlowGraph()
+{
+    for (unsigned i = 0; i < _blocks.size(); i ++) {
+	for (unsigned j = 0; j < _blocks[i]->_insns.size(); j ++)
+	    delete _blocks[i]->_insns[j];
+
+	delete _blocks[i];
+    }
+}
+
+
+/*
+ * Function:	FlowGraph::newRegister
+ *
+ * Description:	Create a new virtual register and return its number.
+ */
+
+int FlowGraph::newRegister(bool real)
+{
+    _reals.push_back(real);
+    return _reals.size() - 1;
+}
+
+
+/*
+ * Function:	FlowGraph::newVariable
+ *
+ * Description:	Create a new variable and return its index.  Variables
+ *		without a symbol are scratch variables introduced during
+ *		lowering.  Parameters keep the offsets assigned to them
+ *		during storage allocation.
+ */
+
+int FlowGraph::newVariable(const Symbol *symbol, bool real, unsigned size)
+{
+    Variable var;
+
+    var._symbol = symbol;
+    var._real = real;
+    var._size = size;
+    var._addressed = false;
+    var._param = symbol != nullptr && symbol->_offset > 0;
+    var._offset = var._param ? symbol->_offset : 0;
+
+    _vars.push_back(var);
+    return _vars.size() - 1;
+}
+
+
+/*
+ * Function:	FlowGraph::entry (accessor)
+ *
+ * Description:	Return the entry block of this flow graph.
+ */
+
+BasicBlock *FlowGraph::entry() const
+{
+    return _blocks.front();
+}
+
+
+/*
+ * Function:	FlowGraph::size
+ *
+ * Description:	Return the number of instructions in this flow graph.
+ */
+
+unsigned FlowGraph::size() const
+{
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < _blocks.size(); i ++)
+	count += _blocks[i]->_insns.size();
+
+    return count;
+}
+
+
+/*
+ * Function:	FlowGraph::connect
+ *
+ * Description:	Recompute the predecessors and successors of every block
+ *		from the targets of their terminators.  A block that
+ *		appears more than once in the table of a switch is still
+ *		only one successor.
+ */
+
+void FlowGraph::connect()
+{
+    for (unsigned i = 0; i < _blocks.size(); i ++) {
+	_blocks[i]->_preds.clear();
+	_blocks[i]->_succs.clear();
+    }
+
+    for (unsigned i = 0; i < _blocks.size(); i ++) {
+	Instruction *term = _blocks[i]->terminator();
+
+	assert(term != nullptr);
+
+	for (unsigned j = 0; j < 2; j ++)
+	    if (term->_targets[j] != nullptr) {
+		_blocks[i]->_succs.push_back(term->_targets[j]);
+		term->_targets[j]->_preds.push_back(_blocks[i]);
+	    }
+
+	for (unsigned j = 0; j < term->_table.size(); j ++) {
+	    BasicBlocks &succs = _blocks[i]->_succs;
+
+	    if (find(succs.begin(), succs.end(), term->_table[j]) == succs.end()) {
+		succs.push_back(term->_table[j]);
+		term->_table[j]->_preds.push_back(_blocks[i]);
+	    }
+	}
+    }
+}
+
+
+/*
+ * Function:	FlowGraph::prune
+ *
+ * Description:	Remove any blocks that are unreachable from the entry
+ *		block, such as the code following a return statement, and
+ *		then recompute the edges.  The order of the remaining
+ *		blocks is unchanged.
+ */
+
+void FlowGraph::prune()
+{
+    BasicBlocks work, kept;
+    set<BasicBlock *> seen;
+
+
+    connect();
+    work.push_back(entry());
+    seen.insert(entry());
+
+    while (!work.empty()) {
+	BasicBlock *block = work.back();
+	work.pop_back();
+
+	for (unsigned i = 0; i < block->_succs.size(); i ++)
+	    if (seen.count(block->_succs[i]) == 0) {
+		seen.insert(block->_succs[i]);
+		work.push_back(block->_succs[i]);
+	    }
+    }
+
+    for (unsigned i = 0; i < _blocks.size(); i ++)
+	if (seen.count(_blocks[i]) > 0)
+	    kept.push_back(_blocks[i]);
+	else {
+	    for (unsigned j = 0; j < _blocks[i]->_insns.size(); j ++)
+		delete _blocks[i]->_insns[j];
+
+	    delete _blocks[i];
+	}
+
+    _blocks = kept;
+    connect();
+}
+
+
+/*
+ * Function:	FlowGraph::write
+ *
+ * Description:	Write this flow graph to the specified stream, preceded by
+ *		a summary line and the list of variables.
+ */
+
+void FlowGraph::write(ostream &ostr) const
+{
+    ostr << "# " << _id->name() << ": " << _blocks.size() << " blocks, ";
+    ostr << size() << " instructions, " << _reals.size() << " registers";
+    ostr << endl;
+
+    for (unsigned i = 0; i < _vars.size(); i ++) {
+	ostr << "#\t$" << i << " = ";
+	ostr << (_vars[i]._symbol ? _vars[i]._symbol->name() : "(scratch)");
+	ostr << (_vars[i]._param ? ", param" : "");
+	ostr << (_vars[i]._addressed ? ", addressed" : "") << endl;
+    }
+
+    ostr << _id->name() << ":" << endl;
+
+    for (unsigned i = 0; i < _blocks.size(); i ++)
+	_blocks[i]->write(ostr);
+
+    ostr << endl;
+}
+
+
+/*
+ * Function:	Builder::Builder (constructor)
+ *
+ * Description:	Initialize a builder for the given flow graph, creating
+ *		and entering the entry block.
+ */
+
+Builder::Builder(FlowGraph *graph)
+    : _graph(graph), _block(nullptr)
+{
+    enter(create());
+}
+
+
+/*
+ * Function:	Builder::graph (accessor)
+ *
+ * Description:	Return the flow graph being built.
+ */
+
+FlowGraph *Builder::graph() const
+{
+    return _graph;
+}
+
+
+/*
+ * Function:	Builder::block (accessor)
+ *
+ * Description:	Return the block into which instructions are inserted.
+ */
+
+BasicBlock *Builder::block() const
+{
+    return _block;
+}
+
+
+/*
+ * Function:	Builder::create
+ *
+ * Description:	Create a new empty block.  The block is not entered.
+ */
+
+BasicBlock *Builder::create()
+{
+    BasicBlock *block = new BasicBlock();
+
+    _graph->_blocks.push_back(block);
+    return block;
+}
+
+
+/*
+ * Function:	Builder::enter
+ *
+ * Description:	Make the given block the insertion point.  If the current
+ *		block falls through, it is first terminated by a jump to
+ *		the new block.  We move the entered block to the end so
+ *		that blocks appear in the order in which they are filled.
+ */
+
+void Builder::enter(BasicBlock *block)
+{
+    BasicBlocks &blocks = _graph->_blocks;
+
+    if (_block != nullptr && _block->terminator() == nullptr)
+	jump(block);
+
+    blocks.erase(std::find(blocks.begin(), blocks.end(), block));
+    blocks.push_back(block);
+    _block = block;
+}
+
+
+/*
+ * Function:	Builder::emit
+ *
+ * Description:	Append an instruction to the current block.
+ */
+
+Instruction *Builder::emit(Instruction *insn)
+{
+    assert(_block->terminator() == nullptr);
+    _block->_insns.push_back(insn);
+    return insn;
+}
+
+
+/*
+ * Function:	Builder::variable
+ *
+ * Description:	Return the variable for the given local symbol, creating
+ *		it if necessary.
+ */
+
+int Builder::variable(const Symbol *symbol)
+{
+    if (_variables.count(symbol) == 0) {
+	const Type &type = symbol->type();
+	bool real = type.isScalar() && type.isReal();
+
+	_variables[symbol] = _graph->newVariable(symbol, real, type.size());
+    }
+
+    return _variables[symbol];
+}
+
+
+/*
+ * Function:	Builder::scratch
+ *
+ * Description:	Return a new scratch variable.
+ */
+
+int Builder::scratch(bool real)
+{
+    return _graph->newVariable(nullptr, real, real ? 8 : 4);
+}
+
+
+/*
+ * Function:	Builder::constant
+ *
+ * Description:	Emit an integer constant and return its register.
+ */
+
+int Builder::constant(long value)
+{
+    Instruction *insn;
+
+    insn = emit(new Instruction(Instruction::CONST, _graph->newRegister(false)));
+    insn->_value = value;
+    return insn->_dst;
+}
+
+
+/*
+ * Function:	Builder::unary
+ *
+ * Description:	Emit a unary operator and return its register.
+ */
+
+int Builder::unary(Instruction::Opcode opcode, int src, bool real)
+{
+    Instruction *insn;
+
+    insn = emit(new Instruction(opcode, _graph->newRegister(real)));
+    insn->_args.push_back(src);
+    return insn->_dst;
+}
+
+
+/*
+ * Function:	Builder::binary
+ *
+ * Description:	Emit a binary operator and return its register.  The
+ *		result of a comparison is always an integer.
+ */
+
+int Builder::binary(Instruction::Opcode opcode, int left, int right, bool real)
+{
+    Instruction *insn;
+
+    insn = new Instruction(opcode);
+    insn->_dst = _graph->newRegister(insn->isCompare() ? false : real);
+    insn->_args.push_back(left);
+    insn->_args.push_back(right);
+    return emit(insn)->_dst;
+}
+
+
+/*
+ * Function:	Builder::jump
+ *
+ * Description:	Terminate the current block with a jump.
+ */
+
+void Builder::jump(BasicBlock *target)
+{
+    Instruction *insn = new Instruction(Instruction::JUMP);
+
+    insn->_targets[0] = target;
+    emit(insn);
+}
+
+
+/*
+ * Function:	Builder::branch
+ *
+ * Description:	Terminate the current block with a conditional branch.
+ */
+
+void Builder::branch(int cond, BasicBlock *ifTrue, BasicBlock *ifFalse)
+{
+    Instruction *insn = new Instruction(Instruction::BRANCH);
+
+    insn->_args.push_back(cond);
+    insn->_targets[0] = ifTrue;
+    insn->_targets[1] = ifFalse;
+    emit(insn);
+}
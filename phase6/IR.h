@@ -0,0 +1,176 @@
+/*
+ * File:	IR.h
+ *
+ * Description:	This file contains the class definitions for the
+ *		intermediate representation used between the abstract
+ *		syntax tree and the instruction selector.
+ *
+ *		A function is lowered into a flow graph of basic blocks.
+ *		Each basic block is a linear sequence of three-address
+ *		instructions ending in exactly one terminator (a jump, a
+ *		conditional branch, a switch, or a return).  A switch
+ *		jumps through a table indexed by its operand less its
+ *		value, and to its first target if the index is out of
+ *		range.  Values live in an
+ *		unbounded set of virtual registers, each of which is
+ *		assigned exactly once.  A virtual register is either an
+ *		integer register (characters, integers, and pointers, with
+ *		characters always kept sign-extended) or a real register.
+ *
+ *		Local variables and parameters are kept separately as
+ *		variables, which are read and written with explicit
+ *		instructions.  A variable whose address is never taken is
+ *		a candidate for promotion into virtual registers.  Global
+ *		variables are always accessed through memory.
+ *
+ *		The vectorizer introduces a third kind of register, which
+ *		holds a 16-byte vector of integers or reals.  Vector
+ *		instructions give the size of an element, and their
+ *		registers are marked as real if the elements are.
+ *
+ *		Blocks are numbered once lowering is done.  The numbers
+ *		are stable, in that they depend only on the function, so
+ *		they identify blocks in an execution profile.  Blocks that
+ *		are created later have no number.
+ *
+ *		Once variables are promoted, a value that depends on the
+ *		path taken is merged with a phi instruction.  Each of its
+ *		operands is paired with the predecessor block it comes
+ *		from, so edges may be removed without losing track.  If
+ *		the paths are short enough, the phi may be replaced by a
+ *		select instruction, whose result is its second operand if
+ *		its first is nonzero and its third otherwise.
+ *
+ *		As with the tree, the classes here are just containers.
+ *		Lowering from the tree is in lowerer.cpp and instruction
+ *		selection is in selector.cpp.
+ */
+
+# ifndef IR_H
+# define IR_H
+# include <map>
+# include <string>
+# include <vector>
+# include <ostream>
+# include "Symbol.h"
+# include "Label.h"
+
+typedef std::vector<class BasicBlock *> BasicBlocks;
+typedef std::vector<class Instruction *> Instructions;
+
+
+/* A single three-address instruction */
+
+class Instruction {
+    typedef std::string string;
+
+public:
+    enum Opcode {
+	CONST, FCONST, STRING, ADDR, GADDR, LOAD, STORE, LOADVAR, STOREVAR,
+	COPY, ADD, SUB, MUL, DIV, REM, NEG, NOT, LT, GT, LE, GE, EQ, NE,
+	ITOD, DTOI, TRUNC, SELECT, VLOAD, VSTORE, VSPLAT, VADD, VSUB, VMUL, VDIV,
+	CALL, PHI, JUMP, BRANCH, SWITCH, RET
+    };
+
+    Opcode _opcode;
+    int _dst;
+    std::vector<int> _args;
+    int _var;
+    const Symbol *_symbol;
+    string _text;
+    long _value;
+    unsigned _size;
+    BasicBlock *_targets[2];
+    std::vector<BasicBlock *> _table;
+    std::vector<BasicBlock *> _sources;
+
+    Instruction(Opcode opcode, int dst = -1);
+    bool isTerminator() const;
+    bool isCompare() const;
+    bool isVector() const;
+    bool hasSideEffects() const;
+    void write(std::ostream &ostr) const;
+};
+
+
+/* A basic block: a label, its instructions, and its neighbors */
+
+class BasicBlock {
+public:
+    Label _label;
+    Instructions _insns;
+    BasicBlocks _preds, _succs;
+    BasicBlock *_idom;
+    int _number;
+    int _index;
+    bool _align;
+
+    BasicBlock();
+
+    Instruction *terminator() const;
+    void write(std::ostream &ostr) const;
+};
+
+
+/* A local variable or parameter */
+
+struct Variable {
+    const Symbol *_symbol;
+    bool _real;
+    unsigned _size;
+    bool _addressed;
+    bool _param;
+    int _offset;
+};
+
+
+/* The flow graph for a single function */
+
+class FlowGraph {
+public:
+    const Symbol *_id;
+    BasicBlocks _blocks;
+    std::vector<Variable> _vars;
+    std::vector<bool> _reals;
+
+    FlowGraph(const Symbol *id);
+    ~FlowGraph();
+    int newRegister(bool real);
+    int newVariable(const Symbol *symbol, bool real, unsigned size);
+    BasicBlock *entry() const;
+    unsigned size() const;
+    void connect();
+    void prune();
+    void write(std::ostream &ostr) const;
+};
+
+
+/* The builder keeps track of where new instructions are inserted */
+
+class Builder {
+    FlowGraph *_graph;
+    BasicBlock *_block;
+    std::map<const Symbol *, int> _variables;
+
+public:
+    Builder(FlowGraph *graph);
+
+    FlowGraph *graph() const;
+    BasicBlock *block() const;
+    BasicBlock *create();
+    void enter(BasicBlock *block);
+
+    Instruction *emit(Instruction *insn);
+    int variable(const Symbol *symbol);
+    int scratch(bool real);
+
+    int constant(long value);
+    int unary(Instruction::Opcode opcode, int src, bool real);
+    int binary(Instruction::Opcode opcode, int left, int right, bool real);
+    void jump(BasicBlock *target);
+    void branch(int cond, BasicBlock *ifTrue, BasicBlock *ifFalse);
+};
+
+std::ostream &operator <<(std::ostream &ostr, const BasicBlock *block);
+
+# endif /* IR_H */
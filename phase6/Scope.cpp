@@ -11,6 +11,7 @@
  *
  *		Extra functionality:
  *		- retrieving the vector of symbols
+ *		- finding symbols through an index by name
  */
 
 # include <cassert>
@@ -41,6 +42,7 @@ void Scope::insert(Symbol *symbol)
 {
     assert(find(symbol->name()) == nullptr);
     _symbols.push_back(symbol);
+    _index[symbol->name()] = symbol;
 }
 
 
@@ -53,11 +55,9 @@ void Scope::insert(Symbol *symbol)
 
 Symbol *Scope::find(const string &name) const
 {
-    for (unsigned i = 0; i < _symbols.size(); i ++)
-	if (name == _symbols[i]->name())
-	    return _symbols[i];
+    auto it = _index.find(name);
 
-    return nullptr;
+    return it != _index.end() ? it->second : nullptr;
 }
 
 
@@ -74,6 +74,8 @@ void Scope::remove(const string &name)
     for (unsigned i = 0; i < _symbols.size(); i ++)
 	if (name == _symbols[i]->name())
 	    _symbols.erase(_symbols.begin() + i);
+
+    _index.erase(name);
 }
 
 
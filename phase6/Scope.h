@@ -3,9 +3,9 @@
  *
  * Description:	This file contains the class definition for scopes in
  *		Simple C.  A scope consists simply of a list of symbols.
- *		We use a vector rather than a map because we want to keep
- *		the symbols in insertion order, and we expect the number of
- *		symbols inserted to be small.
+ *		We use a vector because we want to keep the symbols in
+ *		insertion order, but the outermost scope may hold thousands
+ *		of prototypes, so the symbols are also indexed by name.
  *
  *		Each scope has a link to its enclosing scope.  By
  *		convention, a null scope is used if there is no enclosing
@@ -19,6 +19,7 @@
 # include "Symbol.h"
 # include <string>
 # include <vector>
+# include <unordered_map>
 
 typedef std::vector<Symbol *> Symbols;
 
@@ -27,6 +28,7 @@ class Scope {
 
     Scope *_enclosing;
     Symbols _symbols;
+    std::unordered_map<string, Symbol *> _index;
 
 public:
     Scope(Scope *enclosing = nullptr);
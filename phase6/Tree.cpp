@@ -26,6 +26,80 @@
 
 using namespace std;
 
+static vector<Node *> nodes;
+
+
+/* A cluster of cases becomes a jump table if it has at least TABLE_MIN
+   cases and at least one in every TABLE_DENSITY values is a case. */
+
+# define TABLE_MIN 4
+# define TABLE_DENSITY 3
+
+/* At most LINEAR_MAX single cases are compared one after another rather
+   than searched for. */
+
+# define LINEAR_MAX 3
+
+
+/*
+ * Function:	Node::operator new
+ *
+ * Description:	Allocate a node and remember it so that it can be
+ *		reclaimed.  Every node is a Node at offset zero, since we
+ *		use only single inheritance.
+ */
+
+void *Node::operator new(size_t size)
+{
+    void *node = ::operator new(size);
+
+    nodes.push_back(static_cast<Node *>(node));
+    return node;
+}
+
+
+/*
+ * Function:	Node::operator delete
+ *
+ * Description:	Free a node, which is only done when it is reclaimed.
+ */
+
+void Node::operator delete(void *node)
+{
+    ::operator delete(node);
+}
+
+
+/*
+ * Function:	Node::reclaim
+ *
+ * Description:	Delete every node allocated so far.  This is done once the
+ *		code for a function has been written, so that the memory
+ *		used depends on the largest function rather than on the
+ *		whole input.
+ */
+
+void Node::reclaim()
+{
+    for (unsigned i = 0; i < nodes.size(); i ++)
+	delete nodes[i];
+
+    nodes.clear();
+}
+
+
+/*
+ * Function:	Node::allocated
+ *
+ * Description:	Return the number of nodes allocated since they were last
+ *		reclaimed.
+ */
+
+unsigned Node::allocated()
+{
+    return nodes.size();
+}
+
 
 /*
  * Function:	Expression::Expression (constructor)
@@ -78,6 +152,30 @@ Binary::Binary(Expression *left, Expression *right, const Type &type)
 }
 
 
+/*
+ * Function:	Binary::left (accessor)
+ *
+ * Description:	Return the left operand of this expression.
+ */
+
+Expression *Binary::left() const
+{
+    return _left;
+}
+
+
+/*
+ * Function:	Binary::right (accessor)
+ *
+ * Description:	Return the right operand of this expression.
+ */
+
+Expression *Binary::right() const
+{
+    return _right;
+}
+
+
 /*
  * Function:	Unary::Unary (constructor)
  *
@@ -454,6 +552,47 @@ LogicalOr::LogicalOr(Expression *left, Expression *right, const Type &type)
 }
 
 
+/*
+ * Function:	Placeholder::Placeholder (constructor)
+ *
+ * Description:	Initialize a placeholder for the old value of an lvalue of
+ *		the given type.
+ */
+
+Placeholder::Placeholder(const Type &type)
+    : Expression(type), _value(-1)
+{
+}
+
+
+/*
+ * Function:	Update::Update (constructor)
+ *
+ * Description:	Initialize an update of an lvalue.  Its value is the old
+ *		value of the lvalue if it is postfix and the new value
+ *		otherwise.
+ */
+
+Update::Update(Expression *left, Placeholder *old, Expression *expr, bool postfix)
+    : Expression(left->type()), _left(left), _old(old), _expr(expr),
+      _postfix(postfix), _used(true)
+{
+    _hasCall = left->_hasCall | expr->_hasCall;
+}
+
+
+/*
+ * Function:	Update::discard
+ *
+ * Description:	Note that the value of this update is never used.
+ */
+
+void Update::discard()
+{
+    _used = false;
+}
+
+
 /*
  * Function:	Assignment::Assignment (constructor)
  *
@@ -490,6 +629,24 @@ Block::Block(Scope *decls, const Statements &stmts)
 }
 
 
+/*
+ * Function:	Block::~Block (destructor)
+ *
+ * Description:	Delete the scope of this block and the symbols declared
+ *		in it, which are never functions.
+ */
+
+Block::~Block()
+{
+    const Symbols &symbols = _decls->symbols();
+
+    for (unsigned i = 0; i < symbols.size(); i ++)
+	delete symbols[i];
+
+    delete _decls;
+}
+
+
 /*
  * Function:	Block::declarations (accessor)
  *
@@ -526,6 +683,126 @@ If::If(Expression *expr, Statement *thenStmt, Statement *elseStmt)
 }
 
 
+/*
+ * Function:	Switch::Switch (constructor)
+ *
+ * Description:	Initialize a switch statement.  The cases are sorted by
+ *		value and do not include the default, if any.
+ */
+
+Switch::Switch(Expression *expr, Statement *stmt, const Cases &cases, Case *deflt)
+    : _expr(expr), _stmt(stmt), _cases(cases), _default(deflt)
+{
+}
+
+
+/*
+ * Function:	Switch::cases (accessor)
+ *
+ * Description:	Return the cases of this switch statement.
+ */
+
+const Cases &Switch::cases() const
+{
+    return _cases;
+}
+
+
+/*
+ * Function:	Switch::clusters
+ *
+ * Description:	Partition the cases of this switch statement into
+ *		clusters, each given as a range of indices into the cases.
+ *		Starting from the smallest case, we extend a cluster as far
+ *		as it stays dense enough for a jump table.  A cluster that
+ *		is too small to be worth a table is split into single
+ *		cases, which are instead found by comparisons.
+ */
+
+Clusters Switch::clusters() const
+{
+    Clusters clusters;
+    unsigned first, last, next;
+    long range;
+
+
+    for (first = 0; first < _cases.size(); first = last) {
+	last = first + 1;
+
+	for (next = first + 1; next < _cases.size(); next ++) {
+	    range = _cases[next]->value() - _cases[first]->value() + 1;
+
+	    if (range <= TABLE_DENSITY * (long) (next - first + 1))
+		last = next + 1;
+	}
+
+	if (last - first < TABLE_MIN)
+	    last = first + 1;
+
+	clusters.push_back(make_pair(first, last));
+    }
+
+    return clusters;
+}
+
+
+/*
+ * Function:	Switch::linear
+ *
+ * Description:	Return whether the given range of clusters is few enough
+ *		single cases that comparing them in turn is cheaper than a
+ *		binary search.
+ */
+
+bool Switch::linear(const Clusters &clusters, unsigned first, unsigned last) const
+{
+    if (last - first > LINEAR_MAX)
+	return false;
+
+    for (unsigned i = first; i < last; i ++)
+	if (clusters[i].second - clusters[i].first > 1)
+	    return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	Case::Case (constructor)
+ *
+ * Description:	Initialize a case label, or a default label.
+ */
+
+Case::Case(long value, bool isDefault)
+    : _value(value), _default(isDefault), _block(nullptr)
+{
+}
+
+
+/*
+ * Function:	Case::value (accessor)
+ *
+ * Description:	Return the value of this case label.
+ */
+
+long Case::value() const
+{
+    return _value;
+}
+
+
+/*
+ * Function:	Case::isDefault (accessor)
+ *
+ * Description:	Return whether this label is the default label.
+ */
+
+bool Case::isDefault() const
+{
+    return _default;
+}
+
+
 /*
  * Function:	Function::Function (constructor)
  *
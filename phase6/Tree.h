@@ -8,6 +8,12 @@
  *		constructor is private).  It provides empty functions for
  *		storage allocation and code generation.
  *
+ *		The checker may share a node between parents, so a node
+ *		never deletes its children.  Instead, every node allocated
+ *		is remembered, and once the code for a function has been
+ *		written, all of them are reclaimed at once.  A block owns
+ *		its scope and the symbols declared in it.
+ *
  *		A Node is either a Function, representing a function
  *		definition, or a Statement, which also cannot be
  *		instantiated (again, the constructor is private).
@@ -21,6 +27,7 @@
  *		Tree.cpp - constructors and accessors
  *		allocator.cpp - member functions to do storage allocation
  *		generator.cpp - member functions to do code generation
+ *		lowerer.cpp - member functions to lower to the IR
  *		writer.cpp - member function to write the tree to a stream
  */
 
@@ -33,8 +40,14 @@
 # include "Register.h"
 # include "Label.h"
 
+class Builder;
+class BasicBlock;
+class FlowGraph;
+
 typedef std::vector<class Statement *> Statements;
 typedef std::vector<class Expression *> Expressions;
+typedef std::vector<class Case *> Cases;
+typedef std::vector<std::pair<unsigned, unsigned>> Clusters;
 
 
 /* The base class */
@@ -46,6 +59,11 @@ protected:
     Node() {}
 
 public:
+    static void *operator new(std::size_t size);
+    static void operator delete(void *node);
+    static void reclaim();
+    static unsigned allocated();
+
     virtual ~Node() {}
     virtual void write(ostream &ostr) const = 0;
     virtual void allocate(int &offset) const {}
@@ -58,6 +76,9 @@ public:
 class Statement : public Node {
 protected:
     Statement() {}
+
+public:
+    virtual void lower(Builder &builder) {}
 };
 
 
@@ -78,6 +99,15 @@ public:
     bool lvalue() const;
     virtual void test(const Label &label, bool ifTrue);
     virtual Expression *isDeref() const { return nullptr; }
+    virtual Expression *isAddress() const { return nullptr; }
+    virtual void discard() {}
+
+    virtual void lower(Builder &builder);
+    virtual int lowerValue(Builder &builder) = 0;
+    virtual int lowerAddress(Builder &builder);
+    virtual void lowerStore(Builder &builder, int value);
+    virtual void lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse);
 };
 
 
@@ -87,6 +117,10 @@ class Binary : public Expression {
 protected:
     Expression *_left, *_right;
     Binary(Expression *left, Expression *right, const Type &type);
+
+public:
+    Expression *left() const;
+    Expression *right() const;
 };
 
 
@@ -109,6 +143,8 @@ public:
     const string &value() const;
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
+    virtual int lowerAddress(Builder &builder);
 };
 
 
@@ -122,6 +158,9 @@ public:
     const Symbol *symbol() const;
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
+    virtual int lowerAddress(Builder &builder);
+    virtual void lowerStore(Builder &builder, int value);
 };
 
 
@@ -136,6 +175,7 @@ public:
     const string &value() const;
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
 };
 
 
@@ -150,6 +190,7 @@ public:
     const string &value() const;
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
 };
 
 
@@ -163,6 +204,7 @@ public:
     Call(const Symbol *id, const Expressions &args, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
 };
 
 
@@ -173,6 +215,9 @@ public:
     Not(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
+    virtual void lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse);
 };
 
 
@@ -183,6 +228,7 @@ public:
     Negate(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
 };
 
 
@@ -194,6 +240,8 @@ public:
     virtual void write(ostream &ostr) const;
     virtual void generate();
     virtual Expression *isDeref() const { return _expr; }
+    virtual int lowerValue(Builder &builder);
+    virtual int lowerAddress(Builder &builder);
 };
 
 
@@ -204,6 +252,8 @@ public:
     Address(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual Expression *isAddress() const { return _expr; }
+    virtual int lowerValue(Builder &builder);
 };
 
 
@@ -214,6 +264,7 @@ public:
     Cast(const Type &type, Expression *expr);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
 };
 
 
@@ -224,6 +275,7 @@ public:
     Multiply(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
 };
 
 
@@ -234,6 +286,7 @@ public:
     Divide(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
 };
 
 
@@ -244,6 +297,7 @@ public:
     Remainder(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
 };
 
 
@@ -254,6 +308,7 @@ public:
     Add(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
 };
 
 
@@ -264,6 +319,7 @@ public:
     Subtract(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
 };
 
 
@@ -275,6 +331,9 @@ public:
     virtual void write(ostream &ostr) const;
     virtual void test(const Label &label, bool ifTrue);
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
+    virtual void lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse);
 };
 
 
@@ -285,6 +344,9 @@ public:
     GreaterThan(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
+    virtual void lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse);
 };
 
 
@@ -295,6 +357,9 @@ public:
     LessOrEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
+    virtual void lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse);
 };
 
 
@@ -305,6 +370,9 @@ public:
     GreaterOrEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
+    virtual void lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse);
 };
 
 
@@ -315,6 +383,9 @@ public:
     Equal(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
+    virtual void lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse);
 };
 
 
@@ -325,6 +396,9 @@ public:
     NotEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
+    virtual void lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse);
 };
 
 
@@ -335,6 +409,9 @@ public:
     LogicalAnd(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
+    virtual void lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse);
 };
 
 
@@ -345,6 +422,40 @@ public:
     LogicalOr(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual int lowerValue(Builder &builder);
+    virtual void lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse);
+};
+
+
+/* The value of the operand of an update before it is updated */
+
+class Placeholder : public Expression {
+public:
+    int _value;
+
+    Placeholder(const Type &type);
+    virtual void write(ostream &ostr) const;
+    virtual void generate();
+    virtual int lowerValue(Builder &builder);
+};
+
+
+/* An update of an lvalue in place: ++left, left++, left op= right, and
+   so on, where expr computes the new value from the placeholder */
+
+class Update : public Expression {
+    Expression *_left;
+    Placeholder *_old;
+    Expression *_expr;
+    bool _postfix, _used;
+
+public:
+    Update(Expression *left, Placeholder *old, Expression *expr, bool postfix);
+    virtual void write(ostream &ostr) const;
+    virtual void generate();
+    virtual void discard();
+    virtual int lowerValue(Builder &builder);
 };
 
 
@@ -357,6 +468,7 @@ public:
     Assignment(Expression *left, Expression *right);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual void lower(Builder &builder);
 };
 
 
@@ -369,6 +481,7 @@ public:
     Return(Expression *expr);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual void lower(Builder &builder);
 };
 
 
@@ -380,10 +493,12 @@ class Block : public Statement {
 
 public:
     Block(Scope *decls, const Statements &stmts);
+    virtual ~Block();
     Scope *declarations() const;
     virtual void write(ostream &ostr) const;
     virtual void allocate(int &offset) const;
     virtual void generate();
+    virtual void lower(Builder &builder);
 };
 
 
@@ -398,6 +513,7 @@ public:
     virtual void write(ostream &ostr) const;
     virtual void allocate(int &offset) const;
     virtual void generate();
+    virtual void lower(Builder &builder);
 };
 
 
@@ -412,6 +528,56 @@ public:
     virtual void write(ostream &ostr) const;
     virtual void allocate(int &offset) const;
     virtual void generate();
+    virtual void lower(Builder &builder);
+};
+
+
+/* A switch statement: switch ( expr ) stmt */
+
+class Switch : public Statement {
+    Expression *_expr;
+    Statement *_stmt;
+    Cases _cases;
+    Case *_default;
+
+public:
+    Switch(Expression *expr, Statement *stmt, const Cases &cases, Case *deflt);
+    const Cases &cases() const;
+    Clusters clusters() const;
+    bool linear(const Clusters &clusters, unsigned first, unsigned last) const;
+    virtual void write(ostream &ostr) const;
+    virtual void allocate(int &offset) const;
+    virtual void generate();
+    virtual void lower(Builder &builder);
+};
+
+
+/* A case or default label within a switch statement */
+
+class Case : public Statement {
+    long _value;
+    bool _default;
+
+public:
+    Label _label;
+    BasicBlock *_block;
+
+    Case(long value, bool isDefault = false);
+    long value() const;
+    bool isDefault() const;
+    virtual void write(ostream &ostr) const;
+    virtual void generate();
+    virtual void lower(Builder &builder);
+};
+
+
+/* A break statement */
+
+class Break : public Statement {
+public:
+    virtual void write(ostream &ostr) const;
+    virtual void generate();
+    virtual void lower(Builder &builder);
 };
 
 
@@ -426,6 +592,7 @@ public:
     virtual void write(ostream &ostr) const;
     virtual void allocate(int &offset) const;
     virtual void generate();
+    FlowGraph *lower();
 };
 
 # endif /* TREE_H */
@@ -124,6 +124,20 @@ void If::allocate(int &offset) const
 }
 
 
+/*
+ * Function:	Switch::allocate
+ *
+ * Description:	Allocate storage for this switch statement, which
+ *		essentially means allocating storage for variables declared
+ *		as part of its statement.
+ */
+
+void Switch::allocate(int &offset) const
+{
+    _stmt->allocate(offset);
+}
+
+
 /*
  * Function:	Function::allocate
  *
@@ -0,0 +1,2000 @@
+/*
+ * File:	assembler.cpp
+ *
+ * Description:	This file contains the function definitions for assembling
+ *		the output of the compiler into an ELF relocatable object
+ *		file, so that compiling a file need not go through a
+ *		separate assembler.
+ *
+ *		Only the instructions and directives that the compiler
+ *		writes are understood, and each is encoded just as the
+ *		GNU assembler would encode it, so that disassembling the
+ *		object shows the same instructions whichever way it was
+ *		made.  In particular, an immediate or displacement that
+ *		refers to a symbol not yet defined always takes four
+ *		bytes, even if the symbol turns out to be a small constant
+ *		such as the size of a frame.
+ *
+ *		Each section is a list of fragments, each of which is a
+ *		run of bytes followed by an optional jump, conditional
+ *		branch, or alignment, whose size depends on where things
+ *		end up.  Every jump to a local label in the same section
+ *		starts out short, and the sections are laid out repeatedly,
+ *		making long any jump whose displacement no longer fits in a
+ *		byte, until nothing changes.  The remaining references to
+ *		symbols are then either resolved in place or written as
+ *		relocations, and the sections, symbols, and relocations
+ *		are written out as an object file.
+ */
+
+# include <string>
+# include <vector>
+# include <cctype>
+# include <cstdint>
+# include <cstdlib>
+# include <cstring>
+# include <iostream>
+# include <unordered_map>
+# include "assembler.h"
+# include "machine.h"
+
+using namespace std;
+
+# define SHT_PROGBITS 1
+# define SHT_SYMTAB 2
+# define SHT_STRTAB 3
+# define SHT_NOBITS 8
+# define SHT_REL 9
+# define SHT_INIT_ARRAY 14
+# define SHT_FINI_ARRAY 15
+
+# define SHF_WRITE 0x1
+# define SHF_ALLOC 0x2
+# define SHF_EXECINSTR 0x4
+# define SHF_INFO_LINK 0x40
+
+# define SHN_ABS 0xfff1
+# define SHN_COMMON 0xfff2
+
+# define STB_LOCAL 0
+# define STB_GLOBAL 1
+# define STT_NOTYPE 0
+# define STT_OBJECT 1
+# define STT_SECTION 3
+
+# define R_386_32 1
+# define R_386_PC32 2
+
+# define ELF_HEADER 52
+# define SECTION_HEADER 40
+# define SYMBOL_ENTRY 16
+# define REL_ENTRY 8
+
+enum { TEXT, DATA, BSS };
+enum { NONE, JUMP, BRANCH, ALIGN };
+enum { UNDEFINED = -1, ABSOLUTE = -2, COMMON = -3 };
+enum { REGISTER, IMMEDIATE, MEMORY };
+enum { R8, R32, XMM, ST };
+enum { EAX, ECX, EDX, EBX, ESP, EBP, ESI, EDI };
+
+enum {
+    ALU, ALUB, TEST, MOVL, MOVB, LEA, UNARY, INCDEC, SHIFT, IMUL, PUSH, POP,
+    CALL, JMP, JCC, SETCC, PLAIN, RM, MOVE, MOVD, SHUFFLE, COMPARE, FLOAT
+};
+
+struct Form {
+    int _kind;
+    unsigned _prefix, _opcode, _extra;
+    int _source, _target;
+};
+
+struct Operand {
+    int _kind, _class, _reg;
+    int _base, _index, _scale;
+    int _symbol;
+    long _value;
+    bool _indirect;
+};
+
+struct Fixup {
+    unsigned _offset;
+    int _symbol;
+    bool _relative;
+};
+
+struct Fragment {
+    string _bytes;
+    vector<Fixup> _fixups;
+    int _tail, _symbol;
+    unsigned _extra, _address;
+    long _addend;
+    bool _long;
+};
+
+struct Relocation {
+    unsigned _offset;
+    int _symbol, _type;
+};
+
+struct Section {
+    string _name;
+    unsigned _type, _flags, _align, _entsize;
+    int _symbol;
+    vector<Fragment> _fragments;
+    string _contents;
+    vector<Fixup> _fixups;
+    vector<Relocation> _relocations;
+    unsigned _index, _offset;
+};
+
+struct ObjectSymbol {
+    string _name;
+    int _section;
+    unsigned _fragment, _offset, _size, _index;
+    long _value;
+    bool _global, _local, _used, _isSection;
+};
+
+static vector<Section> sections;
+static vector<ObjectSymbol> symbols;
+static unordered_map<string, int> names;
+static unordered_map<string, Form> forms;
+static int current;
+static const char *line, *limit;
+
+static const char *conditions[] = {
+    "o", "no", "b", "ae", "e", "ne", "be", "a",
+    "s", "ns", "p", "np", "l", "ge", "le", "g"
+};
+
+static const char *aliases[][2] = {
+    {"c", "b"}, {"nae", "b"}, {"nb", "ae"}, {"nc", "ae"}, {"z", "e"},
+    {"nz", "ne"}, {"na", "be"}, {"nbe", "a"}, {"pe", "p"}, {"po", "np"},
+    {"nge", "l"}, {"nl", "ge"}, {"ng", "le"}, {"nle", "g"}
+};
+
+static const char *predicates[] = {
+    "eq", "lt", "le", "unord", "neq", "nlt", "nle", "ord"
+};
+
+static const struct {
+    const char *_name;
+    int _class, _reg;
+} registers[] = {
+    {"eax", R32, EAX}, {"ecx", R32, ECX}, {"edx", R32, EDX}, {"ebx", R32, EBX},
+    {"esp", R32, ESP}, {"ebp", R32, EBP}, {"esi", R32, ESI}, {"edi", R32, EDI},
+    {"al", R8, 0}, {"cl", R8, 1}, {"dl", R8, 2}, {"bl", R8, 3},
+    {"ah", R8, 4}, {"ch", R8, 5}, {"dh", R8, 6}, {"bh", R8, 7},
+    {"xmm0", XMM, 0}, {"xmm1", XMM, 1}, {"xmm2", XMM, 2}, {"xmm3", XMM, 3},
+    {"xmm4", XMM, 4}, {"xmm5", XMM, 5}, {"xmm6", XMM, 6}, {"xmm7", XMM, 7},
+    {"st", ST, 0},
+};
+
+static const struct {
+    const char *_name;
+    Form _form;
+} table[] = {
+    {"addl", {ALU, 0, 0, 0}}, {"orl", {ALU, 0, 0, 1}},
+    {"adcl", {ALU, 0, 0, 2}}, {"sbbl", {ALU, 0, 0, 3}},
+    {"andl", {ALU, 0, 0, 4}}, {"subl", {ALU, 0, 0, 5}},
+    {"xorl", {ALU, 0, 0, 6}}, {"cmpl", {ALU, 0, 0, 7}},
+    {"addb", {ALUB, 0, 0, 0}}, {"orb", {ALUB, 0, 0, 1}},
+    {"andb", {ALUB, 0, 0, 4}}, {"subb", {ALUB, 0, 0, 5}},
+    {"xorb", {ALUB, 0, 0, 6}}, {"cmpb", {ALUB, 0, 0, 7}},
+    {"testl", {TEST}}, {"movl", {MOVL}}, {"movb", {MOVB}}, {"leal", {LEA}},
+    {"notl", {UNARY, 0, 0xf7, 2}}, {"negl", {UNARY, 0, 0xf7, 3}},
+    {"divl", {UNARY, 0, 0xf7, 6}}, {"idivl", {UNARY, 0, 0xf7, 7}},
+    {"incl", {INCDEC, 0, 0x40, 0}}, {"decl", {INCDEC, 0, 0x48, 1}},
+    {"shll", {SHIFT, 0, 0, 4}}, {"sall", {SHIFT, 0, 0, 4}},
+    {"shrl", {SHIFT, 0, 0, 5}}, {"sarl", {SHIFT, 0, 0, 7}},
+    {"imull", {IMUL, 0, 0xaf, 0, R32, R32}},
+    {"pushl", {PUSH}}, {"popl", {POP}}, {"call", {CALL}}, {"jmp", {JMP}},
+    {"cltd", {PLAIN, 0, 0x99}}, {"ret", {PLAIN, 0, 0xc3}},
+    {"nop", {PLAIN, 0, 0x90}},
+    {"movzbl", {RM, 0, 0xb6, 0, R8, R32}},
+    {"movsbl", {RM, 0, 0xbe, 0, R8, R32}},
+    {"addsd", {RM, 0xf2, 0x58, 0, XMM, XMM}},
+    {"mulsd", {RM, 0xf2, 0x59, 0, XMM, XMM}},
+    {"subsd", {RM, 0xf2, 0x5c, 0, XMM, XMM}},
+    {"minsd", {RM, 0xf2, 0x5d, 0, XMM, XMM}},
+    {"divsd", {RM, 0xf2, 0x5e, 0, XMM, XMM}},
+    {"maxsd", {RM, 0xf2, 0x5f, 0, XMM, XMM}},
+    {"unpcklpd", {RM, 0x66, 0x14, 0, XMM, XMM}},
+    {"ucomisd", {RM, 0x66, 0x2e, 0, XMM, XMM}},
+    {"andpd", {RM, 0x66, 0x54, 0, XMM, XMM}},
+    {"andnpd", {RM, 0x66, 0x55, 0, XMM, XMM}},
+    {"orpd", {RM, 0x66, 0x56, 0, XMM, XMM}},
+    {"xorpd", {RM, 0x66, 0x57, 0, XMM, XMM}},
+    {"addpd", {RM, 0x66, 0x58, 0, XMM, XMM}},
+    {"mulpd", {RM, 0x66, 0x59, 0, XMM, XMM}},
+    {"subpd", {RM, 0x66, 0x5c, 0, XMM, XMM}},
+    {"divpd", {RM, 0x66, 0x5e, 0, XMM, XMM}},
+    {"pxor", {RM, 0x66, 0xef, 0, XMM, XMM}},
+    {"psubd", {RM, 0x66, 0xfa, 0, XMM, XMM}},
+    {"paddd", {RM, 0x66, 0xfe, 0, XMM, XMM}},
+    {"cvtsi2sd", {RM, 0xf2, 0x2a, 0, R32, XMM}},
+    {"cvttsd2si", {RM, 0xf2, 0x2c, 0, XMM, R32}},
+    {"movsd", {MOVE, 0xf2, 0x10, 0x11}},
+    {"movupd", {MOVE, 0x66, 0x10, 0x11}},
+    {"movdqu", {MOVE, 0xf3, 0x6f, 0x7f}},
+    {"movd", {MOVD, 0x66, 0x6e, 0x7e}},
+    {"pshufd", {SHUFFLE, 0x66, 0x70, 0, XMM, XMM}},
+    {"fldl", {FLOAT, 0, 0xdd, 0}}, {"fstpl", {FLOAT, 0, 0xdd, 3}},
+    {"fstp", {FLOAT, 0, 0xdd, 3}},
+};
+
+
+/*
+ * Function:	error (private)
+ *
+ * Description:	Report a line that we cannot assemble and exit.
+ */
+
+static void error()
+{
+    const char *end = line;
+
+    while (end < limit && *end != '\n')
+	end ++;
+
+    while (line < end && isspace(*line))
+	line ++;
+
+    cerr << "scc: cannot assemble '" << string(line, end) << "'" << endl;
+    exit(EXIT_FAILURE);
+}
+
+
+/*
+ * Function:	initialize (private)
+ *
+ * Description:	Fill in the forms of the instructions, adding one for each
+ *		condition of the conditional jumps, sets, and moves, and
+ *		for each predicate of the scalar comparisons.
+ */
+
+static void initialize()
+{
+    unsigned cc;
+
+
+    for (auto &entry : table)
+	forms[entry._name] = entry._form;
+
+    for (cc = 0; cc < 16; cc ++) {
+	forms[string("j") + conditions[cc]] = {JCC, 0, 0, cc};
+	forms[string("set") + conditions[cc]] = {SETCC, 0, 0, cc};
+	forms[string("cmov") + conditions[cc]] = {RM, 0, 0x40 + cc, 0, R32, R32};
+    }
+
+    for (auto &alias : aliases)
+	for (string prefix : {"j", "set", "cmov"})
+	    forms[prefix + alias[0]] = forms[prefix + alias[1]];
+
+    for (cc = 0; cc < 8; cc ++)
+	forms[string("cmp") + predicates[cc] + "sd"] = {COMPARE, 0xf2, 0xc2, cc, XMM, XMM};
+}
+
+
+/*
+ * Function:	temporary (private)
+ *
+ * Description:	Return whether a name is that of a local label, which is
+ *		left out of the symbol table.
+ */
+
+static bool temporary(const string &name)
+{
+    return name.compare(0, strlen(label_prefix), label_prefix) == 0;
+}
+
+
+/*
+ * Function:	lookup (private)
+ *
+ * Description:	Return the index of the named symbol, creating it if this
+ *		is its first appearance.  Symbols are written in the order
+ *		in which they first appear, as the GNU assembler does.
+ */
+
+static int lookup(const string &name)
+{
+    auto it = names.find(name);
+    ObjectSymbol symbol;
+
+
+    if (it != names.end())
+	return it->second;
+
+    symbol._name = name;
+    symbol._section = UNDEFINED;
+    symbol._fragment = symbol._offset = symbol._size = symbol._index = 0;
+    symbol._value = 0;
+    symbol._global = symbol._local = symbol._used = symbol._isSection = false;
+
+    names[name] = symbols.size();
+    symbols.push_back(symbol);
+    return symbols.size() - 1;
+}
+
+
+/*
+ * Function:	section (private)
+ *
+ * Description:	Return the index of the named section, creating it and its
+ *		symbol if this is its first appearance.  The type and
+ *		flags of a new section come from its name, as do those of
+ *		the standard sections, unless they are given.
+ */
+
+static int section(const string &name, const string &flags = "", const string &type = "")
+{
+    Section s;
+    ObjectSymbol symbol;
+
+
+    for (unsigned i = 0; i < sections.size(); i ++)
+	if (sections[i]._name == name)
+	    return i;
+
+    s._name = name;
+    s._type = SHT_PROGBITS;
+    s._flags = 0;
+    s._align = 1;
+    s._entsize = 0;
+    s._index = s._offset = 0;
+    s._fragments.push_back(Fragment());
+
+    if (name == ".bss" || name.compare(0, 5, ".bss.") == 0 || type == "@nobits")
+	s._type = SHT_NOBITS;
+    else if (name == ".init_array" || type == "@init_array")
+	s._type = SHT_INIT_ARRAY;
+    else if (name == ".fini_array" || type == "@fini_array")
+	s._type = SHT_FINI_ARRAY;
+
+    if (s._type == SHT_INIT_ARRAY || s._type == SHT_FINI_ARRAY)
+	s._entsize = 4;
+
+    if (!flags.empty()) {
+	for (char c : flags)
+	    s._flags |= c == 'a' ? SHF_ALLOC : c == 'w' ? SHF_WRITE : c == 'x' ? SHF_EXECINSTR : 0;
+    } else if (name == ".text" || name.compare(0, 6, ".text.") == 0)
+	s._flags = SHF_ALLOC | SHF_EXECINSTR;
+    else if (name.compare(0, 7, ".rodata") == 0)
+	s._flags = SHF_ALLOC;
+    else if (s._type != SHT_PROGBITS || name == ".data" || name.compare(0, 6, ".data.") == 0)
+	s._flags = SHF_ALLOC | SHF_WRITE;
+
+    symbol._name = name;
+    symbol._section = sections.size();
+    symbol._fragment = symbol._offset = symbol._size = symbol._index = 0;
+    symbol._value = 0;
+    symbol._global = symbol._local = symbol._used = false;
+    symbol._isSection = true;
+
+    s._symbol = symbols.size();
+    symbols.push_back(symbol);
+    sections.push_back(s);
+    return sections.size() - 1;
+}
+
+
+/*
+ * Function:	fragment (private)
+ *
+ * Description:	Return the fragment of the current section being filled.
+ */
+
+static Fragment &fragment()
+{
+    return sections[current]._fragments.back();
+}
+
+
+/*
+ * Function:	byte (private)
+ *
+ * Description:	Add a byte to the current fragment.
+ */
+
+static void byte(unsigned value)
+{
+    fragment()._bytes += (char) value;
+}
+
+
+/*
+ * Function:	word (private)
+ *
+ * Description:	Add a 32-bit word to the current fragment, and note that it
+ *		must be fixed up if it refers to a symbol.  A relative word
+ *		is a displacement from the end of the word itself, which is
+ *		always the end of the instruction.
+ */
+
+static void word(long value, int symbol = -1, bool relative = false)
+{
+    Fragment &f = fragment();
+
+
+    if (symbol >= 0)
+	f._fixups.push_back({(unsigned) f._bytes.size(), symbol, relative});
+
+    if (relative)
+	value -= 4;
+
+    for (unsigned i = 0; i < 4; i ++)
+	f._bytes += (char) (value >> 8 * i);
+}
+
+
+/*
+ * Function:	tail (private)
+ *
+ * Description:	End the current fragment with a jump, branch, or alignment,
+ *		and start a new one.
+ */
+
+static void tail(int kind, unsigned extra, int symbol = -1, long addend = 0)
+{
+    Fragment &f = fragment();
+
+
+    f._tail = kind;
+    f._extra = extra;
+    f._symbol = symbol;
+    f._addend = addend;
+    f._long = false;
+    sections[current]._fragments.push_back(Fragment());
+}
+
+
+/*
+ * Function:	define (private)
+ *
+ * Description:	Define a label at the current location.
+ */
+
+static void define(const string &name)
+{
+    ObjectSymbol &symbol = symbols[lookup(name)];
+
+
+    if (symbol._section != UNDEFINED)
+	error();
+
+    symbol._section = current;
+    symbol._fragment = sections[current]._fragments.size() - 1;
+    symbol._offset = fragment()._bytes.size();
+}
+
+
+/*
+ * Function:	skip (private)
+ *
+ * Description:	Skip any blanks.
+ */
+
+static const char *skip(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+	p ++;
+
+    return p;
+}
+
+
+/*
+ * Function:	identifier (private)
+ *
+ * Description:	Return the end of a symbol name starting at the given
+ *		character, which is the start itself if there is none.
+ */
+
+static const char *identifier(const char *p, const char *end)
+{
+    if (p < end && (isalpha(*p) || *p == '_' || *p == '.' || *p == '$')) {
+	p ++;
+
+	while (p < end && (isalnum(*p) || *p == '_' || *p == '.' || *p == '$'))
+	    p ++;
+    }
+
+    return p;
+}
+
+
+/*
+ * Function:	number (private)
+ *
+ * Description:	Parse an integer, which may be octal or hexadecimal as in
+ *		C, and return its end.
+ */
+
+static const char *number(const char *p, const char *end, long &value)
+{
+    char *q;
+
+
+    if (p == end || !isdigit(*p))
+	error();
+
+    value = strtol(p, &q, 0);
+
+    if (q > end)
+	error();
+
+    return q;
+}
+
+
+/*
+ * Function:	expression (private)
+ *
+ * Description:	Parse an expression that is a sum of integers and at most
+ *		one symbol, and return its end.  A symbol that has already
+ *		been set to a constant is replaced by its value.
+ */
+
+static const char *expression(const char *p, const char *end, int &symbol, long &value)
+{
+    const char *q;
+    long n;
+    bool negative;
+
+
+    symbol = -1;
+    value = 0;
+
+    while (true) {
+	negative = false;
+
+	if (p < end && (*p == '+' || *p == '-'))
+	    negative = *p ++ == '-';
+
+	q = identifier(p, end);
+
+	if (q > p) {
+	    if (symbol >= 0 || negative)
+		error();
+
+	    symbol = lookup(string(p, q));
+	    p = q;
+	} else {
+	    p = number(p, end, n);
+	    value += negative ? -n : n;
+	}
+
+	if (p == end || (*p != '+' && *p != '-'))
+	    break;
+    }
+
+    if (symbol >= 0 && symbols[symbol]._section == ABSOLUTE) {
+	value += symbols[symbol]._value;
+	symbol = -1;
+    }
+
+    return p;
+}
+
+
+/*
+ * Function:	reg (private)
+ *
+ * Description:	Parse a register, including its percent sign, and return its
+ *		end.
+ */
+
+static const char *reg(const char *p, const char *end, int &cls, int &num)
+{
+    const char *q;
+    long n;
+
+
+    if (p == end || *p != '%')
+	error();
+
+    for (q = ++ p; q < end && isalnum(*q); q ++)
+	continue;
+
+    for (auto &r : registers)
+	if (strlen(r._name) == (size_t) (q - p) && strncmp(r._name, p, q - p) == 0) {
+	    cls = r._class;
+	    num = r._reg;
+
+	    if (cls == ST && q < end && *q == '(') {
+		q = number(q + 1, end, n);
+
+		if (q == end || *q != ')' || n > 7)
+		    error();
+
+		num = n;
+		q ++;
+	    }
+
+	    return q;
+	}
+
+    error();
+    return q;
+}
+
+
+/*
+ * Function:	operand (private)
+ *
+ * Description:	Parse an operand, which is a register, an immediate, or a
+ *		memory reference with an optional displacement, base,
+ *		index, and scale.  A jump or call through an operand is
+ *		marked with an asterisk.
+ */
+
+static Operand operand(const char *p, const char *end)
+{
+    Operand op;
+    long scale;
+
+
+    op._kind = MEMORY;
+    op._class = op._reg = 0;
+    op._base = op._index = -1;
+    op._scale = 1;
+    op._symbol = -1;
+    op._value = 0;
+    op._indirect = p < end && *p == '*';
+
+    if (op._indirect)
+	p ++;
+
+    if (p < end && *p == '%') {
+	op._kind = REGISTER;
+	p = reg(p, end, op._class, op._reg);
+    } else if (p < end && *p == '$') {
+	op._kind = IMMEDIATE;
+	p = expression(p + 1, end, op._symbol, op._value);
+    } else {
+	if (p < end && *p != '(')
+	    p = expression(p, end, op._symbol, op._value);
+
+	if (p < end && *p == '(') {
+	    int cls;
+
+	    if (++ p < end && *p == '%') {
+		p = reg(p, end, cls, op._base);
+
+		if (cls != R32)
+		    error();
+	    }
+
+	    if (p < end && *p == ',') {
+		p = reg(p + 1, end, cls, op._index);
+
+		if (cls != R32 || op._index == ESP)
+		    error();
+
+		if (p < end && *p == ',') {
+		    p = number(p + 1, end, scale);
+
+		    if (scale != 1 && scale != 2 && scale != 4 && scale != 8)
+			error();
+
+		    op._scale = scale;
+		}
+	    }
+
+	    if (p == end || *p ++ != ')')
+		error();
+	}
+    }
+
+    if (p != end)
+	error();
+
+    return op;
+}
+
+
+/*
+ * Function:	is (private)
+ *
+ * Description:	Return whether an operand is a register of the given class.
+ */
+
+static bool is(const Operand &op, int cls)
+{
+    return op._kind == REGISTER && op._class == cls && !op._indirect;
+}
+
+
+/*
+ * Function:	memory (private)
+ *
+ * Description:	Return whether an operand is a memory reference.
+ */
+
+static bool memory(const Operand &op)
+{
+    return op._kind == MEMORY && !op._indirect;
+}
+
+
+/*
+ * Function:	absolute (private)
+ *
+ * Description:	Return whether an operand is a memory reference with
+ *		neither a base nor an index.
+ */
+
+static bool absolute(const Operand &op)
+{
+    return memory(op) && op._base < 0 && op._index < 0;
+}
+
+
+/*
+ * Function:	small (private)
+ *
+ * Description:	Return whether an immediate or displacement fits in a
+ *		signed byte.
+ */
+
+static bool small(const Operand &op)
+{
+    return op._symbol < 0 && op._value >= -128 && op._value <= 127;
+}
+
+
+/*
+ * Function:	modrm (private)
+ *
+ * Description:	Add the ModR/M byte for an operand, with the given value in
+ *		its register field, along with any SIB byte and
+ *		displacement.
+ */
+
+static void modrm(unsigned field, const Operand &op)
+{
+    static const unsigned scales[] = {0, 0, 1, 0, 2, 0, 0, 0, 3};
+    unsigned mod, index;
+
+
+    if (op._kind == REGISTER) {
+	byte(0xc0 | field << 3 | op._reg);
+	return;
+    }
+
+    if (op._kind != MEMORY)
+	error();
+
+    index = op._index < 0 ? ESP : op._index;
+
+    if (op._base < 0) {
+	if (op._index < 0)
+	    byte(field << 3 | EBP);
+	else {
+	    byte(field << 3 | ESP);
+	    byte(scales[op._scale] << 6 | index << 3 | EBP);
+	}
+
+	word(op._value, op._symbol);
+	return;
+    }
+
+    if (op._symbol >= 0)
+	mod = 2;
+    else if (op._value == 0 && op._base != EBP)
+	mod = 0;
+    else
+	mod = small(op) ? 1 : 2;
+
+    if (op._index < 0 && op._base != ESP)
+	byte(mod << 6 | field << 3 | op._base);
+    else {
+	byte(mod << 6 | field << 3 | ESP);
+	byte(scales[op._scale] << 6 | index << 3 | op._base);
+    }
+
+    if (mod == 1)
+	byte(op._value);
+    else if (mod == 2)
+	word(op._value, op._symbol);
+}
+
+
+/*
+ * Function:	prefixed (private)
+ *
+ * Description:	Add an opcode in the two-byte map, with its mandatory
+ *		prefix if it has one, and the ModR/M byte for an operand.
+ */
+
+static void prefixed(unsigned prefix, unsigned opcode, unsigned field, const Operand &op)
+{
+    if (prefix != 0)
+	byte(prefix);
+
+    byte(0x0f);
+    byte(opcode);
+    modrm(field, op);
+}
+
+
+/*
+ * Function:	immediate (private)
+ *
+ * Description:	Add an arithmetic instruction with an immediate source,
+ *		using a byte for a small immediate and the shorter form
+ *		for the accumulator if there is one.
+ */
+
+static void immediate(const Form &form, const Operand &src, const Operand &dst, bool wide)
+{
+    if (!wide) {
+	if (src._symbol >= 0)
+	    error();
+
+	if (is(dst, R8) && dst._reg == 0)
+	    byte(form._extra << 3 | 0x04);
+	else {
+	    byte(0x80);
+	    modrm(form._extra, dst);
+	}
+
+	byte(src._value);
+
+    } else if (small(src)) {
+	byte(0x83);
+	modrm(form._extra, dst);
+	byte(src._value);
+
+    } else if (is(dst, R32) && dst._reg == EAX) {
+	byte(form._extra << 3 | 0x05);
+	word(src._value, src._symbol);
+
+    } else {
+	byte(0x81);
+	modrm(form._extra, dst);
+	word(src._value, src._symbol);
+    }
+}
+
+
+/*
+ * Function:	move (private)
+ *
+ * Description:	Add a move of a word or a byte, using the short forms for
+ *		the accumulator and an absolute address.
+ */
+
+static void move(const Operand &src, const Operand &dst, bool wide)
+{
+    int cls = wide ? R32 : R8;
+
+
+    if (src._kind == IMMEDIATE && is(dst, cls)) {
+	byte((wide ? 0xb8 : 0xb0) + dst._reg);
+
+	if (wide)
+	    word(src._value, src._symbol);
+	else if (src._symbol < 0)
+	    byte(src._value);
+	else
+	    error();
+
+    } else if (src._kind == IMMEDIATE && memory(dst)) {
+	byte(wide ? 0xc7 : 0xc6);
+	modrm(0, dst);
+
+	if (wide)
+	    word(src._value, src._symbol);
+	else if (src._symbol < 0)
+	    byte(src._value);
+	else
+	    error();
+
+    } else if (is(src, cls) && src._reg == 0 && absolute(dst)) {
+	byte(wide ? 0xa3 : 0xa2);
+	word(dst._value, dst._symbol);
+
+    } else if (is(dst, cls) && dst._reg == 0 && absolute(src)) {
+	byte(wide ? 0xa1 : 0xa0);
+	word(src._value, src._symbol);
+
+    } else if (is(src, cls) && (is(dst, cls) || memory(dst))) {
+	byte(wide ? 0x89 : 0x88);
+	modrm(src._reg, dst);
+
+    } else if (memory(src) && is(dst, cls)) {
+	byte(wide ? 0x8b : 0x8a);
+	modrm(dst._reg, src);
+
+    } else
+	error();
+}
+
+
+/*
+ * Function:	encode (private)
+ *
+ * Description:	Encode an instruction with the given operands.
+ */
+
+static void encode(const Form &form, const vector<Operand> &ops)
+{
+    unsigned n = ops.size();
+
+
+    switch (form._kind) {
+    case ALU:
+    case ALUB: {
+	bool wide = form._kind == ALU;
+	int cls = wide ? R32 : R8;
+
+	if (n != 2)
+	    error();
+
+	if (ops[0]._kind == IMMEDIATE && (is(ops[1], cls) || memory(ops[1])))
+	    immediate(form, ops[0], ops[1], wide);
+	else if (is(ops[0], cls) && (is(ops[1], cls) || memory(ops[1]))) {
+	    byte(form._extra << 3 | (wide ? 0x01 : 0x00));
+	    modrm(ops[0]._reg, ops[1]);
+	} else if (memory(ops[0]) && is(ops[1], cls)) {
+	    byte(form._extra << 3 | (wide ? 0x03 : 0x02));
+	    modrm(ops[1]._reg, ops[0]);
+	} else
+	    error();
+
+	break;
+    }
+
+    case TEST:
+	if (n != 2 || !(is(ops[1], R32) || memory(ops[1])))
+	    error();
+
+	if (ops[0]._kind == IMMEDIATE) {
+	    if (is(ops[1], R32) && ops[1]._reg == EAX)
+		byte(0xa9);
+	    else {
+		byte(0xf7);
+		modrm(0, ops[1]);
+	    }
+
+	    word(ops[0]._value, ops[0]._symbol);
+	} else if (is(ops[0], R32)) {
+	    byte(0x85);
+	    modrm(ops[0]._reg, ops[1]);
+	} else
+	    error();
+
+	break;
+
+    case MOVL:
+    case MOVB:
+	if (n != 2)
+	    error();
+
+	move(ops[0], ops[1], form._kind == MOVL);
+	break;
+
+    case LEA:
+	if (n != 2 || !memory(ops[0]) || !is(ops[1], R32))
+	    error();
+
+	byte(0x8d);
+	modrm(ops[1]._reg, ops[0]);
+	break;
+
+    case UNARY:
+	if (n != 1 || !(is(ops[0], R32) || memory(ops[0])))
+	    error();
+
+	byte(form._opcode);
+	modrm(form._extra, ops[0]);
+	break;
+
+    case INCDEC:
+	if (n == 1 && is(ops[0], R32))
+	    byte(form._opcode + ops[0]._reg);
+	else if (n == 1 && memory(ops[0])) {
+	    byte(0xff);
+	    modrm(form._extra, ops[0]);
+	} else
+	    error();
+
+	break;
+
+    case SHIFT:
+	if (n != 2 || !(is(ops[1], R32) || memory(ops[1])))
+	    error();
+
+	if (is(ops[0], R8) && ops[0]._reg == ECX) {
+	    byte(0xd3);
+	    modrm(form._extra, ops[1]);
+	} else if (ops[0]._kind == IMMEDIATE && ops[0]._symbol < 0) {
+	    byte(ops[0]._value == 1 ? 0xd1 : 0xc1);
+	    modrm(form._extra, ops[1]);
+
+	    if (ops[0]._value != 1)
+		byte(ops[0]._value);
+	} else
+	    error();
+
+	break;
+
+    case IMUL:
+	if (n == 1 && (is(ops[0], R32) || memory(ops[0]))) {
+	    byte(0xf7);
+	    modrm(5, ops[0]);
+	} else if (n >= 2 && ops[0]._kind == IMMEDIATE && is(ops[n - 1], R32)) {
+	    const Operand &src = ops[1];
+
+	    if (n == 3 && !(is(src, R32) || memory(src)))
+		error();
+
+	    byte(small(ops[0]) ? 0x6b : 0x69);
+	    modrm(ops[n - 1]._reg, src);
+
+	    if (small(ops[0]))
+		byte(ops[0]._value);
+	    else
+		word(ops[0]._value, ops[0]._symbol);
+	} else if (n == 2 && (is(ops[0], R32) || memory(ops[0])) && is(ops[1], R32))
+	    prefixed(0, form._opcode, ops[1]._reg, ops[0]);
+	else
+	    error();
+
+	break;
+
+    case PUSH:
+	if (n != 1)
+	    error();
+
+	if (ops[0]._kind == IMMEDIATE) {
+	    if (small(ops[0])) {
+		byte(0x6a);
+		byte(ops[0]._value);
+	    } else {
+		byte(0x68);
+		word(ops[0]._value, ops[0]._symbol);
+	    }
+	} else if (is(ops[0], R32))
+	    byte(0x50 + ops[0]._reg);
+	else if (memory(ops[0])) {
+	    byte(0xff);
+	    modrm(6, ops[0]);
+	} else
+	    error();
+
+	break;
+
+    case POP:
+	if (n == 1 && is(ops[0], R32))
+	    byte(0x58 + ops[0]._reg);
+	else if (n == 1 && memory(ops[0])) {
+	    byte(0x8f);
+	    modrm(0, ops[0]);
+	} else
+	    error();
+
+	break;
+
+    case CALL:
+    case JMP:
+    case JCC:
+	if (n != 1)
+	    error();
+
+	if (ops[0]._indirect && form._kind != JCC) {
+	    if (ops[0]._kind == REGISTER && ops[0]._class != R32)
+		error();
+
+	    byte(0xff);
+	    modrm(form._kind == CALL ? 2 : 4, ops[0]);
+	} else if (absolute(ops[0]) && ops[0]._symbol >= 0) {
+	    if (form._kind == CALL) {
+		byte(0xe8);
+		word(ops[0]._value, ops[0]._symbol, true);
+	    } else
+		tail(form._kind == JMP ? JUMP : BRANCH, form._extra, ops[0]._symbol, ops[0]._value);
+	} else
+	    error();
+
+	break;
+
+    case SETCC:
+	if (n != 1 || !(is(ops[0], R8) || memory(ops[0])))
+	    error();
+
+	prefixed(0, 0x90 + form._extra, 0, ops[0]);
+	break;
+
+    case PLAIN:
+	if (n != 0)
+	    error();
+
+	byte(form._opcode);
+	break;
+
+    case RM:
+    case COMPARE:
+	if (n != 2 || !(is(ops[0], form._source) || memory(ops[0])) || !is(ops[1], form._target))
+	    error();
+
+	prefixed(form._prefix, form._opcode, ops[1]._reg, ops[0]);
+
+	if (form._kind == COMPARE)
+	    byte(form._extra);
+
+	break;
+
+    case SHUFFLE:
+	if (n != 3 || ops[0]._kind != IMMEDIATE || ops[0]._symbol >= 0)
+	    error();
+
+	if (!(is(ops[1], XMM) || memory(ops[1])) || !is(ops[2], XMM))
+	    error();
+
+	prefixed(form._prefix, form._opcode, ops[2]._reg, ops[1]);
+	byte(ops[0]._value);
+	break;
+
+    case MOVE:
+	if (n == 2 && (is(ops[0], XMM) || memory(ops[0])) && is(ops[1], XMM))
+	    prefixed(form._prefix, form._opcode, ops[1]._reg, ops[0]);
+	else if (n == 2 && is(ops[0], XMM) && memory(ops[1]))
+	    prefixed(form._prefix, form._extra, ops[0]._reg, ops[1]);
+	else
+	    error();
+
+	break;
+
+    case MOVD:
+	if (n == 2 && (is(ops[0], R32) || memory(ops[0])) && is(ops[1], XMM))
+	    prefixed(form._prefix, form._opcode, ops[1]._reg, ops[0]);
+	else if (n == 2 && is(ops[0], XMM) && (is(ops[1], R32) || memory(ops[1])))
+	    prefixed(form._prefix, form._extra, ops[0]._reg, ops[1]);
+	else
+	    error();
+
+	break;
+
+    case FLOAT:
+	if (n != 1 || !(memory(ops[0]) || (is(ops[0], ST) && form._extra == 3)))
+	    error();
+
+	byte(form._opcode);
+	modrm(form._extra, ops[0]);
+	break;
+    }
+}
+
+
+/*
+ * Function:	instruction (private)
+ *
+ * Description:	Parse the operands of an instruction and encode it.
+ */
+
+static void instruction(const string &mnemonic, const char *p, const char *end)
+{
+    auto it = forms.find(mnemonic);
+    vector<Operand> ops;
+    const char *q, *last;
+    int depth;
+
+
+    if (it == forms.end())
+	error();
+
+    while (end > p && isspace(end[-1]))
+	end --;
+
+    while (p < end) {
+	for (q = p, depth = 0; q < end && (*q != ',' || depth > 0); q ++)
+	    depth += *q == '(' ? 1 : *q == ')' ? -1 : 0;
+
+	for (last = q; last > p && isspace(last[-1]); last --)
+	    continue;
+
+	ops.push_back(operand(p, last));
+	p = q < end ? skip(q + 1, end) : end;
+    }
+
+    encode(it->second, ops);
+}
+
+
+/*
+ * Function:	arguments (private)
+ *
+ * Description:	Split the arguments of a directive at its commas.
+ */
+
+static vector<string> arguments(const char *p, const char *end)
+{
+    vector<string> args;
+    const char *q, *last;
+    bool quoted;
+
+
+    while (end > p && isspace(end[-1]))
+	end --;
+
+    while (p < end) {
+	for (q = p, quoted = false; q < end && (quoted || *q != ','); q ++)
+	    if (*q == '"')
+		quoted = !quoted;
+	    else if (*q == '\\' && quoted && q + 1 < end)
+		q ++;
+
+	for (last = q; last > p && isspace(last[-1]); last --)
+	    continue;
+
+	args.push_back(string(p, last));
+	p = q < end ? skip(q + 1, end) : end;
+    }
+
+    return args;
+}
+
+
+/*
+ * Function:	unquote (private)
+ *
+ * Description:	Add the characters of a quoted string to the current
+ *		fragment, interpreting its escapes as the GNU assembler
+ *		does.
+ */
+
+static void unquote(const string &s)
+{
+    unsigned i, value, digits;
+
+
+    if (s.size() < 2 || s[0] != '"' || s[s.size() - 1] != '"')
+	error();
+
+    for (i = 1; i < s.size() - 1; i ++) {
+	if (s[i] != '\\') {
+	    byte(s[i]);
+	    continue;
+	}
+
+	if (++ i == s.size() - 1)
+	    error();
+
+	if (s[i] >= '0' && s[i] <= '7') {
+	    for (value = digits = 0; digits < 3 && s[i] >= '0' && s[i] <= '7'; digits ++)
+		value = value * 8 + s[i ++] - '0';
+
+	    byte(value);
+	    i --;
+	} else if (s[i] == 'x' && isxdigit(s[i + 1])) {
+	    for (value = 0; isxdigit(s[i + 1]); i ++)
+		value = value * 16 + (isdigit(s[i + 1]) ? s[i + 1] - '0' : tolower(s[i + 1]) - 'a' + 10);
+
+	    byte(value);
+	} else
+	    byte(s[i] == 'b' ? '\b' : s[i] == 'f' ? '\f' : s[i] == 'n' ? '\n' :
+		 s[i] == 'r' ? '\r' : s[i] == 't' ? '\t' : s[i] == 'v' ? '\v' : s[i]);
+    }
+}
+
+
+/*
+ * Function:	align (private)
+ *
+ * Description:	Align the current section to the given number of bytes.
+ */
+
+static void align(unsigned bytes)
+{
+    if (bytes == 0 || (bytes & (bytes - 1)) != 0)
+	error();
+
+    if (bytes > sections[current]._align)
+	sections[current]._align = bytes;
+
+    if (bytes > 1)
+	tail(ALIGN, bytes);
+}
+
+
+/*
+ * Function:	comm (private)
+ *
+ * Description:	Declare a common symbol.  A local one is allocated in the
+ *		uninitialized data section right away, and a global one is
+ *		left for the linker, with a default alignment that is the
+ *		smallest power of two covering its size, up to sixteen.
+ */
+
+static void comm(const vector<string> &args)
+{
+    long size, alignment = 1;
+    int saved = current;
+
+
+    if (args.size() < 2 || args.size() > 3)
+	error();
+
+    ObjectSymbol &symbol = symbols[lookup(args[0])];
+
+    if (symbol._section != UNDEFINED)
+	error();
+
+    number(args[1].c_str(), args[1].c_str() + args[1].size(), size);
+
+    if (args.size() == 3)
+	number(args[2].c_str(), args[2].c_str() + args[2].size(), alignment);
+    else
+	while (alignment < size && alignment < 16)
+	    alignment *= 2;
+
+    symbol._size = size;
+
+    if (!symbol._local) {
+	symbol._section = COMMON;
+	symbol._value = alignment;
+	return;
+    }
+
+    current = BSS;
+    align(alignment);
+    define(args[0]);
+    fragment()._bytes.append(size, '\0');
+    current = saved;
+}
+
+
+/*
+ * Function:	directive (private)
+ *
+ * Description:	Carry out an assembler directive.
+ */
+
+static void directive(const string &name, const char *p, const char *end)
+{
+    vector<string> args = arguments(p, end);
+    int symbol;
+    long value;
+
+
+    if (name == ".text" || name == ".data" || name == ".bss")
+	current = section(name);
+
+    else if (name == ".section") {
+	if (args.empty() || args.size() > 3)
+	    error();
+
+	string flags = args.size() > 1 ? args[1] : "";
+
+	if (!flags.empty() && (flags.size() < 2 || flags[0] != '"' || flags.back() != '"'))
+	    error();
+
+	if (!flags.empty())
+	    flags = flags.substr(1, flags.size() - 2);
+
+	current = section(args[0], flags, args.size() > 2 ? args[2] : "");
+
+    } else if (name == ".globl" || name == ".global" || name == ".local") {
+	for (auto &arg : args)
+	    if (identifier(arg.c_str(), arg.c_str() + arg.size()) != arg.c_str() + arg.size())
+		error();
+	    else if (name == ".local")
+		symbols[lookup(arg)]._local = true;
+	    else
+		symbols[lookup(arg)]._global = true;
+
+    } else if (name == ".comm")
+	comm(args);
+
+    else if (name == ".set" || name == ".equ") {
+	if (args.size() != 2 || args[1].empty())
+	    error();
+
+	expression(args[1].c_str(), args[1].c_str() + args[1].size(), symbol, value);
+	ObjectSymbol &s = symbols[lookup(args[0])];
+
+	if (symbol >= 0 || (s._section != UNDEFINED && s._section != ABSOLUTE))
+	    error();
+
+	s._section = ABSOLUTE;
+	s._value = value;
+
+    } else if (name == ".align" || name == ".balign" || name == ".p2align") {
+	if (args.size() != 1)
+	    error();
+
+	number(args[0].c_str(), args[0].c_str() + args[0].size(), value);
+	align(name == ".p2align" ? 1 << value : value);
+
+    } else if (name == ".long") {
+	for (auto &arg : args) {
+	    if (arg.empty() || expression(arg.c_str(), arg.c_str() + arg.size(), symbol, value) != arg.c_str() + arg.size())
+		error();
+
+	    word(value, symbol);
+	}
+
+    } else if (name == ".double") {
+	for (auto &arg : args) {
+	    double real;
+	    uint64_t bits;
+	    char *q;
+
+	    real = strtod(arg.c_str(), &q);
+
+	    if (arg.empty() || *q != '\0')
+		error();
+
+	    memcpy(&bits, &real, sizeof(bits));
+	    word(bits);
+	    word(bits >> 32);
+	}
+
+    } else if (name == ".asciz" || name == ".string") {
+	for (auto &arg : args) {
+	    unquote(arg);
+	    byte(0);
+	}
+
+    } else
+	error();
+}
+
+
+/*
+ * Function:	statement (private)
+ *
+ * Description:	Assemble a line, which may start with a label.
+ */
+
+static void statement(const char *p, const char *end)
+{
+    const char *q;
+
+
+    q = identifier(p, end);
+
+    if (q > p && q < end && *q == ':') {
+	define(string(p, q));
+	p = q + 1;
+    }
+
+    p = skip(p, end);
+
+    if (p == end || *p == '#')
+	return;
+
+    for (q = p; q < end && !isspace(*q); q ++)
+	continue;
+
+    if (*p == '.')
+	directive(string(p, q), skip(q, end), end);
+    else
+	instruction(string(p, q), skip(q, end), end);
+}
+
+
+/*
+ * Function:	local (private)
+ *
+ * Description:	Return whether a jump may refer directly to the target of a
+ *		fragment in the given section.  A jump to a global or
+ *		undefined symbol, or to another section, is left to the
+ *		linker.
+ */
+
+static bool local(const Fragment &f, int s)
+{
+    return f._symbol >= 0 && symbols[f._symbol]._section == s && !symbols[f._symbol]._global;
+}
+
+
+/*
+ * Function:	address (private)
+ *
+ * Description:	Return the address of a symbol defined in a section, as
+ *		the section is currently laid out.
+ */
+
+static long address(const ObjectSymbol &symbol)
+{
+    return sections[symbol._section]._fragments[symbol._fragment]._address + symbol._offset;
+}
+
+
+/*
+ * Function:	padding (private)
+ *
+ * Description:	Return the number of bytes needed to align an address.
+ */
+
+static unsigned padding(unsigned address, unsigned alignment)
+{
+    return -address & (alignment - 1);
+}
+
+
+/*
+ * Function:	relax (private)
+ *
+ * Description:	Lay out a section, making long each jump whose target is
+ *		out of reach of a byte, until every jump fits.  We relax
+ *		the way the GNU assembler does, so as to choose the same
+ *		jumps.  Each pass moves every fragment by the growth of
+ *		those before it, and assumes that a target not yet reached
+ *		moves by as much, unless an alignment comes between them
+ *		that might absorb the growth.
+ */
+
+static void relax(int s)
+{
+    vector<Fragment> &fragments = sections[s]._fragments;
+    vector<unsigned> regions(fragments.size());
+    unsigned addr, region, was, end;
+    long stretch, growth, target;
+    bool stretched;
+
+
+    addr = region = 0;
+
+    for (unsigned i = 0; i < fragments.size(); i ++) {
+	Fragment &f = fragments[i];
+
+	if ((f._tail == JUMP || f._tail == BRANCH) && !local(f, s))
+	    f._long = true;
+
+	f._address = addr;
+	regions[i] = region;
+	addr += f._bytes.size();
+
+	if (f._tail == JUMP)
+	    addr += f._long ? 5 : 2;
+	else if (f._tail == BRANCH)
+	    addr += f._long ? 6 : 2;
+	else if (f._tail == ALIGN) {
+	    addr += padding(addr, f._extra);
+	    region ++;
+	}
+    }
+
+    do {
+	stretch = 0;
+	stretched = false;
+
+	for (unsigned i = 0; i < fragments.size(); i ++) {
+	    Fragment &f = fragments[i];
+
+	    was = f._address;
+	    f._address += stretch;
+	    end = f._address + f._bytes.size();
+	    growth = 0;
+
+	    if (f._tail == ALIGN)
+		growth = (long) padding(end, f._extra) - padding(was + f._bytes.size(), f._extra);
+
+	    else if ((f._tail == JUMP || f._tail == BRANCH) && !f._long) {
+		const ObjectSymbol &symbol = symbols[f._symbol];
+
+		target = address(symbol) + f._addend;
+
+		if (stretch != 0 && symbol._fragment > i) {
+		    if (stretch < 0 || regions[symbol._fragment] == regions[i])
+			target += stretch;
+		    else if (target < end + 1)
+			continue;
+		}
+
+		if (target - (end + 1) > 128 || target - (end + 1) < -127) {
+		    f._long = true;
+		    growth = f._tail == JUMP ? 3 : 4;
+		}
+	    }
+
+	    if (growth != 0) {
+		stretch += growth;
+		stretched = true;
+	    }
+	}
+
+    } while (stretched);
+}
+
+
+/*
+ * Function:	emit (private)
+ *
+ * Description:	Write out the contents of a section once it has been laid
+ *		out, with its jumps and alignment, gathering its fixups.
+ *		Code is padded with the same no-ops that the GNU assembler
+ *		uses, and data with zeros.
+ */
+
+static void emit(int s)
+{
+    static const char *nops[] = {
+	"", "\x90", "\x66\x90", "\x8d\x76\x00", "\x8d\x74\x26\x00",
+	"\x8d\x74\x26\x00\x90", "\x8d\xb6\x00\x00\x00\x00",
+	"\x8d\xb4\x26\x00\x00\x00\x00"
+    };
+
+    Section &sec = sections[s];
+    string &out = sec._contents;
+    long disp;
+    unsigned n;
+
+
+    current = s;
+
+    for (auto &f : sec._fragments) {
+	for (auto &fixup : f._fixups)
+	    sec._fixups.push_back({(unsigned) out.size() + fixup._offset, fixup._symbol, fixup._relative});
+
+	out += f._bytes;
+
+	if (f._tail == JUMP || f._tail == BRANCH) {
+	    if (f._long && f._tail == JUMP)
+		out += (char) 0xe9;
+	    else if (f._long)
+		out += "\x0f" + string(1, (char) (0x80 + f._extra));
+	    else
+		out += (char) (f._tail == JUMP ? 0xeb : 0x70 + f._extra);
+
+	    if (!f._long) {
+		disp = address(symbols[f._symbol]) + f._addend - (out.size() + 1);
+		out += (char) disp;
+	    } else if (local(f, s)) {
+		disp = address(symbols[f._symbol]) + f._addend - (out.size() + 4);
+
+		for (unsigned i = 0; i < 4; i ++)
+		    out += (char) (disp >> 8 * i);
+	    } else {
+		sec._fixups.push_back({(unsigned) out.size(), f._symbol, true});
+		disp = f._addend - 4;
+
+		for (unsigned i = 0; i < 4; i ++)
+		    out += (char) (disp >> 8 * i);
+	    }
+
+	} else if (f._tail == ALIGN) {
+	    n = -out.size() & (f._extra - 1);
+
+	    if (sec._flags & SHF_EXECINSTR) {
+		for (; n > 7; n -= 7)
+		    out.append(nops[7], 7);
+
+		out.append(nops[n], n);
+	    } else
+		out.append(n, '\0');
+	}
+    }
+}
+
+
+/*
+ * Function:	add (private)
+ *
+ * Description:	Add a value to a word in the contents of a section.
+ */
+
+static void add(string &out, unsigned offset, long value)
+{
+    uint32_t word = 0;
+
+
+    for (unsigned i = 0; i < 4; i ++)
+	word |= (uint32_t) (unsigned char) out[offset + i] << 8 * i;
+
+    word += value;
+
+    for (unsigned i = 0; i < 4; i ++)
+	out[offset + i] = word >> 8 * i;
+}
+
+
+/*
+ * Function:	resolve (private)
+ *
+ * Description:	Resolve the fixups of a section.  A reference to a local
+ *		symbol becomes one to its section, with the address of the
+ *		symbol added in place, unless it is relative and in the
+ *		same section, when it needs no relocation at all.  A
+ *		reference to any other symbol is left to the linker.
+ */
+
+static void resolve(int s)
+{
+    Section &sec = sections[s];
+
+
+    for (auto &fixup : sec._fixups) {
+	ObjectSymbol &symbol = symbols[fixup._symbol];
+	int type = fixup._relative ? R_386_PC32 : R_386_32;
+
+	if (symbol._section == ABSOLUTE && !fixup._relative)
+	    add(sec._contents, fixup._offset, symbol._value);
+
+	else if (symbol._section >= 0 && !symbol._global) {
+	    if (fixup._relative && symbol._section == s)
+		add(sec._contents, fixup._offset, symbol._value - fixup._offset);
+	    else {
+		add(sec._contents, fixup._offset, symbol._value);
+		sec._relocations.push_back({fixup._offset, sections[symbol._section]._symbol, type});
+		symbols[sections[symbol._section]._symbol]._used = true;
+	    }
+
+	} else if (symbol._section != ABSOLUTE)
+	    sec._relocations.push_back({fixup._offset, fixup._symbol, type});
+
+	else {
+	    cerr << "scc: cannot relocate '" << symbol._name << "'" << endl;
+	    exit(EXIT_FAILURE);
+	}
+    }
+}
+
+
+/*
+ * Function:	half (private)
+ *
+ * Description:	Append a 16-bit value in little-endian order.
+ */
+
+static void half(string &out, unsigned value)
+{
+    out += (char) value;
+    out += (char) (value >> 8);
+}
+
+
+/*
+ * Function:	word (private)
+ *
+ * Description:	Append a 32-bit value in little-endian order.
+ */
+
+static void word(string &out, uint32_t value)
+{
+    half(out, value);
+    half(out, value >> 16);
+}
+
+
+/*
+ * Function:	pad (private)
+ *
+ * Description:	Pad a file to the given alignment and return its size.
+ */
+
+static unsigned pad(string &out, unsigned alignment)
+{
+    out.append(-out.size() & (alignment - 1), '\0');
+    return out.size();
+}
+
+
+/*
+ * Function:	header (private)
+ *
+ * Description:	Append a section header.
+ */
+
+static void header(string &out, unsigned name, unsigned type, unsigned flags,
+	unsigned offset, unsigned size, unsigned link, unsigned info,
+	unsigned alignment, unsigned entsize)
+{
+    word(out, name);
+    word(out, type);
+    word(out, flags);
+    word(out, 0);
+    word(out, offset);
+    word(out, size);
+    word(out, link);
+    word(out, info);
+    word(out, alignment);
+    word(out, entsize);
+}
+
+
+/*
+ * Function:	object (private)
+ *
+ * Description:	Write the object file.  Each section is followed by its
+ *		relocations, if it has any, and then come the symbol
+ *		table, its names, and the names of the sections.  The
+ *		local symbols come first, including those of sections that
+ *		relocations refer to, followed by the global ones.
+ */
+
+static string object()
+{
+    string out(ELF_HEADER, '\0'), symtab, strtab(1, '\0'), shstrtab(1, '\0');
+    string headers(SECTION_HEADER, '\0');
+    vector<int> order;
+    unsigned index, locals, name, symoff, stroff, shstroff, shoff;
+
+
+    index = 1;
+
+    for (auto &sec : sections) {
+	sec._index = index ++;
+	index += !sec._relocations.empty();
+    }
+
+    for (int pass = 0; pass < 2; pass ++)
+	for (unsigned i = 0; i < symbols.size(); i ++) {
+	    const ObjectSymbol &symbol = symbols[i];
+
+	    if (symbol._isSection ? pass == 0 && symbol._used :
+		    symbol._global == (pass == 1) && !temporary(symbol._name))
+		order.push_back(i);
+	}
+
+    word(symtab, 0);
+    word(symtab, 0);
+    word(symtab, 0);
+    word(symtab, 0);
+    locals = 1;
+
+    for (unsigned i = 0; i < order.size(); i ++) {
+	ObjectSymbol &symbol = symbols[order[i]];
+	unsigned shndx, type = STT_NOTYPE;
+
+	symbol._index = i + 1;
+	locals += !symbol._global;
+
+	if (symbol._section == UNDEFINED)
+	    shndx = 0;
+	else if (symbol._section == ABSOLUTE)
+	    shndx = SHN_ABS;
+	else if (symbol._section == COMMON)
+	    shndx = SHN_COMMON;
+	else
+	    shndx = sections[symbol._section]._index;
+
+	if (symbol._isSection)
+	    type = STT_SECTION;
+	else if (symbol._section == COMMON || symbol._size > 0 || symbol._local)
+	    type = STT_OBJECT;
+
+	word(symtab, symbol._isSection ? 0 : strtab.size());
+	word(symtab, symbol._isSection ? 0 : symbol._value);
+	word(symtab, symbol._size);
+	symtab += (char) ((symbol._global ? STB_GLOBAL : STB_LOCAL) << 4 | type);
+	symtab += '\0';
+	half(symtab, shndx);
+
+	if (!symbol._isSection)
+	    strtab += symbol._name + '\0';
+    }
+
+    for (auto &sec : sections) {
+	string relocations;
+
+	header(headers, shstrtab.size(), sec._type, sec._flags,
+	       pad(out, sec._align), sec._contents.size(), 0, 0, sec._align, sec._entsize);
+	shstrtab += sec._name + '\0';
+
+	if (sec._type != SHT_NOBITS)
+	    out += sec._contents;
+
+	if (sec._relocations.empty())
+	    continue;
+
+	for (auto &r : sec._relocations) {
+	    word(relocations, r._offset);
+	    word(relocations, symbols[r._symbol]._index << 8 | r._type);
+	}
+
+	header(headers, shstrtab.size(), SHT_REL, SHF_INFO_LINK, pad(out, 4),
+	       relocations.size(), index, sec._index, 4, REL_ENTRY);
+	shstrtab += ".rel" + sec._name + '\0';
+	out += relocations;
+    }
+
+    symoff = pad(out, 4);
+    out += symtab;
+    stroff = out.size();
+    out += strtab;
+    shstroff = out.size();
+    header(headers, shstrtab.size(), SHT_SYMTAB, 0, symoff, symtab.size(), index + 1, locals, 4, SYMBOL_ENTRY);
+    shstrtab += ".symtab";
+    shstrtab += '\0';
+    header(headers, shstrtab.size(), SHT_STRTAB, 0, stroff, strtab.size(), 0, 0, 1, 0);
+    shstrtab += ".strtab";
+    shstrtab += '\0';
+    name = shstrtab.size();
+    shstrtab += ".shstrtab";
+    shstrtab += '\0';
+    header(headers, name, SHT_STRTAB, 0, shstroff, shstrtab.size(), 0, 0, 1, 0);
+    out += shstrtab;
+
+    shoff = pad(out, 4);
+    out += headers;
+
+    out.replace(0, 16, string("\177ELF\1\1\1", 7) + string(9, '\0'));
+    string fields;
+    half(fields, 1);
+    half(fields, 3);
+    word(fields, 1);
+    word(fields, 0);
+    word(fields, 0);
+    word(fields, shoff);
+    word(fields, 0);
+    half(fields, ELF_HEADER);
+    half(fields, 0);
+    half(fields, 0);
+    half(fields, SECTION_HEADER);
+    half(fields, headers.size() / SECTION_HEADER);
+    half(fields, index + 2);
+    out.replace(16, fields.size(), fields);
+
+    return out;
+}
+
+
+/*
+ * Function:	assemble
+ *
+ * Description:	Assemble the text written by the compiler and return an
+ *		ELF relocatable object file.
+ */
+
+string assemble(const string &text)
+{
+    const char *p, *end;
+
+
+    sections.clear();
+    symbols.clear();
+    names.clear();
+
+    if (forms.empty())
+	initialize();
+
+    section(".text");
+    section(".data");
+    section(".bss");
+    current = TEXT;
+
+    limit = text.data() + text.size();
+
+    for (p = text.data(); p < limit; p = end + 1) {
+	end = (const char *) memchr(p, '\n', limit - p);
+
+	if (end == nullptr)
+	    end = limit;
+
+	line = p;
+	statement(p, end);
+    }
+
+    line = limit;
+
+    for (auto &symbol : symbols)
+	if (!symbol._isSection && symbol._section == UNDEFINED) {
+	    if (temporary(symbol._name)) {
+		cerr << "scc: undefined label '" << symbol._name << "'" << endl;
+		exit(EXIT_FAILURE);
+	    }
+
+	    symbol._global = true;
+	} else if (symbol._section == COMMON)
+	    symbol._global = true;
+
+    for (unsigned i = 0; i < sections.size(); i ++)
+	relax(i);
+
+    for (auto &symbol : symbols)
+	if (symbol._section >= 0 && !symbol._isSection)
+	    symbol._value = address(symbol);
+
+    for (unsigned i = 0; i < sections.size(); i ++) {
+	emit(i);
+	resolve(i);
+    }
+
+    return object();
+}
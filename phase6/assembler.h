@@ -0,0 +1,14 @@
+/*
+ * File:	assembler.h
+ *
+ * Description:	This file contains the function declaration for assembling
+ *		the output of the compiler into a relocatable object file.
+ */
+
+# ifndef ASSEMBLER_H
+# define ASSEMBLER_H
+# include <string>
+
+std::string assemble(const std::string &text);
+
+# endif /* ASSEMBLER_H */
@@ -0,0 +1,132 @@
+#!/bin/sh
+#
+# File:		bench.sh
+#
+# Description:	This file contains the harness for the runtime benchmarks.
+#		Each kernel is compiled with scc, assembled and linked with
+#		the system toolchain, checked against its expected output,
+#		and run several times.  We report the median time, the
+#		number of instructions in the assembly, and the size of the
+#		text, together with the figures recorded in the baseline for
+#		the same flags and the median times of the same kernel as
+#		compiled by gcc at -O0 and -O2.
+#
+#		usage: bench.sh [-s] [kernel ...]
+#
+#		The -s option replaces the baseline for the current flags
+#		with the results.  The environment may override SCC,
+#		SCCFLAGS, CC, LDLIBS, RUNS, and BASELINE.
+#
+
+SCC=${SCC:-../scc}
+SCCFLAGS=${SCCFLAGS:--O2}
+CC=${CC:-gcc -m32}
+LDLIBS=${LDLIBS:--lm}
+RUNS=${RUNS:-5}
+BASELINE=${BASELINE:-baseline}
+
+save=no
+key=$(echo "$SCCFLAGS" | tr ' ' ',')
+work=$(mktemp -d)
+trap 'rm -rf "$work"' 0
+
+if [ "$1" = -s ]; then
+    save=yes
+    shift
+fi
+
+if [ $# -eq 0 ]; then
+    set -- $(ls *.c | sed 's/\.c$//')
+fi
+
+
+# Run a program RUNS times and print its median time in milliseconds, or
+# "wrong" if its output differs from the expected output.
+
+median()
+{
+    i=0
+    : > "$work/times"
+
+    while [ $i -lt "$RUNS" ]; do
+	start=$(date +%s%N)
+	"$1" > "$work/actual" 2>/dev/null
+	stop=$(date +%s%N)
+
+	if ! cmp -s "$work/actual" "$2"; then
+	    echo wrong
+	    return
+	fi
+
+	echo $(( (stop - start) / 1000000 )) >> "$work/times"
+	i=$((i + 1))
+    done
+
+    sort -n "$work/times" | sed -n "$(( (RUNS + 1) / 2 ))p"
+}
+
+
+# Print the figure in the given column of the baseline for a kernel, or
+# a dash if there is none.
+
+baseline()
+{
+    awk -v key="$key" -v name="$1" -v col="$2" '
+	$1 == key && $2 == name { print $col; found = 1 }
+	END { if (!found) print "-" }' "$BASELINE" 2>/dev/null || echo -
+}
+
+
+# Print the change from one figure to another as a percentage.
+
+change()
+{
+    case "$1$2" in
+    *-*|*wrong*|*failed*)
+	echo - ;;
+    *)
+	awk -v old="$1" -v new="$2" 'BEGIN {
+	    if (old == 0) print "-"; else printf "%+.1f%%\n", 100 * (new - old) / old }' ;;
+    esac
+}
+
+
+printf "scc %s, median of %d runs\n\n" "$SCCFLAGS" "$RUNS"
+printf "%-10s %8s %8s %8s %7s %8s %7s %8s %8s\n" kernel ms change \
+    insns change text change gcc-O0 gcc-O2
+
+for name in "$@"; do
+    ms=failed insns=- text=-
+
+    if $SCC $SCCFLAGS < "$name.c" > "$work/$name.s" 2> "$work/errors" &&
+	    $CC -c -o "$work/$name.o" "$work/$name.s" 2>> "$work/errors" &&
+	    $CC -o "$work/$name" "$work/$name.o" $LDLIBS 2>> "$work/errors"; then
+	insns=$(grep -c '^	[a-z]' "$work/$name.s")
+	text=$(size -A "$work/$name.o" | awk '$1 ~ /^\.text/ { n += $2 } END { print n + 0 }')
+	ms=$(median "$work/$name" "$name.out")
+    else
+	sed -n "1,3s/^/$name: /p" "$work/errors" >&2
+    fi
+
+    for level in 0 2; do
+	if $CC -O$level -std=gnu89 -fno-builtin -w -o "$work/$name.gcc" "$name.c" $LDLIBS 2>/dev/null; then
+	    eval gcc$level=$(median "$work/$name.gcc" "$name.out")
+	else
+	    eval gcc$level=failed
+	fi
+    done
+
+    printf "%-10s %8s %8s %8s %7s %8s %7s %8s %8s\n" "$name" \
+	"$ms" "$(change "$(baseline "$name" 3)" "$ms")" \
+	"$insns" "$(change "$(baseline "$name" 4)" "$insns")" \
+	"$text" "$(change "$(baseline "$name" 5)" "$text")" "$gcc0" "$gcc2"
+
+    echo "$key $name $ms $insns $text" >> "$work/results"
+done
+
+if [ $save = yes ]; then
+    touch "$BASELINE"
+    awk -v key="$key" '$1 != key' "$BASELINE" | cat - "$work/results" |
+	sort -k1,1 -k2,2 > "$work/baseline"
+    cp "$work/baseline" "$BASELINE"
+fi
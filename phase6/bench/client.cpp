@@ -0,0 +1,150 @@
+/*
+ * File:	client.cpp
+ *
+ * Description:	This file contains a client for the compile server that
+ *		scc runs with --server=socket.  It sends the standard input
+ *		with the given options, writes the assembly to the standard
+ *		output and the diagnostics to the standard error, and exits
+ *		with the status of the compilation.  A count repeats the
+ *		request over the same connection, for measuring the server
+ *		against starting scc afresh for each file.
+ *
+ *		usage: client [-n count] socket [option ...] < file.c
+ */
+
+# include <string>
+# include <vector>
+# include <cstdint>
+# include <cstdlib>
+# include <iostream>
+# include <iterator>
+# include <unistd.h>
+# include <sys/un.h>
+# include <sys/socket.h>
+
+using namespace std;
+
+
+/*
+ * Function:	transfer
+ *
+ * Description:	Read or write exactly the given number of bytes, and
+ *		exit if we cannot.
+ */
+
+static void transfer(int fd, char *buf, size_t n, bool reading)
+{
+    ssize_t done;
+
+    while (n > 0) {
+	done = reading ? read(fd, buf, n) : write(fd, buf, n);
+
+	if (done <= 0) {
+	    cerr << "client: lost the server" << endl;
+	    exit(EXIT_FAILURE);
+	}
+
+	buf += done;
+	n -= done;
+    }
+}
+
+
+/*
+ * Function:	send
+ *
+ * Description:	Write a number or a string to the server.
+ */
+
+static void send(int fd, uint32_t word)
+{
+    unsigned char bytes[4] = {
+	(unsigned char) word, (unsigned char) (word >> 8),
+	(unsigned char) (word >> 16), (unsigned char) (word >> 24)
+    };
+
+    transfer(fd, (char *) bytes, 4, false);
+}
+
+static void send(int fd, const string &s)
+{
+    send(fd, s.size());
+    transfer(fd, (char *) s.data(), s.size(), false);
+}
+
+
+/*
+ * Function:	receive
+ *
+ * Description:	Read a number or a string from the server.
+ */
+
+static uint32_t receive(int fd)
+{
+    unsigned char bytes[4];
+
+    transfer(fd, (char *) bytes, 4, true);
+    return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+}
+
+static void receive(int fd, string &s)
+{
+    s.resize(receive(fd));
+    transfer(fd, &s[0], s.size(), true);
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Connect to the server and send the request.
+ */
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_un address;
+    string source, output, errors;
+    unsigned count = 1;
+    uint32_t status = 0;
+    int fd, i = 1;
+
+
+    if (argc > 2 && string(argv[1]) == "-n") {
+	count = strtoul(argv[2], NULL, 10);
+	i = 3;
+    }
+
+    if (i >= argc || string(argv[i]).size() >= sizeof(address.sun_path)) {
+	cerr << "usage: client [-n count] socket [option ...] < file.c" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    address.sun_family = AF_UNIX;
+    string(argv[i]).copy(address.sun_path, sizeof(address.sun_path));
+    address.sun_path[string(argv[i ++]).size()] = '\0';
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+	    connect(fd, (struct sockaddr *) &address, sizeof(address)) < 0) {
+	cerr << "client: cannot connect to '" << address.sun_path << "'" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    source.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+
+    while (count -- > 0) {
+	send(fd, argc - i);
+
+	for (int j = i; j < argc; j ++)
+	    send(fd, argv[j]);
+
+	send(fd, source);
+	status = receive(fd);
+	receive(fd, output);
+	receive(fd, errors);
+    }
+
+    cout << output;
+    cerr << errors;
+    close(fd);
+    return status;
+}
@@ -0,0 +1,109 @@
+/* matmul.c */
+
+int *malloc(int n);
+
+int **allocate(int n)
+{
+    int i;
+    int **a;
+
+    i = 0;
+    a = (int **) malloc(n * sizeof(int *));
+
+    while (i < n) {
+	a[i] = malloc(n * sizeof(int));
+	i = i + 1;
+    }
+
+    return a;
+}
+
+int fill(int **a, int n, int seed)
+{
+    int i, j;
+
+    i = 0;
+
+    while (i < n) {
+	j = 0;
+
+	while (j < n) {
+	    a[i][j] = (i * seed + j * 7 + 3) % 19 - 9;
+	    j = j + 1;
+	}
+
+	i = i + 1;
+    }
+}
+
+int multiply(int **c, int **a, int **b, int n)
+{
+    int i, j, k, sum;
+    int *row;
+
+    i = 0;
+
+    while (i < n) {
+	row = a[i];
+	j = 0;
+
+	while (j < n) {
+	    sum = 0;
+	    k = 0;
+
+	    while (k < n) {
+		sum = sum + row[k] * b[k][j];
+		k = k + 1;
+	    }
+
+	    c[i][j] = sum;
+	    j = j + 1;
+	}
+
+	i = i + 1;
+    }
+}
+
+int checksum(int **a, int n)
+{
+    int i, j, sum;
+
+    i = 0;
+    sum = 0;
+
+    while (i < n) {
+	j = 0;
+
+	while (j < n) {
+	    sum = (sum * 31 + a[i][j]) % 1000003;
+	    j = j + 1;
+	}
+
+	i = i + 1;
+    }
+
+    return sum;
+}
+
+int main(void)
+{
+    int **a, **b, **c;
+    int n, round;
+
+    n = 160;
+    a = allocate(n);
+    b = allocate(n);
+    c = allocate(n);
+    fill(a, n, 5);
+    fill(b, n, 11);
+    round = 0;
+
+    while (round < 4) {
+	multiply(c, a, b, n);
+	multiply(a, c, b, n);
+	fill(a, n, checksum(a, n) % 17 + 1);
+	round = round + 1;
+    }
+
+    printf("%d\n", checksum(c, n));
+}
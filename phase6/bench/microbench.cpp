@@ -0,0 +1,436 @@
+/*
+ * File:	microbench.cpp
+ *
+ * Description:	This file contains microbenchmarks of the primitives that
+ *		the compiler uses most, each timed in isolation so that a
+ *		change to one of them can be judged apart from the time to
+ *		compile a whole program.
+ *
+ *		Each benchmark performs some number of operations per
+ *		trial.  After a warmup trial, we run several trials and
+ *		report the median and the fastest time per operation.
+ *		Results are accumulated into a sink so that the work cannot
+ *		be optimized away.
+ *
+ *		usage: microbench [name ...]
+ *
+ *		Only the benchmarks whose names begin with one of the given
+ *		names are run, so that "scope" runs every scope size.
+ */
+
+# include <chrono>
+# include <string>
+# include <vector>
+# include <sstream>
+# include <iomanip>
+# include <iostream>
+# include <algorithm>
+# include "Tree.h"
+# include "Type.h"
+# include "Label.h"
+# include "Scope.h"
+# include "lexer.h"
+# include "tokens.h"
+# include "scanner.h"
+# include "Register.h"
+
+using namespace std;
+using namespace std::chrono;
+
+# define WARMUP 1
+# define TRIALS 7
+
+static vector<string> selected;
+static volatile unsigned long sink;
+
+
+/*
+ * Function:	wanted (private)
+ *
+ * Description:	Return whether the named benchmark was selected.
+ */
+
+static bool wanted(const string &name)
+{
+    if (selected.empty())
+	return true;
+
+    for (unsigned i = 0; i < selected.size(); i ++)
+	if (name.compare(0, selected[i].size(), selected[i]) == 0)
+	    return true;
+
+    return false;
+}
+
+
+/*
+ * Function:	measure (private)
+ *
+ * Description:	Run a benchmark that performs the given number of
+ *		operations per trial, and report its time per operation.
+ */
+
+template <class Body>
+static void measure(const string &name, unsigned long ops, Body body)
+{
+    vector<double> times;
+
+
+    if (!wanted(name))
+	return;
+
+    for (unsigned i = 0; i < WARMUP; i ++)
+	sink += body();
+
+    for (unsigned i = 0; i < TRIALS; i ++) {
+	steady_clock::time_point start = steady_clock::now();
+
+	sink += body();
+	times.push_back(duration<double, nano>(steady_clock::now() - start).count() / ops);
+    }
+
+    sort(times.begin(), times.end());
+    cout << left << setw(24) << name << right << fixed << setprecision(1);
+    cout << setw(12) << times[TRIALS / 2] << setw(12) << times[0];
+    cout << setw(12) << ops << endl;
+}
+
+
+/*
+ * Function:	source (private)
+ *
+ * Description:	Return a buffer of Simple C source with a mix of tokens
+ *		typical of real programs.
+ */
+
+static string source()
+{
+    stringstream ss;
+
+    for (unsigned i = 0; i < 2000; i ++) {
+	ss << "int function" << i << "(int *a, double b)" << endl;
+	ss << "{" << endl;
+	ss << "    int i, sum;" << endl << endl;
+	ss << "    /* add them up */" << endl;
+	ss << "    i = 0;" << endl;
+	ss << "    sum = 0;" << endl << endl;
+	ss << "    while (i < " << i << " && a[i] != 0) {" << endl;
+	ss << "\tsum = sum + a[i] * 3 - b / 2.5;" << endl;
+	ss << "\ti = i + 1;" << endl;
+	ss << "    }" << endl << endl;
+	ss << "    printf(\"%d\\n\", sum);" << endl;
+	ss << "    return sum >= 0 || -sum <= 10;" << endl;
+	ss << "}" << endl << endl;
+    }
+
+    return ss.str();
+}
+
+
+/*
+ * Function:	benchLexer (private)
+ *
+ * Description:	Time the lexical analyzer over a buffer in memory, with
+ *		each of the scanning kernels that the processor supports,
+ *		and tokenizing it all up front on various numbers of
+ *		threads.
+ */
+
+static void benchLexer()
+{
+    string text = source();
+    Token token;
+    unsigned long tokens = 0;
+    streambuf *saved = cin.rdbuf();
+    vector<string> names = scanners();
+    stringbuf buffer;
+
+
+    buffer.str(text);
+    cin.rdbuf(&buffer);
+
+    while (lexan(token) != DONE)
+	tokens ++;
+
+    for (unsigned i = 0; i < names.size(); i ++) {
+	selectScanner(names[i]);
+
+	measure("lexan-" + names[i], tokens, [&]() {
+	    unsigned long n = 0;
+
+	    buffer.str(text);
+	    cin.clear();
+	    resetLexer();
+
+	    while (lexan(token) != DONE)
+		n ++;
+
+	    return n;
+	});
+    }
+
+    selectScanner(names[0]);
+
+    for (unsigned threads = 1; threads <= 8; threads *= 2)
+	measure("tokenize-" + to_string(threads), tokens, [&]() {
+	    buffer.str(text);
+	    cin.clear();
+	    tokenize(threads);
+	    return threads;
+	});
+
+    cin.rdbuf(saved);
+    cin.clear();
+}
+
+
+/*
+ * Function:	benchScopes (private)
+ *
+ * Description:	Time finding a symbol in scopes of various sizes, and
+ *		looking up a symbol declared in the outermost of various
+ *		numbers of nested scopes.
+ */
+
+static void benchScopes()
+{
+    vector<string> names;
+    string missing = "missing", outer = "outer";
+    unsigned long ops;
+    Scope *scope;
+
+
+    for (unsigned size = 10; size <= 10000; size *= 10) {
+	scope = new Scope();
+	ops = 1000000 / size;
+	names.clear();
+
+	for (unsigned i = 0; i < size; i ++) {
+	    names.push_back("name" + to_string(i));
+	    scope->insert(new Symbol(names.back(), Type(INT)));
+	}
+
+	measure("scope-find-" + to_string(size), ops, [&]() {
+	    unsigned long n = 0;
+
+	    for (unsigned i = 0; i < ops; i ++)
+		n += scope->find(names[i * 7919 % size]) != nullptr;
+
+	    return n;
+	});
+
+	measure("scope-miss-" + to_string(size), ops, [&]() {
+	    unsigned long n = 0;
+
+	    for (unsigned i = 0; i < ops; i ++)
+		n += scope->find(missing) != nullptr;
+
+	    return n;
+	});
+    }
+
+    for (unsigned depth = 1; depth <= 1000; depth *= 10) {
+	scope = new Scope();
+	ops = 1000000 / depth;
+	scope->insert(new Symbol(outer, Type(INT)));
+
+	for (unsigned i = 1; i < depth; i ++) {
+	    scope = new Scope(scope);
+	    scope->insert(new Symbol("inner" + to_string(i), Type(INT)));
+	}
+
+	measure("scope-lookup-" + to_string(depth), ops, [&]() {
+	    unsigned long n = 0;
+
+	    for (unsigned i = 0; i < ops; i ++)
+		n += scope->lookup(outer) != nullptr;
+
+	    return n;
+	});
+    }
+}
+
+
+/*
+ * Function:	benchTypes (private)
+ *
+ * Description:	Time comparing, promoting, and dereferencing types.
+ */
+
+static void benchTypes()
+{
+    Parameters *params = new Parameters {Type(INT, 1), Type(DOUBLE), Type(CHAR, 2)};
+    vector<Type> types = {
+	Type(INT), Type(INT, 1), Type(DOUBLE), Type(CHAR, 0, 10),
+	Type(INT, 0, params), Type(INT, 0, new Parameters(*params)),
+	Type(CHAR), Type(DOUBLE, 2),
+    };
+
+
+    measure("type-equal", 1000000, [&]() {
+	unsigned long n = 0;
+
+	for (unsigned i = 0; i < 1000000; i ++)
+	    n += types[i % 8] == types[(i / 8) % 8];
+
+	return n;
+    });
+
+    measure("type-promote", 1000000, [&]() {
+	unsigned long n = 0;
+
+	for (unsigned i = 0; i < 1000000; i ++)
+	    n += types[i % 4 + 3].promote().indirection();
+
+	return n;
+    });
+
+    measure("type-deref", 1000000, [&]() {
+	unsigned long n = 0;
+
+	for (unsigned i = 0; i < 1000000; i ++)
+	    n += types[i % 2 ? 1 : 7].deref().indirection();
+
+	return n;
+    });
+}
+
+
+/*
+ * Function:	benchOperands (private)
+ *
+ * Description:	Time writing registers and labels as operands.
+ */
+
+static void benchOperands()
+{
+    Register *eax = new Register("%eax", "%al");
+    Expression *expr = new Integer(0);
+    Label label;
+
+
+    measure("register", 1000000, [&]() {
+	stringstream ss;
+
+	for (unsigned i = 0; i < 1000000; i ++) {
+	    eax->_node = i % 2 ? expr : nullptr;
+	    ss << eax;
+	}
+
+	return ss.str().size();
+    });
+
+    measure("label", 1000000, [&]() {
+	stringstream ss;
+
+	for (unsigned i = 0; i < 1000000; i ++)
+	    ss << label;
+
+	return ss.str().size();
+    });
+
+    measure("label-string", 100000, [&]() {
+	unsigned long n = 0;
+
+	for (unsigned i = 0; i < 100000; i ++) {
+	    stringstream ss;
+
+	    ss << label;
+	    n += ss.str().size();
+	}
+
+	return n;
+    });
+}
+
+
+/*
+ * Function:	benchTrees (private)
+ *
+ * Description:	Time writing a large function and allocating its storage,
+ *		each per node.  The function is
+ *		shaped like those written by bench/stress, with a block
+ *		nested in an if-then-else every few statements.
+ */
+
+static void benchTrees()
+{
+    Parameters *params = new Parameters {Type(INT), Type(INT)};
+    Symbol *id = new Symbol("f", Type(INT, 0, params));
+    Symbol *a = new Symbol("a", Type(INT)), *b = new Symbol("b", Type(INT));
+    Symbol *x = new Symbol("x", Type(INT));
+    Scope *decls = new Scope();
+    Statements stmts;
+    Function *tree;
+    Block *body;
+    unsigned long nodes;
+
+
+    decls->insert(a);
+    decls->insert(b);
+    decls->insert(x);
+
+    for (unsigned i = 0; i < 2000; i ++) {
+	Expression *expr = new Multiply(new Identifier(b), new Integer(i), Type(INT));
+
+	stmts.push_back(new Assignment(new Identifier(x),
+	    new Add(new Identifier(a), expr, Type(INT))));
+
+	if (i % 4 == 0) {
+	    Scope *inner = new Scope(decls);
+	    Symbol *y = new Symbol("y" + to_string(i), Type(INT));
+	    Statements body;
+
+	    inner->insert(y);
+	    body.push_back(new Assignment(new Identifier(y),
+		new Subtract(new Identifier(x), new Identifier(a), Type(INT))));
+	    body.push_back(new Return(new Identifier(y)));
+
+	    stmts.push_back(new If(new LessThan(new Identifier(x), new Integer(i), Type(INT)),
+		new Block(inner, body), new Assignment(new Identifier(x), new Identifier(b))));
+	}
+    }
+
+    body = new Block(decls, stmts);
+    nodes = Node::allocated();
+    tree = new Function(id, body);
+
+    measure("tree-write", nodes, [&]() {
+	stringstream ss;
+
+	tree->write(ss);
+	return ss.str().size();
+    });
+
+    measure("tree-allocate", nodes, [&]() {
+	int offset = 8;
+
+	tree->allocate(offset);
+	return -offset;
+    });
+
+    Node::reclaim();
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Run the selected benchmarks.
+ */
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i ++)
+	selected.push_back(argv[i]);
+
+    cout << left << setw(24) << "benchmark" << right << setw(12) << "ns/op";
+    cout << setw(12) << "fastest" << setw(12) << "ops" << endl;
+
+    benchLexer();
+    benchScopes();
+    benchTypes();
+    benchOperands();
+    benchTrees();
+    return 0;
+}
@@ -0,0 +1,140 @@
+/* nbody.c */
+
+double sqrt(double x);
+
+double x[5], y[5], z[5], vx[5], vy[5], vz[5], mass[5];
+
+int initialize(void)
+{
+    double pi, solar, days;
+    int i;
+
+    pi = 3.141592653589793;
+    solar = 4 * pi * pi;
+    days = 365.24;
+
+    x[0] = 0; y[0] = 0; z[0] = 0;
+    vx[0] = 0; vy[0] = 0; vz[0] = 0;
+    mass[0] = solar;
+
+    x[1] = 4.84143144246472090;
+    y[1] = -1.16032004402742839;
+    z[1] = -0.103622044471123109;
+    vx[1] = 0.00166007664274403694 * days;
+    vy[1] = 0.00769901118419740425 * days;
+    vz[1] = -0.0000690460016972063023 * days;
+    mass[1] = 0.000954791938424326609 * solar;
+
+    x[2] = 8.34336671824457987;
+    y[2] = 4.12479856412430479;
+    z[2] = -0.403523417114321381;
+    vx[2] = -0.00276742510726862411 * days;
+    vy[2] = 0.00499852801234917238 * days;
+    vz[2] = 0.0000230417297573763929 * days;
+    mass[2] = 0.000285885980666130812 * solar;
+
+    x[3] = 12.8943695621391310;
+    y[3] = -15.1111514016986312;
+    z[3] = -0.223307578892655734;
+    vx[3] = 0.00296460137564761618 * days;
+    vy[3] = 0.00237847173959480950 * days;
+    vz[3] = -0.0000296589568540237556 * days;
+    mass[3] = 0.0000436624404335156298 * solar;
+
+    x[4] = 15.3796971148509165;
+    y[4] = -25.9193146099879641;
+    z[4] = 0.179258772950371181;
+    vx[4] = 0.00268067772490389322 * days;
+    vy[4] = 0.00162824170038242295 * days;
+    vz[4] = -0.0000951592254519715870 * days;
+    mass[4] = 0.0000515138902046611451 * solar;
+
+    i = 1;
+
+    while (i < 5) {
+	vx[0] = vx[0] - vx[i] * mass[i] / solar;
+	vy[0] = vy[0] - vy[i] * mass[i] / solar;
+	vz[0] = vz[0] - vz[i] * mass[i] / solar;
+	i = i + 1;
+    }
+}
+
+double energy(void)
+{
+    double e, dx, dy, dz;
+    int i, j;
+
+    e = 0;
+    i = 0;
+
+    while (i < 5) {
+	e = e + 0.5 * mass[i] * (vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]);
+	j = i + 1;
+
+	while (j < 5) {
+	    dx = x[i] - x[j];
+	    dy = y[i] - y[j];
+	    dz = z[i] - z[j];
+	    e = e - mass[i] * mass[j] / sqrt(dx * dx + dy * dy + dz * dz);
+	    j = j + 1;
+	}
+
+	i = i + 1;
+    }
+
+    return e;
+}
+
+int advance(double dt)
+{
+    double dx, dy, dz, d2, mag;
+    int i, j;
+
+    i = 0;
+
+    while (i < 5) {
+	j = i + 1;
+
+	while (j < 5) {
+	    dx = x[i] - x[j];
+	    dy = y[i] - y[j];
+	    dz = z[i] - z[j];
+	    d2 = dx * dx + dy * dy + dz * dz;
+	    mag = dt / (d2 * sqrt(d2));
+	    vx[i] = vx[i] - dx * mass[j] * mag;
+	    vy[i] = vy[i] - dy * mass[j] * mag;
+	    vz[i] = vz[i] - dz * mass[j] * mag;
+	    vx[j] = vx[j] + dx * mass[i] * mag;
+	    vy[j] = vy[j] + dy * mass[i] * mag;
+	    vz[j] = vz[j] + dz * mass[i] * mag;
+	    j = j + 1;
+	}
+
+	i = i + 1;
+    }
+
+    i = 0;
+
+    while (i < 5) {
+	x[i] = x[i] + dt * vx[i];
+	y[i] = y[i] + dt * vy[i];
+	z[i] = z[i] + dt * vz[i];
+	i = i + 1;
+    }
+}
+
+int main(void)
+{
+    int step;
+
+    initialize();
+    printf("%f\n", energy());
+    step = 0;
+
+    while (step < 400000) {
+	advance(0.01);
+	step = step + 1;
+    }
+
+    printf("%f\n", energy());
+}
@@ -0,0 +1,42 @@
+/* queens.c */
+
+int columns[16], rising[32], falling[32];
+
+int place(int row, int n)
+{
+    int col, count;
+
+    if (row == n)
+	return 1;
+
+    col = 0;
+    count = 0;
+
+    while (col < n) {
+	if (!columns[col] && !rising[row + col] && !falling[row - col + n]) {
+	    columns[col] = 1;
+	    rising[row + col] = 1;
+	    falling[row - col + n] = 1;
+	    count = count + place(row + 1, n);
+	    columns[col] = 0;
+	    rising[row + col] = 0;
+	    falling[row - col + n] = 0;
+	}
+
+	col = col + 1;
+    }
+
+    return count;
+}
+
+int main(void)
+{
+    int n;
+
+    n = 4;
+
+    while (n <= 11) {
+	printf("%d %d\n", n, place(0, n));
+	n = n + 1;
+    }
+}
@@ -0,0 +1,51 @@
+/* sieve.c */
+
+char *malloc(int n);
+
+int sieve(char *composite, int n)
+{
+    int i, j, count;
+
+    i = 0;
+
+    while (i < n) {
+	composite[i] = 0;
+	i = i + 1;
+    }
+
+    i = 2;
+    count = 0;
+
+    while (i < n) {
+	if (!composite[i]) {
+	    count = count + 1;
+	    j = i + i;
+
+	    while (j < n) {
+		composite[j] = 1;
+		j = j + i;
+	    }
+	}
+
+	i = i + 1;
+    }
+
+    return count;
+}
+
+int main(void)
+{
+    char *composite;
+    int n, round, count;
+
+    n = 2000000;
+    composite = malloc(n);
+    round = 0;
+
+    while (round < 8) {
+	count = sieve(composite, n - round * 1000);
+	round = round + 1;
+    }
+
+    printf("%d\n", count);
+}
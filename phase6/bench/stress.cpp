@@ -0,0 +1,252 @@
+/*
+ * File:	stress.cpp
+ *
+ * Description:	This file contains a generator of synthetic Simple C
+ *		programs for measuring the compiler on inputs far larger
+ *		than any real program.  Each shape stresses one part of the
+ *		compiler as its size grows:
+ *
+ *		functions	many small functions calling earlier ones
+ *		globals		many globals, each function using many of
+ *				them, for the search of the global scope
+ *		expression	one long chain of binary operators
+ *		parentheses	one expression nested in parentheses, for
+ *				the recursion of the parser
+ *		nesting		blocks nested inside one another, each
+ *				using the variables of those around it, for
+ *				the search through the enclosing scopes
+ *
+ *		The program is written to the standard output and depends
+ *		only on the shape, the size, and the seed, so that the same
+ *		input can be generated anywhere.
+ *
+ *		usage: stress shape size [seed]
+ */
+
+# include <string>
+# include <cstdlib>
+# include <iostream>
+
+using namespace std;
+
+static unsigned long seed = 1;
+
+
+/*
+ * Function:	choose
+ *
+ * Description:	Return a pseudo-random number less than the given bound.
+ *		We use our own generator rather than rand() so that the
+ *		output is the same on every system.
+ */
+
+static unsigned choose(unsigned bound)
+{
+    seed = (seed * 1103515245 + 12345) % 2147483648UL;
+    return (seed >> 8) % bound;
+}
+
+
+/*
+ * Function:	binary
+ *
+ * Description:	Return a binary operator that cannot trap.
+ */
+
+static const char *binary()
+{
+    static const char *ops[] = {" + ", " - ", " * ", " < ", " == ", " && ", " || "};
+
+    return ops[choose(7)];
+}
+
+
+/*
+ * Function:	functions
+ *
+ * Description:	Write the given number of functions, each calling one
+ *		written before it.
+ */
+
+static void functions(unsigned n)
+{
+    for (unsigned i = 0; i < n; i ++) {
+	cout << "int f" << i << "(int a, int b)" << endl;
+	cout << "{" << endl;
+	cout << "    int x;" << endl << endl;
+	cout << "    x = a" << binary() << "b" << binary() << choose(100) << ";" << endl;
+
+	if (i > 0)
+	    cout << "    x = x + f" << choose(i) << "(b, x);" << endl;
+
+	cout << "    if (x > " << choose(100) << ")" << endl;
+	cout << "\tx = x - " << choose(100) << ";" << endl << endl;
+	cout << "    return x;" << endl;
+	cout << "}" << endl << endl;
+    }
+
+    cout << "int main(void)" << endl;
+    cout << "{" << endl;
+    cout << "    return f" << n - 1 << "(1, 2);" << endl;
+    cout << "}" << endl;
+}
+
+
+/*
+ * Function:	globals
+ *
+ * Description:	Write the given number of globals, followed by functions
+ *		that use each of them twice on average.
+ */
+
+static void globals(unsigned n)
+{
+    for (unsigned i = 0; i < n; i ++)
+	cout << "int g" << i << ";" << endl;
+
+    for (unsigned i = 0; i < n; i += 100) {
+	cout << endl << "int use" << i / 100 << "(void)" << endl;
+	cout << "{" << endl;
+
+	for (unsigned j = 0; j < 100; j ++) {
+	    cout << "    g" << choose(n) << " = g" << choose(n);
+	    cout << binary() << "g" << choose(n) << ";" << endl;
+	}
+
+	cout << "}" << endl;
+    }
+}
+
+
+/*
+ * Function:	expression
+ *
+ * Description:	Write a function whose body is a single assignment with a
+ *		chain of the given number of operators.
+ */
+
+static void expression(unsigned n)
+{
+    cout << "int chain(int a, int b, int c, int d)" << endl;
+    cout << "{" << endl;
+    cout << "    int x;" << endl << endl;
+    cout << "    x = a";
+
+    for (unsigned i = 0; i < n; i ++) {
+	if (i % 8 == 7)
+	    cout << endl << "\t";
+
+	cout << binary();
+
+	if (choose(4) == 0)
+	    cout << choose(1000);
+	else
+	    cout << (char) ('a' + choose(4));
+    }
+
+    cout << ";" << endl << endl;
+    cout << "    return x;" << endl;
+    cout << "}" << endl;
+}
+
+
+/*
+ * Function:	parentheses
+ *
+ * Description:	Write a function returning an expression nested in the
+ *		given number of parentheses.
+ */
+
+static void parentheses(unsigned n)
+{
+    cout << "int nested(int a, int b)" << endl;
+    cout << "{" << endl;
+    cout << "    return a";
+
+    for (unsigned i = 0; i < n; i ++) {
+	if (i % 8 == 7)
+	    cout << endl << "\t";
+
+	cout << binary() << "(" << (choose(2) ? "a" : "b");
+    }
+
+    cout << string(n, ')') << ";" << endl;
+    cout << "}" << endl;
+}
+
+
+/*
+ * Function:	nesting
+ *
+ * Description:	Write a function with blocks nested to the given depth.
+ *		Each block declares a variable and assigns it from those
+ *		declared by the blocks around it.
+ */
+
+static void nesting(unsigned n)
+{
+    cout << "int nest(int v0)" << endl;
+    cout << "{" << endl;
+
+    for (unsigned i = 1; i <= n; i ++) {
+	string indent(i, ' ');
+
+	if (choose(2) == 0)
+	    cout << indent << "if (v" << choose(i) << " > " << choose(100) << ") {" << endl;
+	else
+	    cout << indent << "{" << endl;
+
+	cout << indent << " int v" << i << ";" << endl;
+	cout << indent << " v" << i << " = v" << choose(i);
+	cout << binary() << "v" << choose(i) << ";" << endl;
+    }
+
+    for (unsigned i = n; i >= 1; i --)
+	cout << string(i, ' ') << "}" << endl;
+
+    cout << "    return v0;" << endl;
+    cout << "}" << endl;
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Write the program of the requested shape and size.
+ */
+
+int main(int argc, char *argv[])
+{
+    string shape;
+    unsigned n;
+
+
+    if (argc < 3 || argc > 4 || (n = strtoul(argv[2], NULL, 10)) == 0) {
+	cerr << "usage: stress shape size [seed]" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    shape = argv[1];
+
+    if (argc == 4)
+	seed = strtoul(argv[3], NULL, 10);
+
+    cout << "/* stress " << shape << " " << n << " " << seed << " */" << endl << endl;
+
+    if (shape == "functions")
+	functions(n);
+    else if (shape == "globals")
+	globals(n);
+    else if (shape == "expression")
+	expression(n);
+    else if (shape == "parentheses")
+	parentheses(n);
+    else if (shape == "nesting")
+	nesting(n);
+    else {
+	cerr << "stress: unknown shape '" << shape << "'" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    exit(EXIT_SUCCESS);
+}
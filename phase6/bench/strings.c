@@ -0,0 +1,98 @@
+/* strings.c */
+
+char *malloc(int n);
+
+int length(char *s)
+{
+    int n;
+
+    n = 0;
+
+    while (s[n])
+	n = n + 1;
+
+    return n;
+}
+
+int generate(char *text, int n)
+{
+    int i, seed;
+    char *words;
+
+    words = "the quick brown fox jumps over a lazy dog and then sleeps ";
+    i = 0;
+    seed = 7;
+
+    while (i < n) {
+	seed = (seed * 75 + 74) % 65537;
+	text[i] = words[seed % 58];
+	i = i + 1;
+    }
+
+    text[n] = 0;
+}
+
+int words(char *s)
+{
+    int count, inside;
+
+    count = 0;
+    inside = 0;
+
+    while (*s) {
+	if (*s == 32)
+	    inside = 0;
+	else if (!inside) {
+	    inside = 1;
+	    count = count + 1;
+	}
+
+	s = s + 1;
+    }
+
+    return count;
+}
+
+int occurrences(char *s, char *pattern)
+{
+    int count, i, n;
+
+    count = 0;
+    n = length(pattern);
+
+    while (*s) {
+	i = 0;
+
+	while (i < n && s[i] == pattern[i])
+	    i = i + 1;
+
+	if (i == n)
+	    count = count + 1;
+
+	s = s + 1;
+    }
+
+    return count;
+}
+
+int main(void)
+{
+    char *text;
+    int n, round, total;
+
+    n = 1000000;
+    text = malloc(n + 1);
+    generate(text, n);
+    round = 0;
+    total = 0;
+
+    while (round < 5) {
+	total = total + length(text);
+	total = total + words(text);
+	total = total + occurrences(text, "the");
+	total = total + occurrences(text, "o ");
+	round = round + 1;
+    }
+
+    printf("%d %d %d\n", words(text), occurrences(text, "e "), total);
+}
@@ -0,0 +1,102 @@
+#!/bin/sh
+#
+# File:		throughput.sh
+#
+# Description:	This file contains the harness for the compile-throughput
+#		benchmark.  For each shape of synthetic program, we generate
+#		a program at two sizes, the second twice the first, and
+#		compile each with scc, which reports the time and peak
+#		memory of each of its phases.  We report the lines and
+#		tokens compiled per second and the peak resident set size,
+#		followed by the breakdown by phase.
+#
+#		Compilation time should grow linearly with the size of the
+#		input, so doubling the size should at most roughly double
+#		the time.  A larger growth is flagged as superlinear, and a
+#		compilation that crashes, such as by running out of stack,
+#		or that takes longer than TIMEOUT seconds is flagged too.
+#
+#		usage: throughput.sh [shape ...]
+#
+#		The environment may override SCC, SCCFLAGS, SEED, SCALE,
+#		which multiplies the sizes, and TIMEOUT.
+#
+
+SCC=${SCC:-../scc}
+SCCFLAGS=${SCCFLAGS:--O2}
+SEED=${SEED:-1}
+SCALE=${SCALE:-1}
+TIMEOUT=${TIMEOUT:-60}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' 0
+
+if [ $# -eq 0 ]; then
+    set -- functions globals expression parentheses nesting
+fi
+
+
+# Print the smaller size for a shape.
+
+size()
+{
+    case "$1" in
+    functions)	echo $((5000 * SCALE)) ;;
+    globals)	echo $((1000 * SCALE)) ;;
+    expression)	echo $((2000 * SCALE)) ;;
+    parentheses) echo $((250 * SCALE)) ;;
+    nesting)	echo $((100 * SCALE)) ;;
+    *)		echo 0 ;;
+    esac
+}
+
+
+printf "scc %s, seed %d\n\n" "$SCCFLAGS" "$SEED"
+printf "%-12s %7s %8s %8s %8s %9s %9s %8s  %s\n" shape size lines tokens \
+    seconds lines/s tokens/s "peak KB" growth
+
+for shape in "$@"; do
+    n=$(size "$shape")
+    last=
+
+    if [ "$n" -eq 0 ]; then
+	echo "throughput.sh: unknown shape '$shape'" >&2
+	continue
+    fi
+
+    for size in $n $((2 * n)); do
+	./stress "$shape" "$size" "$SEED" > "$work/input.c"
+	timeout "$TIMEOUT" $SCC $SCCFLAGS -time-report < "$work/input.c" \
+	    > /dev/null 2> "$work/report"
+	status=$?
+
+	if [ $status -eq 124 ]; then
+	    printf "%-12s %7d  timeout after %d seconds\n" "$shape" "$size" "$TIMEOUT"
+	    break
+	elif [ $status -ne 0 ]; then
+	    printf "%-12s %7d  crashed with status %d\n" "$shape" "$size" $status
+	    break
+	fi
+
+	awk -v shape="$shape" -v size="$size" -v last="$last" '
+	    $1 == "total" { seconds = $2; peak = $4 }
+	    $2 == "lines" { lines = $1; lps = $3 }
+	    $2 == "tokens" { tokens = $1; tps = $3 }
+	    NR > 1 && $1 != "total" && $1 !~ /^[0-9]/ {
+		phases = phases sprintf("  %s %ss %sKB", $1, $2, $4)
+	    }
+	    END {
+		growth = ""
+		if (last != "" && last > 0) {
+		    growth = sprintf("%.2f", seconds / last)
+		    if (seconds / last > 3)
+			growth = growth " superlinear"
+		}
+		printf "%-12s %7d %8d %8d %8.3f %9d %9d %8d  %s\n", shape, size,
+		    lines, tokens, seconds, lps, tps, peak, growth
+		print "            " phases
+	    }' "$work/report"
+
+	last=$(awk '$1 == "total" { print $2 }' "$work/report")
+    done
+done
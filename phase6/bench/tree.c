@@ -0,0 +1,89 @@
+/* tree.c */
+
+int key[131072], left[131072], right[131072];
+int nodes, seed;
+
+int number(void)
+{
+    seed = (seed * 75 + 74) % 65537;
+    return seed;
+}
+
+int insert(int node, int k)
+{
+    if (node == 0) {
+	nodes = nodes + 1;
+	key[nodes] = k;
+	left[nodes] = 0;
+	right[nodes] = 0;
+	return nodes;
+    }
+
+    if (k < key[node])
+	left[node] = insert(left[node], k);
+    else if (k > key[node])
+	right[node] = insert(right[node], k);
+
+    return node;
+}
+
+int search(int node, int k)
+{
+    if (node == 0)
+	return 0;
+
+    if (k < key[node])
+	return search(left[node], k);
+
+    if (k > key[node])
+	return search(right[node], k);
+
+    return 1;
+}
+
+int height(int node)
+{
+    int l, r;
+
+    if (node == 0)
+	return 0;
+
+    l = height(left[node]);
+    r = height(right[node]);
+
+    if (l > r)
+	return l + 1;
+
+    return r + 1;
+}
+
+int main(void)
+{
+    int root, i, round, found;
+
+    round = 0;
+    found = 0;
+
+    while (round < 6) {
+	nodes = 0;
+	root = 0;
+	seed = round + 1;
+	i = 0;
+
+	while (i < 60000) {
+	    root = insert(root, number());
+	    i = i + 1;
+	}
+
+	i = 0;
+
+	while (i < 200000) {
+	    found = found + search(root, number());
+	    i = i + 1;
+	}
+
+	round = round + 1;
+    }
+
+    printf("%d %d %d\n", nodes, height(root), found);
+}
@@ -0,0 +1,492 @@
+/*
+ * File:	cache.cpp
+ *
+ * Description:	This file contains the function definitions for the
+ *		on-disk cache of the code generated for each function, so
+ *		that a function that has not changed need not be checked
+ *		or compiled again.
+ *
+ *		The key of a function combines a hash of all of its tokens,
+ *		its own name and type, the options that affect the code we
+ *		generate, and the identity of the compiler itself.  An
+ *		entry also holds the type of every global symbol that the
+ *		body referred to, or that it was undeclared and so was
+ *		implicitly declared as a function, and the entry is only
+ *		used if all of them are still the same.
+ *
+ *		Labels are numbered across the whole compilation, so an
+ *		entry cannot hold them as they are.  The labels of the
+ *		function itself are stored relative to the first one it
+ *		allocated, and the literals it used are stored by content,
+ *		since they may already be in the pool or not.  When an
+ *		entry is used, we allocate the same number of labels and
+ *		look up each literal again.
+ *
+ *		Each entry is its own file, named for a hash of its key,
+ *		and is written to a temporary file and renamed, so that
+ *		concurrent compilations never see a partial entry.  Using
+ *		an entry updates its modification time, and once the cache
+ *		grows beyond its limit, the entries least recently used
+ *		are removed first.
+ */
+
+# include <set>
+# include <map>
+# include <vector>
+# include <cctype>
+# include <cstdio>
+# include <cstdlib>
+# include <sstream>
+# include <fstream>
+# include <iostream>
+# include <algorithm>
+# include <dirent.h>
+# include <unistd.h>
+# include <utime.h>
+# include <sys/stat.h>
+# include "cache.h"
+# include "checker.h"
+# include "generator.h"
+# include "optimizer.h"
+# include "options.h"
+# include "Label.h"
+# include "Type.h"
+
+using namespace std;
+
+# define CACHE_VERSION 1
+
+struct Literal {
+    string _directive, _text, _label;
+};
+
+static bool recording, stored;
+static string key, path;
+static unsigned first;
+static vector<pair<string, string>> globals;
+static set<string> noted;
+static vector<Literal> literals;
+
+
+/*
+ * Function:	fnv (private)
+ *
+ * Description:	Return the 64-bit FNV-1a hash of a string.
+ */
+
+static unsigned long long fnv(const string &s)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+
+    for (unsigned i = 0; i < s.size(); i ++)
+	hash = (hash ^ (unsigned char) s[i]) * 1099511628211ULL;
+
+    return hash;
+}
+
+
+/*
+ * Function:	describe (private)
+ *
+ * Description:	Return a description of a type that, unlike the usual
+ *		one, includes the types of any parameters.
+ */
+
+static string describe(const Type &type)
+{
+    Parameters *params = type.isFunction() ? type.parameters() : nullptr;
+    stringstream ss;
+
+
+    ss << type;
+
+    if (params != nullptr) {
+	ss << "(";
+
+	for (unsigned i = 0; i < params->size(); i ++)
+	    ss << (i > 0 ? "," : "") << describe((*params)[i]);
+
+	ss << ")";
+    }
+
+    return ss.str();
+}
+
+
+/*
+ * Function:	identity (private)
+ *
+ * Description:	Return a description of the compiler and the options that
+ *		affect the code it generates.  The compiler is identified
+ *		by the size and modification time of its executable where
+ *		we can find it, and by when this file was compiled if not.
+ */
+
+static const string &identity()
+{
+    static string result;
+    struct stat st;
+    stringstream ss;
+
+
+    if (result.empty()) {
+	ss << "scc-cache " << CACHE_VERSION << " -O" << optimize;
+	ss << (omitFramePointer ? " -fomit-frame-pointer" : "");
+	ss << " passes=" << pipeline();
+
+	if (stat("/proc/self/exe", &st) == 0)
+	    ss << " " << st.st_size << " " << st.st_mtime;
+	else
+	    ss << " " << __DATE__ << " " << __TIME__;
+
+	result = ss.str();
+    }
+
+    return result;
+}
+
+
+/*
+ * Function:	relocate (private)
+ *
+ * Description:	Rewrite the labels in assembly for storing, with those of
+ *		literals replaced by .P and their index, and the others,
+ *		which must be the function's own, by .R and their number
+ *		relative to the first.  Return false if any label is not
+ *		one of these.
+ */
+
+static bool relocate(const string &text, unsigned last, string &result)
+{
+    map<string, unsigned> indices;
+    size_t i = 0, j, k;
+    unsigned n;
+
+
+    for (unsigned l = 0; l < literals.size(); l ++)
+	indices[literals[l]._label] = l;
+
+    while ((j = text.find(".L", i)) != string::npos) {
+	result.append(text, i, j - i);
+
+	for (k = j + 2; k < text.size() && isdigit((unsigned char) text[k]); k ++)
+	    ;
+
+	if (k == j + 2)
+	    result += ".L";
+	else if (indices.count(text.substr(j, k - j)) > 0)
+	    result += ".P" + to_string(indices[text.substr(j, k - j)]);
+	else {
+	    n = strtoul(text.c_str() + j + 2, NULL, 10);
+
+	    if (n < first || n >= last)
+		return false;
+
+	    result += ".R" + to_string(n - first);
+	}
+
+	i = k;
+    }
+
+    result.append(text, i, string::npos);
+    return true;
+}
+
+
+/*
+ * Function:	restore (private)
+ *
+ * Description:	Rewrite the labels in stored assembly for use, with the
+ *		function's own labels numbered from the given base and
+ *		those of literals replaced by their current labels.
+ */
+
+static string restore(const string &text, unsigned base, const vector<string> &labels)
+{
+    string result;
+    size_t i = 0, j, k;
+    unsigned n;
+
+
+    while ((j = text.find('.', i)) != string::npos) {
+	result.append(text, i, j - i);
+
+	for (k = j + 2; k < text.size() && isdigit((unsigned char) text[k]); k ++)
+	    ;
+
+	if (k == j + 2 || (text[j + 1] != 'R' && text[j + 1] != 'P')) {
+	    result += '.';
+	    i = j + 1;
+	    continue;
+	}
+
+	n = strtoul(text.c_str() + j + 2, NULL, 10);
+
+	if (text[j + 1] == 'R')
+	    result += ".L" + to_string(base + n);
+	else
+	    result += n < labels.size() ? labels[n] : "";
+
+	i = k;
+    }
+
+    result.append(text, i, string::npos);
+    return result;
+}
+
+
+/*
+ * Function:	load (private)
+ *
+ * Description:	Read the entry for the current key, and if it is there and
+ *		every global it depends on is unchanged, write its code
+ *		and return true.  Any functions that the body implicitly
+ *		declared are declared again.
+ */
+
+static bool load()
+{
+    unsigned nlabels, nglobals, nliterals, base = 0;
+    vector<pair<string, string>> deps;
+    vector<Literal> lits;
+    vector<string> labels;
+    ifstream in(path);
+    stringstream code;
+    string line;
+    size_t tab;
+    Symbol *symbol;
+
+
+    if (!getline(in, line) || line != key)
+	return false;
+
+    if (!(in >> nlabels >> nglobals >> nliterals) || !getline(in, line))
+	return false;
+
+    for (unsigned i = 0; i < nglobals; i ++) {
+	if (!getline(in, line) || (tab = line.find('\t')) == string::npos)
+	    return false;
+
+	deps.push_back(make_pair(line.substr(0, tab), line.substr(tab + 1)));
+	symbol = findGlobal(deps.back().first);
+
+	if ((symbol != nullptr ? describe(symbol->type()) : "") != deps.back().second)
+	    return false;
+    }
+
+    for (unsigned i = 0; i < nliterals; i ++) {
+	if (!getline(in, line) || (tab = line.find('\t')) == string::npos)
+	    return false;
+
+	Literal literal = {line.substr(0, tab), line.substr(tab + 1), ""};
+	lits.push_back(literal);
+    }
+
+    code << in.rdbuf();
+
+    for (unsigned i = 0; i < deps.size(); i ++)
+	if (deps[i].second.empty())
+	    checkFunction(deps[i].first);
+
+    for (unsigned i = 0; i < nlabels; i ++) {
+	Label label;
+
+	if (i == 0)
+	    base = label.number();
+    }
+
+    for (unsigned i = 0; i < lits.size(); i ++) {
+	if (lits[i]._directive == ".long")
+	    lits[i]._text = restore(lits[i]._text, base, labels);
+
+	labels.push_back(literal(lits[i]._directive, lits[i]._text));
+    }
+
+    cout << restore(code.str(), base, labels);
+    return true;
+}
+
+
+/*
+ * Function:	findFunction
+ *
+ * Description:	Look up the definition of a function whose tokens have the
+ *		given hash.  If it is found, its code is written and we
+ *		return true.  Otherwise, we start recording what the
+ *		function depends on, so that it can be stored once its
+ *		code is generated.
+ */
+
+bool findFunction(const Symbol *symbol, unsigned long long hash)
+{
+    stringstream ss;
+
+
+    ss << identity() << "\t" << symbol->name() << "\t";
+    ss << describe(symbol->type()) << "\t" << hex << hash;
+    key = ss.str();
+
+    ss.str("");
+    ss << cacheDirectory << "/" << hex << fnv(key);
+    path = ss.str();
+
+    recording = false;
+
+    if (load()) {
+	utime(path.c_str(), nullptr);
+	addStatistic("cache", "hits", 1);
+	return true;
+    }
+
+    addStatistic("cache", "misses", 1);
+    recording = true;
+    globals.clear();
+    noted.clear();
+    literals.clear();
+    first = Label().number() + 1;
+    return false;
+}
+
+
+/*
+ * Function:	recordingFunction
+ *
+ * Description:	Return whether we are recording what a function depends
+ *		on.
+ */
+
+bool recordingFunction()
+{
+    return recording;
+}
+
+
+/*
+ * Function:	noteGlobal
+ *
+ * Description:	Note that the function being recorded refers to a global
+ *		symbol, or to an undeclared one if the symbol is null.
+ */
+
+void noteGlobal(const string &name, const Symbol *symbol)
+{
+    if (recording && noted.insert(name).second)
+	globals.push_back(make_pair(name, symbol != nullptr ? describe(symbol->type()) : ""));
+}
+
+
+/*
+ * Function:	noteLiteral
+ *
+ * Description:	Note that the function being recorded uses a literal.
+ */
+
+void noteLiteral(const string &directive, const string &text, const string &label)
+{
+    for (unsigned i = 0; recording && i < literals.size(); i ++)
+	if (literals[i]._label == label)
+	    return;
+
+    if (recording) {
+	Literal literal = {directive, text, label};
+	literals.push_back(literal);
+    }
+}
+
+
+/*
+ * Function:	storeFunction
+ *
+ * Description:	Store the code generated for the function being recorded.
+ */
+
+void storeFunction(const string &code)
+{
+    unsigned last = Label().number();
+    stringstream ss, temp;
+    string text, table;
+    ofstream out;
+
+
+    if (!recording)
+	return;
+
+    recording = false;
+
+    if (!relocate(code, last, text))
+	return;
+
+    ss << key << endl;
+    ss << last - first << " " << globals.size() << " " << literals.size() << endl;
+
+    for (unsigned i = 0; i < globals.size(); i ++)
+	ss << globals[i].first << "\t" << globals[i].second << endl;
+
+    for (unsigned i = 0; i < literals.size(); i ++) {
+	table.clear();
+
+	if (literals[i]._directive != ".long")
+	    table = literals[i]._text;
+	else if (!relocate(literals[i]._text, last, table))
+	    return;
+
+	ss << literals[i]._directive << "\t" << table << endl;
+    }
+
+    ss << text;
+
+    mkdir(cacheDirectory.c_str(), 0777);
+    temp << path << "." << getpid();
+    out.open(temp.str());
+
+    if (out << ss.str() && (out.close(), !out.fail()) &&
+	    rename(temp.str().c_str(), path.c_str()) == 0) {
+	stored = true;
+	addStatistic("cache", "stores", 1);
+    } else
+	remove(temp.str().c_str());
+}
+
+
+/*
+ * Function:	closeCache
+ *
+ * Description:	If we stored anything, remove the entries least recently
+ *		used until the cache is within its limit.
+ */
+
+void closeCache()
+{
+    vector<pair<time_t, string>> entries;
+    unsigned long long total = 0;
+    unsigned evicted = 0;
+    struct dirent *entry;
+    struct stat st;
+    string name;
+    DIR *dir;
+
+
+    if (!stored || (dir = opendir(cacheDirectory.c_str())) == nullptr)
+	return;
+
+    while ((entry = readdir(dir)) != nullptr) {
+	name = cacheDirectory + "/" + entry->d_name;
+
+	if (stat(name.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+	    entries.push_back(make_pair(st.st_mtime, name));
+	    total += st.st_size;
+	}
+    }
+
+    closedir(dir);
+    sort(entries.begin(), entries.end());
+
+    for (unsigned i = 0; i < entries.size() && total > cacheSize * 1024ULL; i ++)
+	if (stat(entries[i].second.c_str(), &st) == 0 && remove(entries[i].second.c_str()) == 0) {
+	    total -= st.st_size;
+	    evicted ++;
+	}
+
+    if (evicted > 0)
+	addStatistic("cache", "evictions", evicted);
+}
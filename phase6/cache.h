@@ -0,0 +1,20 @@
+/*
+ * File:	cache.h
+ *
+ * Description:	This file contains the function declarations for the
+ *		on-disk cache of the code generated for each function.
+ */
+
+# ifndef CACHE_H
+# define CACHE_H
+# include <string>
+# include "Symbol.h"
+
+bool findFunction(const Symbol *symbol, unsigned long long hash);
+bool recordingFunction();
+void noteGlobal(const std::string &name, const Symbol *symbol);
+void noteLiteral(const std::string &directive, const std::string &text, const std::string &label);
+void storeFunction(const std::string &code);
+void closeCache();
+
+# endif /* CACHE_H */
@@ -6,14 +6,20 @@
  *
  *		Extra functionality:
  *		- inserting an undeclared symbol with the error type
- *		- scaling the operands and results of pointer arithmetic
+ *		- scaling the operands and results of pointer arithmetic,
+ *		  with integer literals scaled in place
  *		- explicit type conversions and promotions
  */
 
 # include <set>
+# include <cstdlib>
+# include <vector>
+# include <algorithm>
 # include <iostream>
 # include "lexer.h"
 # include "checker.h"
+# include "cache.h"
+# include "precompiled.h"
 # include "tokens.h"
 # include "Symbol.h"
 # include "Scope.h"
@@ -24,6 +30,8 @@ using namespace std;
 
 static set<string> funcdefns;
 static Scope *outermost, *toplevel;
+static vector<Cases> switches;
+static unsigned breakables;
 static const Type error, character(CHAR), integer(INT), real(DOUBLE);
 
 static string redefined = "redefinition of '%s'";
@@ -39,6 +47,12 @@ static string invalid_cast = "invalid operand in cast expression";
 static string invalid_operand = "invalid operand to unary %s";
 static string invalid_function = "called object is not a function";
 static string invalid_arguments = "invalid arguments to called function";
+static string invalid_switch = "switch quantity not an integer";
+static string duplicate_case = "duplicate case value";
+static string duplicate_default = "multiple default labels in one switch";
+static string stray_case = "case label not within a switch statement";
+static string stray_default = "'default' label not within a switch statement";
+static string stray_break = "break statement not within loop or switch";
 
 
 /*
@@ -51,24 +65,80 @@ static void debug(const string &str, const Type &t1, const Type &t2)
 }
 
 
+/*
+ * Function:	literalChar (private)
+ *
+ * Description:	Return the character denoted by the dereference of a
+ *		string literal, such as *"a", or -1 if the expression is
+ *		not one or the character uses an escape we do not know.
+ *		The literal still includes its quotes.
+ */
+
+static int literalChar(Expression *expr)
+{
+    Expression *pointer = expr->isDeref();
+    String *literal;
+
+
+    if (pointer == nullptr || pointer->isAddress() == nullptr)
+	return -1;
+
+    literal = dynamic_cast<String *>(pointer->isAddress());
+
+    if (literal == nullptr)
+	return -1;
+
+    const string &s = literal->value();
+
+    if (s[1] == '"')
+	return 0;
+
+    if (s[1] != '\\')
+	return (unsigned char) s[1] < 128 ? s[1] : -1;
+
+    switch (s[2]) {
+    case 'n':
+	return '\n';
+
+    case 't':
+	return '\t';
+
+    case '\\':
+    case '"':
+    case '\'':
+	return s[2];
+    }
+
+    return -1;
+}
+
+
 /*
  * Function:	promote
  *
  * Description:	Perform type promotion on the given expression.  An array
  *		is promoted to a pointer by explicitly inserting an address
  *		operator.  A character is promoted to an integer by
- *		explicitly inserting a type cast.
+ *		explicitly inserting a type cast, unless it is a character
+ *		of a string literal, which is simply folded.
  */
 
 static Type promote(Expression *&expr)
 {
+    int c;
+
+
     if (expr->type().isArray()) {
 	debug("promoting", expr->type(), expr->type().promote());
 	expr = new Address(expr, expr->type().promote());
 
     } else if (expr->type() == character) {
 	debug("promoting", character, integer);
-	expr = new Cast(integer, expr);
+
+	if ((c = literalChar(expr)) >= 0)
+	    expr = new Integer(c);
+	else
+	    expr = new Cast(integer, expr);
     }
 
     return expr->type();
@@ -242,6 +312,51 @@ Symbol *declareVariable(const string &name, const Type &type)
 }
 
 
+/*
+ * Function:	loadDeclarations
+ *
+ * Description:	Load the global declarations precompiled into the given
+ *		file into the outermost scope.  A file that cannot be read
+ *		is an error, since the user asked for it explicitly.
+ */
+
+void loadDeclarations(const string &filename)
+{
+    if (!readPrecompiled(filename, outermost, funcdefns)) {
+	cerr << "scc: cannot read declarations '" << filename << "'" << endl;
+	exit(EXIT_FAILURE);
+    }
+}
+
+
+/*
+ * Function:	saveDeclarations
+ *
+ * Description:	Write the global declarations to the given file.
+ */
+
+void saveDeclarations(const string &filename)
+{
+    if (!writePrecompiled(filename, outermost, funcdefns)) {
+	cerr << "scc: cannot write declarations '" << filename << "'" << endl;
+	exit(EXIT_FAILURE);
+    }
+}
+
+
+/*
+ * Function:	findGlobal
+ *
+ * Description:	Return the symbol declared for NAME in the outermost scope,
+ *		if any.
+ */
+
+Symbol *findGlobal(const string &name)
+{
+    return outermost != nullptr ? outermost->find(name) : nullptr;
+}
+
+
 /*
  * Function:	checkIdentifier
  *
@@ -254,6 +369,9 @@ Symbol *checkIdentifier(const string &name)
 {
     Symbol *symbol = toplevel->lookup(name);
 
+    if (recordingFunction() && (symbol == nullptr || symbol == outermost->find(name)))
+	noteGlobal(name, symbol);
+
     if (symbol == nullptr) {
 	report(undeclared, name);
 	symbol = new Symbol(name, error);
@@ -275,6 +393,9 @@ Symbol *checkFunction(const string &name)
 {
     Symbol *symbol = toplevel->lookup(name);
 
+    if (recordingFunction() && (symbol == nullptr || symbol == outermost->find(name)))
+	noteGlobal(name, symbol);
+
     if (symbol == nullptr)
 	symbol = declareFunction(name, Type(INT, 0, nullptr));
 
@@ -573,6 +694,25 @@ Expression *checkRemainder(Expression *left, Expression *right)
 }
 
 
+/*
+ * Function:	scale (private)
+ *
+ * Description:	Return an integer expression multiplied by the given size
+ *		for pointer arithmetic.  A literal is simply replaced by
+ *		its product.
+ */
+
+static Expression *scale(Expression *expr, unsigned size)
+{
+    Integer *literal = dynamic_cast<Integer *>(expr);
+
+    if (literal != nullptr)
+	return new Integer(strtoul(literal->value().c_str(), NULL, 0) * size);
+
+    return new Multiply(expr, new Integer(size), integer);
+}
+
+
 /*
  * Function:	checkAdd
  *
@@ -595,11 +735,11 @@ Expression *checkAdd(Expression *left, Expression *right)
 	    result = t1;
 
 	else if (t1.isPointer() && t2 == integer) {
-	    right = new Multiply(right, new Integer(t1.deref().size()), integer);
+	    right = scale(right, t1.deref().size());
 	    result = t1;
 
 	} else if (t1 == integer && t2.isPointer()) {
-	    left = new Multiply(left, new Integer(t2.deref().size()), integer);
+	    left = scale(left, t2.deref().size());
 	    result = t2;
 
 	} else
@@ -638,7 +778,7 @@ Expression *checkSubtract(Expression *left, Expression *right)
 	    result = integer;
 
 	else if (t1.isPointer() && t2 == integer) {
-	    right = new Multiply(right, new Integer(t1.deref().size()), integer);
+	    right = scale(right, t1.deref().size());
 	    result = t1;
 
 	} else
@@ -837,6 +977,93 @@ Statement *checkAssignment(Expression *left, Expression *right)
 }
 
 
+/*
+ * Function:	update (private)
+ *
+ * Description:	Check an update of an lvalue in place.  The new value is
+ *		computed by the given operator from a placeholder for the
+ *		old value and the right operand, which is checked just as
+ *		for the binary operator, and then must be assignable to
+ *		the lvalue.
+ */
+
+static Expression *update(Expression *left, int op, Expression *right,
+	bool postfix, const string &name)
+{
+    Placeholder *old = new Placeholder(left->type());
+    Expression *expr;
+    Type t;
+
+
+    if (op == '+')
+	expr = checkAdd(old, right);
+    else if (op == '-')
+	expr = checkSubtract(old, right);
+    else if (op == '*')
+	expr = checkMultiply(old, right);
+    else
+	expr = checkDivide(old, right);
+
+    t = convert(expr, left->type());
+
+    if (left->type() != error && t != error) {
+	if (!left->lvalue())
+	    report(invalid_lvalue);
+
+	else if (!left->type().isCompatibleWith(t))
+	    report(invalid_operands, name);
+    }
+
+    return new Update(left, old, expr, postfix);
+}
+
+
+/*
+ * Function:	checkIncrement
+ *
+ * Description:	Check a prefix or postfix increment expression, which
+ *		adds one to a numeric or pointer lvalue.
+ */
+
+Expression *checkIncrement(Expression *expr, bool postfix)
+{
+    return update(expr, '+', new Integer(1), postfix, "++");
+}
+
+
+/*
+ * Function:	checkDecrement
+ *
+ * Description:	Check a prefix or postfix decrement expression, which
+ *		subtracts one from a numeric or pointer lvalue.
+ */
+
+Expression *checkDecrement(Expression *expr, bool postfix)
+{
+    return update(expr, '-', new Integer(1), postfix, "--");
+}
+
+
+/*
+ * Function:	checkCompoundAssignment
+ *
+ * Description:	Check a compound assignment statement, such as left +=
+ *		right, which is an update whose value is never used.
+ */
+
+Statement *checkCompoundAssignment(Expression *left, int op, Expression *right)
+{
+    static const string names[] = {"+=", "-=", "*=", "/="};
+    static const int ops[] = {'+', '-', '*', '/'};
+    Expression *expr;
+
+
+    expr = update(left, ops[op - ADDEQ], right, false, names[op - ADDEQ]);
+    expr->discard();
+    return expr;
+}
+
+
 /*
  * Function:	checkReturn
  *
@@ -869,3 +1096,149 @@ void checkTest(Expression *&expr)
     if (t != error && !t.isPredicate())
 	report(invalid_test);
 }
+
+
+/*
+ * Function:	openLoop
+ *
+ * Description:	Enter the body of a loop, in which a break is legal.
+ */
+
+void openLoop()
+{
+    breakables ++;
+}
+
+
+/*
+ * Function:	closeLoop
+ *
+ * Description:	Leave the body of a loop.
+ */
+
+void closeLoop()
+{
+    breakables --;
+}
+
+
+/*
+ * Function:	openSwitch
+ *
+ * Description:	Check the expression of a switch statement, which must
+ *		have an integer type after promotion, and enter its body,
+ *		in which case labels and a break are legal.
+ */
+
+void openSwitch(Expression *&expr)
+{
+    const Type &t = promote(expr);
+
+    if (t != error && !t.isInteger())
+	report(invalid_switch);
+
+    switches.push_back(Cases());
+    breakables ++;
+}
+
+
+/*
+ * Function:	closeSwitch
+ *
+ * Description:	Leave the body of a switch statement and return the
+ *		statement, with its cases sorted by value and its default
+ *		label, if any, kept apart.
+ */
+
+Statement *closeSwitch(Expression *expr, Statement *stmt)
+{
+    Cases cases;
+    Case *deflt = nullptr;
+
+
+    for (unsigned i = 0; i < switches.back().size(); i ++)
+	if (switches.back()[i]->isDefault())
+	    deflt = switches.back()[i];
+	else
+	    cases.push_back(switches.back()[i]);
+
+    sort(cases.begin(), cases.end(), [](Case *a, Case *b) {
+	return a->value() < b->value();
+    });
+
+    switches.pop_back();
+    breakables --;
+    return new Switch(expr, stmt, cases, deflt);
+}
+
+
+/*
+ * Function:	checkCase
+ *
+ * Description:	Check a case label: it must be within a switch statement
+ *		and its value must not already be used in that switch.
+ */
+
+Statement *checkCase(long value)
+{
+    Case *label = new Case(value);
+
+
+    if (switches.empty()) {
+	report(stray_case);
+	return label;
+    }
+
+    for (unsigned i = 0; i < switches.back().size(); i ++)
+	if (!switches.back()[i]->isDefault() && switches.back()[i]->value() == value) {
+	    report(duplicate_case);
+	    return label;
+	}
+
+    switches.back().push_back(label);
+    return label;
+}
+
+
+/*
+ * Function:	checkDefault
+ *
+ * Description:	Check a default label: it must be within a switch
+ *		statement that has no other default label.
+ */
+
+Statement *checkDefault()
+{
+    Case *label = new Case(0, true);
+
+
+    if (switches.empty()) {
+	report(stray_default);
+	return label;
+    }
+
+    for (unsigned i = 0; i < switches.back().size(); i ++)
+	if (switches.back()[i]->isDefault()) {
+	    report(duplicate_default);
+	    return label;
+	}
+
+    switches.back().push_back(label);
+    return label;
+}
+
+
+/*
+ * Function:	checkBreak
+ *
+ * Description:	Check a break statement: it must be within a loop or a
+ *		switch statement.
+ */
+
+Statement *checkBreak()
+{
+    if (breakables == 0)
+	report(stray_break);
+
+    return new Break();
+}
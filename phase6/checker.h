@@ -16,6 +16,10 @@ Scope *closeScope();
 Symbol *defineFunction(const std::string &name, const Type &type);
 Symbol *declareFunction(const std::string &name, const Type &type);
 Symbol *declareVariable(const std::string &name, const Type &type);
+void loadDeclarations(const std::string &filename);
+void saveDeclarations(const std::string &filename);
+
+Symbol *findGlobal(const std::string &name);
 Symbol *checkIdentifier(const std::string &name);
 Symbol *checkFunction(const std::string &name);
 
@@ -39,9 +43,20 @@ Expression *checkEqual(Expression *left, Expression *right);
 Expression *checkNotEqual(Expression *left, Expression *right);
 Expression *checkLogicalAnd(Expression *left, Expression *right);
 Expression *checkLogicalOr(Expression *left, Expression *right);
+Expression *checkIncrement(Expression *expr, bool postfix);
+Expression *checkDecrement(Expression *expr, bool postfix);
 Statement *checkAssignment(Expression *left, Expression *right);
+Statement *checkCompoundAssignment(Expression *left, int op, Expression *right);
 
 void checkReturn(Expression *&expr, const Type &type);
 void checkTest(Expression *&expr);
 
+void openLoop();
+void closeLoop();
+void openSwitch(Expression *&expr);
+Statement *closeSwitch(Expression *expr, Statement *stmt);
+Statement *checkCase(long value);
+Statement *checkDefault();
+Statement *checkBreak();
+
 # endif /* CHECKER_H */
@@ -0,0 +1,125 @@
+/* select.c */
+
+
+int imax(int *a, int n)
+{
+    int i, m;
+
+    i = 0;
+    m = a[0];
+
+    while (i < n) {
+	if (a[i] > m)
+	    m = a[i];
+	i = i + 1;
+    }
+
+    return m;
+}
+
+int clamp(int x, int lo, int hi)
+{
+    int y;
+
+    if (x < lo)
+	y = lo;
+    else if (x > hi)
+	y = hi;
+    else
+	y = x;
+
+    return y;
+}
+
+double dmin(double x, double y)
+{
+    double z;
+
+    if (x < y) z = x; else z = y;
+    return z;
+}
+
+double dmax(double x, double y)
+{
+    double z;
+
+    if (x > y) z = x; else z = y;
+    return z;
+}
+
+double dsel(double x, double y, double a, double b)
+{
+    double z;
+
+    if (x == y) z = a; else z = b;
+    return z;
+}
+
+double dne(double x, double y, double a, double b)
+{
+    double z;
+
+    if (x != y) z = a + 1.0; else z = b;
+    return z;
+}
+
+double dge(double x, double y, double a, double b)
+{
+    double z;
+
+    if (x >= y) z = a; else z = b;
+    return z;
+}
+
+double isel(int x, double a, double b)
+{
+    double z;
+
+    if (x) z = a; else z = b;
+    return z;
+}
+
+int feq(double x, double y)
+{
+    int r;
+
+    if (x == y) r = 1; else r = 2;
+    return r;
+}
+
+int fne(double x, double y)
+{
+    int r;
+
+    if (x != y) r = 1; else r = 2;
+    return r;
+}
+
+int main(void)
+{
+    int a[10], i;
+    double zero, nan;
+
+    i = 0;
+
+    while (i < 10) {
+	a[i] = (i * 7) % 10;
+	i = i + 1;
+    }
+
+    zero = 0.0;
+    nan = zero / zero;
+
+    printf("%d\n", imax(a, 10));
+    printf("%d %d %d\n", clamp(-5, 0, 9), clamp(5, 0, 9), clamp(15, 0, 9));
+    printf("%f %f\n", dmin(1.5, 2.5), dmin(2.5, 1.5));
+    printf("%f %f\n", dmax(1.5, 2.5), dmax(2.5, 1.5));
+    printf("%f %f\n", dmin(nan, 2.5), dmax(nan, 2.5));
+    printf("%f %f %f\n", dsel(1.0, 1.0, 3.0, 4.0), dsel(1.0, 2.0, 3.0, 4.0), dsel(nan, nan, 3.0, 4.0));
+    printf("%f %f %f\n", dne(1.0, 1.0, 3.0, 4.0), dne(1.0, 2.0, 3.0, 4.0), dne(nan, nan, 3.0, 4.0));
+    printf("%f %f %f\n", dge(1.0, 1.0, 3.0, 4.0), dge(1.0, 2.0, 3.0, 4.0), dge(nan, nan, 3.0, 4.0));
+    printf("%f %f\n", isel(0, 3.0, 4.0), isel(7, 3.0, 4.0));
+    printf("%d %d %d\n", feq(1.0, 1.0), feq(1.0, 2.0), feq(nan, nan));
+    printf("%d %d %d\n", fne(1.0, 1.0), fne(1.0, 2.0), fne(nan, nan));
+    return 0;
+}
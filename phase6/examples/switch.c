@@ -0,0 +1,166 @@
+/* switch.c */
+
+int code[64];
+
+int run(int *code)
+{
+    int stack[16], sp, pc, op;
+
+    sp = 0;
+    pc = 0;
+
+    while (1) {
+	op = code[pc];
+	pc = pc + 1;
+
+	switch (op) {
+	case 0:
+	    return stack[sp - 1];
+
+	case 1:
+	    stack[sp] = code[pc];
+	    sp = sp + 1;
+	    pc = pc + 1;
+	    break;
+
+	case 2:
+	    sp = sp - 1;
+	    stack[sp - 1] = stack[sp - 1] + stack[sp];
+	    break;
+
+	case 3:
+	    sp = sp - 1;
+	    stack[sp - 1] = stack[sp - 1] - stack[sp];
+	    break;
+
+	case 4:
+	    sp = sp - 1;
+	    stack[sp - 1] = stack[sp - 1] * stack[sp];
+	    break;
+
+	case 5:
+	    stack[sp] = stack[sp - 1];
+	    sp = sp + 1;
+	    break;
+
+	case 6:
+	    printf("%d\n", stack[sp - 1]);
+	    break;
+
+	case 7:
+	    if (stack[sp - 1] != 0)
+		pc = code[pc];
+	    else
+		pc = pc + 1;
+
+	    break;
+
+	default:
+	    printf("bad opcode %d\n", op);
+	    return -1;
+	}
+    }
+}
+
+int sparse(int n)
+{
+    switch (n) {
+    case -100:
+	return 1;
+    case 7:
+	return 2;
+    case 1000:
+	return 3;
+    case 31337:
+	return 4;
+    case 65536:
+	return 5;
+    case 99999:
+	return 6;
+    }
+
+    return 0;
+}
+
+int mixed(int n)
+{
+    int result;
+
+    result = 0;
+
+    switch (n) {
+    case 10:
+    case 11:
+    case 12:
+	result = 1;
+    case 13:
+	result = result + 10;
+	break;
+    case 15:
+	result = 100;
+	break;
+    case 500:
+	result = 500;
+	break;
+    case 2000:
+    default:
+	result = -1;
+    }
+
+    return result;
+}
+
+int main(void)
+{
+    int i;
+    char c;
+
+    /* countdown: push 5; loop: print; push 1; sub; dup; jnz loop; halt */
+
+    code[0] = 1; code[1] = 5;
+    code[2] = 6;
+    code[3] = 1; code[4] = 1;
+    code[5] = 3;
+    code[6] = 5;
+    code[7] = 7; code[8] = 2;
+    code[9] = 1; code[10] = 6;
+    code[11] = 5;
+    code[12] = 4;
+    code[13] = 0;
+    printf("%d\n", run(code));
+
+    code[0] = 9;
+    printf("%d\n", run(code));
+
+    i = -101;
+
+    while (i < 100001) {
+	if (sparse(i) != 0)
+	    printf("sparse %d %d\n", i, sparse(i));
+
+	if (i < 3000 && mixed(i) != -1)
+	    printf("mixed %d %d\n", i, mixed(i));
+
+	i = i + 1;
+    }
+
+    i = 0;
+
+    while (i < 10) {
+	c = i;
+
+	switch (c) {
+	case 3:
+	    i = i + 1;
+	    break;
+	}
+
+	if (i == 7)
+	    break;
+
+	i = i + 1;
+    }
+
+    printf("%d\n", i);
+    return 0;
+}
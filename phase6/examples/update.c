@@ -0,0 +1,101 @@
+/* update.c */
+
+int g, ga[5];
+char gc;
+double gd;
+int *gp;
+
+int next(int *p)
+{
+    return (*p)++;
+}
+
+int main(void)
+{
+    int i, j, a[10], *p, sum;
+    char c;
+    double d;
+
+    i = 0;
+    while (i < 10) {
+	a[i] = i * i;
+	i++;
+    }
+
+    p = a;
+    sum = 0;
+    j = 0;
+    while (j < 10) {
+	sum += *p++;
+	++j;
+    }
+    printf("%d %d %d\n", sum, j, p - a);
+
+    p = &a[9];
+    while (p >= a) {
+	printf("%d ", *p);
+	p -= 3;
+    }
+    printf("\n");
+
+    i = 5;
+    j = i++;
+    printf("%d %d\n", j, i);
+    j = ++i;
+    printf("%d %d\n", j, i);
+    j = i--;
+    printf("%d %d\n", j, --i);
+
+    c = 126;
+    c++;
+    c += 2;
+    printf("%d\n", c);
+    gc = 10;
+    gc *= 3;
+    gc--;
+    printf("%d\n", gc);
+
+    d = 1.5;
+    d++;
+    d *= 3;
+    d -= 0.25;
+    d /= 2;
+    printf("%f\n", d++);
+    printf("%f\n", d);
+    i = 7;
+    i += 2.5;
+    printf("%d\n", i);
+    i = -3;
+    i += 2.5;
+    printf("%d\n", i);
+    i *= 6;
+    i /= 4;
+    printf("%d\n", i);
+
+    g = 100;
+    g += 5;
+    g -= 1;
+    g++;
+    --g;
+    printf("%d\n", g);
+
+    gp = ga;
+    *gp++ = 1;
+    *gp++ = 2;
+    gp += 1;
+    *gp = 4;
+    gp--;
+    *gp += 2;
+    ga[4] = 0;
+    i = 0;
+    ga[i++] += 10;
+    ga[++i] *= 7;
+    printf("%d %d %d %d %d %d\n", ga[0], ga[1], ga[2], ga[3], ga[4], i);
+
+    i = 3;
+    j = next(&i);
+    printf("%d %d\n", j, i);
+    j = next(&i) + next(&i);
+    printf("%d %d\n", j, i);
+    return 0;
+}
@@ -0,0 +1,63 @@
+/* vector.c */
+
+int *malloc(int n);
+
+int add(int *a, int *b, int *c, int n)
+{
+    int i;
+
+    i = 0;
+
+    while (i < n) {
+	c[i] = a[i] + b[i];
+	i = i + 1;
+    }
+}
+
+int axpy(double *x, double *y, double k, int n)
+{
+    int i;
+
+    i = 0;
+
+    while (i < n) {
+	y[i] = x[i] * k + y[i];
+	i = i + 1;
+    }
+}
+
+int main(void)
+{
+    int *a, *b;
+    double *x, *y;
+    int i, n;
+
+    n = 11;
+    a = malloc(n * sizeof(int));
+    b = malloc(n * sizeof(int));
+    x = (double *) malloc(n * sizeof(double));
+    y = (double *) malloc(n * sizeof(double));
+
+    i = 0;
+
+    while (i < n) {
+	a[i] = i;
+	b[i] = 10 * i;
+	x[i] = i;
+	y[i] = 0.5;
+	i = i + 1;
+    }
+
+    add(a, b, b, n);
+    axpy(x, y, 2.5, n);
+
+    a[0] = 1;
+    add(a, a, a + 1, n - 1);
+
+    i = 0;
+
+    while (i < n) {
+	printf("%d %d %f\n", a[i], b[i], y[i]);
+	i = i + 1;
+    }
+}
@@ -0,0 +1,291 @@
+#!/bin/sh
+#
+# File:		difftest.sh
+#
+# Description:	This file contains the runner for differential testing.
+#		Each program is compiled by scc with each set of flags in
+#		VARIANTS and by gcc, and all of the executables are run in
+#		parallel on the same input.  Any variant that fails to
+#		compile, crashes, or writes different output is reported.
+#
+#		The programs are first those of the tests and examples,
+#		whose expected output is known, and then COUNT random
+#		programs from the generator, starting at SEED, for which
+#		the output of gcc is taken as the truth, or that of the
+#		first variant if gcc is not available.  A random program
+#		on which a variant diverges is saved to FAILURES and then
+#		reduced by repeatedly deleting lines for as long as the
+#		same variant still diverges.  The reduced program may no
+#		longer be free of undefined behavior, so it should be read
+#		with care.
+#
+#		usage: difftest.sh [-r] [count]
+#
+#		The -r option skips the tests and examples.  The
+#		environment may override SCC, VARIANTS, a comma-separated
+#		list of sets of flags, CC, GCCFLAGS, LDLIBS, SEED, SIZE,
+#		TIMEOUT, and FAILURES.
+#
+
+SCC=${SCC:-../scc}
+VARIANTS=${VARIANTS:--O0,-O1,-O2,-O2 -fomit-frame-pointer,-O2 -fno-if-conversion}
+CC=${CC:-gcc -m32}
+GCCFLAGS=${GCCFLAGS:--O2 -std=gnu89 -fno-builtin -w -msse2 -mfpmath=sse}
+LDLIBS=${LDLIBS:--lm}
+SEED=${SEED:-1}
+SIZE=${SIZE:-20}
+TIMEOUT=${TIMEOUT:-10}
+FAILURES=${FAILURES:-failures}
+
+corpus=yes
+count=100
+failed=0
+work=$(mktemp -d)
+trap 'rm -rf "$work"' 0
+
+if [ "$1" = -r ]; then
+    corpus=no
+    shift
+fi
+
+if [ $# -gt 0 ]; then
+    count=$1
+fi
+
+nvariants=$(echo "$VARIANTS" | awk -F, '{ print NF }')
+
+
+# Print the flags of the numbered variant, or "gcc" for variant zero.
+
+flags()
+{
+    if [ "$1" -eq 0 ]; then
+	echo gcc
+    else
+	echo "$VARIANTS" | cut -d, -f"$1"
+    fi
+}
+
+
+# Build the numbered variant of a program, together with an optional
+# object file holding a main function, into the given directory.
+
+build()
+{
+    if [ "$1" -eq 0 ]; then
+	$CC $GCCFLAGS -o "$4/a.out" "$2" $3 $LDLIBS
+    elif echo " $(flags "$1") " | grep -q ' -c '; then
+	$SCC $(flags "$1") -o "$4/a.o" < "$2" &&
+	    $CC -o "$4/a.out" "$4/a.o" $3 $LDLIBS
+    else
+	$SCC $(flags "$1") < "$2" > "$4/a.s" &&
+	    $CC -c -o "$4/a.o" "$4/a.s" &&
+	    $CC -o "$4/a.out" "$4/a.o" $3 $LDLIBS
+    fi
+}
+
+
+# Build and run the given variants of a program on the given input in
+# parallel.  The result of each variant is left in its directory: the
+# file "status" holds "build" if it failed to build, or the exit status
+# of the program otherwise, and the file "output" holds its output.
+
+check()
+{
+    program=$1 object=$2 input=$3
+    shift 3
+
+    for v in "$@"; do
+	(
+	    dir=$work/$v
+	    rm -rf "$dir"
+	    mkdir "$dir"
+
+	    if build "$v" "$program" "$object" "$dir" > /dev/null 2>&1; then
+		timeout "$TIMEOUT" "$dir/a.out" < "$input" > "$dir/output" 2> /dev/null
+		echo $? > "$dir/status"
+	    else
+		echo build > "$dir/status"
+	    fi
+	) &
+    done
+
+    wait
+}
+
+
+# Print the result of a variant compared with the expected output: ok if
+# it built and its output matches, and what went wrong if not.  The
+# programs of the tests need not return a value from main, so the exit
+# status only explains a difference in the output.
+
+result()
+{
+    status=$(cat "$work/$1/status")
+
+    if [ "$status" = build ]; then
+	echo "failed to build"
+    elif [ "$status" = 124 ]; then
+	echo "timed out"
+    elif cmp -s "$work/$1/output" "$2"; then
+	echo ok
+    elif [ "$status" -ge 128 ]; then
+	echo "crashed with signal $((status - 128))"
+    else
+	echo "wrong output"
+    fi
+}
+
+
+# Return whether the reference variant of a candidate program still
+# works and the given variant still diverges from it.
+
+diverges()
+{
+    check "$1" "" /dev/null "$2" "$3"
+    [ "$(cat "$work/$2/status")" = 0 ] || return 1
+    cp "$work/$2/output" "$work/expected"
+    [ "$(result "$3" "$work/expected")" != ok ]
+}
+
+
+# Print the ranges of lines of the blocks of a program, largest first.
+# The block of a function includes its header.
+
+blocks()
+{
+    awk '
+	/^ *}/ { start = stack[depth--]; print NR - start + 1, start "," NR }
+	/{$/ { stack[++depth] = $0 == "{" ? NR - 1 : NR }
+    ' "$1" | sort -rn | cut -d" " -f2
+}
+
+
+# Reduce a program on which the given variant diverges from the
+# reference, by deleting whole blocks while we can, and then chunks of
+# lines of decreasing size.
+
+reduce()
+{
+    cp "$1" "$work/reduced.c"
+    changed=yes
+
+    while [ $changed = yes ]; do
+	changed=no
+
+	for range in $(blocks "$work/reduced.c"); do
+	    sed "${range}d" "$work/reduced.c" > "$work/candidate.c"
+
+	    if diverges "$work/candidate.c" "$2" "$3"; then
+		mv "$work/candidate.c" "$work/reduced.c"
+		changed=yes
+		break
+	    fi
+	done
+    done
+
+    lines=$(wc -l < "$work/reduced.c")
+    chunk=$((lines / 2))
+
+    while [ $chunk -ge 1 ]; do
+	first=1
+
+	while [ $first -le "$lines" ]; do
+	    sed "$first,$((first + chunk - 1))d" "$work/reduced.c" > "$work/candidate.c"
+
+	    if diverges "$work/candidate.c" "$2" "$3"; then
+		mv "$work/candidate.c" "$work/reduced.c"
+		lines=$(wc -l < "$work/reduced.c")
+	    else
+		first=$((first + chunk))
+	    fi
+	done
+
+	chunk=$((chunk / 2))
+    done
+
+    cp "$work/reduced.c" "$4"
+}
+
+
+variants=$(seq 1 "$nvariants")
+
+
+# The tests and examples, against their expected output.
+
+if [ $corpus = yes ]; then
+    for program in ../tests/*.c ../examples/*.c; do
+	base=${program%.c}
+	object=
+
+	if [ -s "$base.main" ]; then
+	    object=$work/main.o
+	    $CC $GCCFLAGS -c -x c -o "$object" "$base.main" 2> /dev/null
+	fi
+
+	check "$program" "$object" "$base.in" $variants
+
+	for v in $variants; do
+	    outcome=$(result "$v" "$base.out")
+
+	    if [ "$outcome" != ok ]; then
+		echo "$(basename "$program") [$(flags "$v")]: $outcome"
+		failed=$((failed + 1))
+	    fi
+	done
+    done
+fi
+
+
+# Random programs, against gcc or the first variant.
+
+if [ $count -gt 0 ]; then
+    mkdir -p "$FAILURES"
+    ./generate 1 1 > "$work/program.c"
+    check "$work/program.c" "" /dev/null 0
+    reference=1
+
+    if [ "$(cat "$work/0/status")" = 0 ]; then
+	reference=0
+    fi
+
+    echo "random programs checked against $(flags $reference)"
+fi
+
+seed=$SEED
+
+while [ $seed -lt $((SEED + count)) ]; do
+    ./generate $seed "$SIZE" > "$work/program.c"
+    check "$work/program.c" "" /dev/null $reference $variants
+
+    if [ "$(cat "$work/$reference/status")" != 0 ]; then
+	echo "seed $seed [$(flags $reference)]: $(result $reference /dev/null)"
+	failed=$((failed + 1))
+	seed=$((seed + 1))
+	continue
+    fi
+
+    cp "$work/$reference/output" "$work/expected"
+    : > "$work/divergent"
+
+    for v in $variants; do
+	outcome=$(result "$v" "$work/expected")
+
+	if [ "$outcome" != ok ] && [ "$v" != $reference ]; then
+	    echo "$v $outcome" >> "$work/divergent"
+	fi
+    done
+
+    while read -r v outcome; do
+	saved=$FAILURES/seed$seed-$v
+	cp "$work/program.c" "$saved.c"
+	reduce "$saved.c" $reference "$v" "$saved.reduced.c"
+	echo "seed $seed [$(flags "$v")]: $outcome, reduced to $saved.reduced.c"
+	failed=$((failed + 1))
+    done < "$work/divergent"
+
+    seed=$((seed + 1))
+done
+
+echo "$failed failures"
+[ $failed -eq 0 ]
@@ -0,0 +1,510 @@
+/*
+ * File:	generate.cpp
+ *
+ * Description:	This file contains a generator of random Simple C programs
+ *		for differential testing.  The programs use chars, ints,
+ *		doubles, pointers, arrays, while, if, and switch
+ *		statements, and calls, and print their state as they run, so that any two
+ *		correct compilers must produce the same output.
+ *
+ *		Every program is free of undefined behavior.  Integers are
+ *		reduced modulo 1000 whenever they are assigned, so that a
+ *		product of three of them cannot overflow.  Division goes
+ *		through a function that avoids a zero divisor, and array
+ *		indices go through one that keeps them in bounds.  Doubles
+ *		are reset if they grow too large to convert to an int.
+ *		Loops have counters of their own that nothing else
+ *		assigns, and calls only go to functions defined earlier,
+ *		so every program terminates.
+ *
+ *		Each statement and brace is on a line of its own, so that
+ *		the program can be reduced by deleting lines.
+ *
+ *		usage: generate seed [statements]
+ */
+
+# include <string>
+# include <vector>
+# include <cstdlib>
+# include <sstream>
+# include <iostream>
+
+using namespace std;
+
+# define FUNCTIONS 4
+# define ARRAY 8
+# define MAX_DEPTH 3
+
+static unsigned long seed;
+static unsigned budget, depth;
+static vector<string> ints, chars, doubles, arrays;
+static unsigned functions;
+
+
+/*
+ * Function:	choose
+ *
+ * Description:	Return a pseudo-random number less than the given bound.
+ */
+
+static unsigned choose(unsigned bound)
+{
+    seed = (seed * 1103515245 + 12345) % 2147483648UL;
+    return (seed >> 8) % bound;
+}
+
+
+/*
+ * Function:	pick
+ *
+ * Description:	Return a random element of a list of names.
+ */
+
+static const string &pick(const vector<string> &names)
+{
+    return names[choose(names.size())];
+}
+
+
+/*
+ * Function:	indent
+ *
+ * Description:	Return the indentation for the current depth.
+ */
+
+static string indent()
+{
+    return string(4 * (depth + 1), ' ');
+}
+
+
+/*
+ * Function:	term
+ *
+ * Description:	Return an integer operand.
+ */
+
+static string term()
+{
+    switch (choose(8)) {
+    case 0:
+    case 1:
+	return to_string(choose(100));
+
+    case 2:
+	return pick(chars);
+
+    case 3:
+	return pick(arrays) + "[slot(" + pick(ints) + ")]";
+
+    case 4:
+	return "*p";
+
+    default:
+	return pick(ints);
+    }
+}
+
+
+/*
+ * Function:	condition
+ *
+ * Description:	Return an integer expression whose value is zero or one.
+ */
+
+static string condition()
+{
+    static const char *relations[] = {" < ", " > ", " <= ", " >= ", " == ", " != "};
+    string cond;
+
+
+    if (choose(6) == 0)
+	return "!" + term();
+
+    cond = term() + relations[choose(6)] + term();
+
+    if (choose(3) == 0)
+	cond += (choose(2) ? " && " : " || ") + term() + relations[choose(6)] + term();
+
+    return cond;
+}
+
+
+/*
+ * Function:	atom
+ *
+ * Description:	Return an integer operand no larger than 1000 in
+ *		magnitude.
+ */
+
+static string atom()
+{
+    switch (choose(10)) {
+    case 0:
+	return "(" + condition() + ")";
+
+    case 1:
+	return "quotient(" + term() + ", " + term() + ")";
+
+    case 2:
+	return "modulo(" + term() + ", " + term() + ")";
+
+    case 3:
+	return "-" + term();
+
+    default:
+	return term();
+    }
+}
+
+
+/*
+ * Function:	expression
+ *
+ * Description:	Return an integer expression of up to three operands.
+ */
+
+static string expression()
+{
+    static const char *operators[] = {" + ", " - ", " * "};
+    string expr = atom();
+
+    for (unsigned i = choose(3); i > 0; i --)
+	expr += operators[choose(3)] + atom();
+
+    return expr;
+}
+
+
+/*
+ * Function:	real
+ *
+ * Description:	Return a double expression.
+ */
+
+static string real()
+{
+    static const char *operators[] = {" + ", " - ", " * "};
+    string expr;
+
+
+    for (unsigned i = choose(3); ; i --) {
+	switch (choose(4)) {
+	case 0:
+	    expr += to_string(choose(100)) + "." + to_string(choose(10));
+	    break;
+
+	case 1:
+	    expr += pick(ints);
+	    break;
+
+	case 2:
+	    expr += pick(doubles) + " / 2.0";
+	    break;
+
+	default:
+	    expr += pick(doubles);
+	    break;
+	}
+
+	if (i == 0)
+	    return expr;
+
+	expr += operators[choose(3)];
+    }
+}
+
+
+/*
+ * Function:	lvalue
+ *
+ * Description:	Return an integer location to assign.
+ */
+
+static string lvalue()
+{
+    switch (choose(6)) {
+    case 0:
+	return pick(arrays) + "[slot(" + expression() + ")]";
+
+    case 1:
+	return "*p";
+
+    default:
+	return pick(ints);
+    }
+}
+
+
+static void statements(unsigned n);
+
+
+/*
+ * Function:	statement
+ *
+ * Description:	Write a random statement.
+ */
+
+static void statement()
+{
+    string var, counter;
+    long value;
+
+
+    budget --;
+
+    switch (choose(depth < MAX_DEPTH ? 16 : 10)) {
+    case 0:
+	var = pick(doubles);
+	cout << indent() << var << " = " << real() << ";" << endl;
+	cout << indent() << "if (" << var << " > 1000000.0 || " << var << " < -1000000.0)" << endl;
+	cout << indent() << "    " << var << " = 0.5;" << endl;
+	break;
+
+    case 1:
+	var = pick(ints);
+	cout << indent() << var << " = " << pick(doubles) << ";" << endl;
+	cout << indent() << var << " = " << var << " % 1000;" << endl;
+	break;
+
+    case 2:
+	cout << indent() << pick(chars) << " = " << expression() << ";" << endl;
+	break;
+
+    case 3:
+	if (choose(2))
+	    cout << indent() << "p = &" << pick(ints) << ";" << endl;
+	else
+	    cout << indent() << "p = " << pick(arrays) << " + slot(" << expression() << ");" << endl;
+
+	break;
+
+    case 4:
+	if (functions > 0) {
+	    cout << indent() << lvalue() << " = f" << choose(functions) << "(";
+	    cout << "(" << expression() << ") % 1000, (" << expression() << ") % 1000) % 1000;" << endl;
+	    break;
+	}
+
+	/* fall through */
+
+    case 5:
+	cout << indent() << "printf(\"%d %d\\n\", " << pick(ints) << ", " << pick(chars) << ");" << endl;
+	break;
+
+    case 10:
+    case 11:
+	cout << indent() << "if (" << condition() << ") {" << endl;
+	depth ++;
+	statements(1 + choose(3));
+	depth --;
+
+	if (choose(2)) {
+	    cout << indent() << "} else {" << endl;
+	    depth ++;
+	    statements(1 + choose(3));
+	    depth --;
+	}
+
+	cout << indent() << "}" << endl;
+	break;
+
+    case 12:
+    case 13:
+	counter = "k" + to_string(depth);
+	cout << indent() << counter << " = 0;" << endl;
+	cout << indent() << "while (" << counter << " < " << 1 + choose(6) << ") {" << endl;
+	depth ++;
+	statements(1 + choose(3));
+
+	if (choose(2))
+	    cout << indent() << counter << " = " << counter << " + 1;" << endl;
+	else
+	    cout << indent() << counter << (choose(2) ? " += 1;" : "++;") << endl;
+
+	depth --;
+	cout << indent() << "}" << endl;
+	break;
+
+    case 14:
+    case 15:
+	cout << indent() << "switch (" << expression() << ") {" << endl;
+	value = (long) choose(200) - 100;
+
+	for (unsigned i = 1 + choose(8); i > 0; i --) {
+	    cout << indent() << "case " << value << ":" << endl;
+	    depth ++;
+	    statements(1 + choose(2));
+
+	    if (choose(4) > 0)
+		cout << indent() << "break;" << endl;
+
+	    depth --;
+	    value += choose(4) > 0 ? 1 + choose(2) : 1 + choose(500);
+	}
+
+	if (choose(2)) {
+	    cout << indent() << "default:" << endl;
+	    depth ++;
+	    statements(1 + choose(2));
+	    depth --;
+	}
+
+	cout << indent() << "}" << endl;
+	break;
+
+    default:
+	cout << indent() << lvalue() << " = (" << expression() << ") % 1000;" << endl;
+	break;
+    }
+}
+
+
+/*
+ * Function:	statements
+ *
+ * Description:	Write up to the given number of statements, as the
+ *		budget allows.
+ */
+
+static void statements(unsigned n)
+{
+    while (n -- > 0 && budget > 0)
+	statement();
+}
+
+
+/*
+ * Function:	function
+ *
+ * Description:	Write a function with the given name and parameters.
+ *		Its locals shadow nothing, so that the globals it uses
+ *		are visible.
+ */
+
+static void function(const string &name, const string &params, unsigned size)
+{
+    vector<string> globalInts = ints, globalChars = chars, globalDoubles = doubles;
+    vector<string> globalArrays = arrays;
+
+
+    cout << "int " << name << "(" << params << ")" << endl;
+    cout << "{" << endl;
+    cout << "    int x0, x1, x2, k0, k1, k2;" << endl;
+    cout << "    char c;" << endl;
+    cout << "    double y;" << endl;
+    cout << "    int a[" << ARRAY << "];" << endl;
+    cout << "    int *p;" << endl << endl;
+
+    cout << "    x0 = " << choose(100) << ";" << endl;
+    cout << "    x1 = " << choose(100) << ";" << endl;
+    cout << "    x2 = " << choose(100) << ";" << endl;
+    cout << "    c = " << choose(100) << ";" << endl;
+    cout << "    y = " << choose(100) << ".5;" << endl;
+    cout << "    p = &x0;" << endl;
+    cout << "    k0 = 0;" << endl;
+
+    cout << "    while (k0 < " << ARRAY << ") {" << endl;
+    cout << "        a[k0] = k0 * " << choose(10) << ";" << endl;
+    cout << "        k0 = k0 + 1;" << endl;
+    cout << "    }" << endl;
+
+    ints.insert(ints.end(), {"x0", "x1", "x2"});
+    chars.push_back("c");
+    doubles.push_back("y");
+    arrays.push_back("a");
+
+    if (params != "void")
+	ints.insert(ints.end(), {"u", "v"});
+
+    depth = 0;
+    budget = size;
+    statements(size);
+
+    if (name == "main") {
+	for (unsigned i = 0; i < ints.size(); i ++)
+	    cout << "    printf(\"" << ints[i] << " %d\\n\", " << ints[i] << ");" << endl;
+
+	for (unsigned i = 0; i < chars.size(); i ++)
+	    cout << "    printf(\"" << chars[i] << " %d\\n\", " << chars[i] << ");" << endl;
+
+	for (unsigned i = 0; i < doubles.size(); i ++)
+	    cout << "    printf(\"" << doubles[i] << " %f\\n\", " << doubles[i] << ");" << endl;
+
+	cout << "    k0 = 0;" << endl;
+	cout << "    while (k0 < " << ARRAY << ") {" << endl;
+	cout << "        printf(\"%d %d\\n\", a[k0], g[k0]);" << endl;
+	cout << "        k0 = k0 + 1;" << endl;
+	cout << "    }" << endl;
+	cout << "    return 0;" << endl;
+    } else
+	cout << "    return (" << expression() << ") % 1000;" << endl;
+
+    cout << "}" << endl << endl;
+
+    ints = globalInts;
+    chars = globalChars;
+    doubles = globalDoubles;
+    arrays = globalArrays;
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Write a random program for the given seed.
+ */
+
+int main(int argc, char *argv[])
+{
+    unsigned size = 20;
+
+
+    if (argc < 2 || argc > 3) {
+	cerr << "usage: generate seed [statements]" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    seed = strtoul(argv[1], NULL, 10);
+
+    if (argc == 3)
+	size = strtoul(argv[2], NULL, 10);
+
+    cout << "/* generate " << seed << " " << size << " */" << endl << endl;
+    cout << "int g0, g1, g2;" << endl;
+    cout << "char h0, h1;" << endl;
+    cout << "double e0, e1;" << endl;
+    cout << "int g[" << ARRAY << "];" << endl << endl;
+
+    ints = {"g0", "g1", "g2"};
+    chars = {"h0", "h1"};
+    doubles = {"e0", "e1"};
+    arrays = {"g"};
+
+    cout << "int slot(int i)" << endl;
+    cout << "{" << endl;
+    cout << "    if (i < 0)" << endl;
+    cout << "        i = -i;" << endl << endl;
+    cout << "    return i % " << ARRAY << ";" << endl;
+    cout << "}" << endl << endl;
+
+    cout << "int quotient(int i, int j)" << endl;
+    cout << "{" << endl;
+    cout << "    if (j == 0)" << endl;
+    cout << "        return i;" << endl << endl;
+    cout << "    return i / j;" << endl;
+    cout << "}" << endl << endl;
+
+    cout << "int modulo(int i, int j)" << endl;
+    cout << "{" << endl;
+    cout << "    if (j == 0)" << endl;
+    cout << "        return i;" << endl << endl;
+    cout << "    return i % j;" << endl;
+    cout << "}" << endl << endl;
+
+    for (functions = 0; functions < FUNCTIONS; functions ++)
+	function("f" + to_string(functions), "int u, int v", size);
+
+    function("main", "void", size);
+    exit(EXIT_SUCCESS);
+}
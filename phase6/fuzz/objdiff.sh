@@ -0,0 +1,108 @@
+#!/bin/sh
+#
+# File:		objdiff.sh
+#
+# Description:	This file contains the checker for the object files that
+#		scc writes itself with -c.  Each program is compiled by scc
+#		with each set of flags in VARIANTS, once to assembly, which
+#		is then assembled by AS, and once directly to an object.
+#		The two objects should disassemble to the same instructions
+#		with the same relocations, and have the same contents and
+#		symbols, so any difference in what objdump and readelf show
+#		of them is reported.
+#
+#		The programs are those of the tests, the examples, and the
+#		benchmarks, followed by COUNT random programs from the
+#		generator, starting at SEED.  Programs that scc or AS cannot
+#		compile at all are skipped, but scc -c must then fail too.
+#
+#		usage: objdiff.sh [count]
+#
+#		The environment may override SCC, VARIANTS, a comma-separated
+#		list of sets of flags, AS, SEED, and SIZE.
+#
+
+SCC=${SCC:-../scc}
+VARIANTS=${VARIANTS:--O0,-O1,-O2,-O2 -fomit-frame-pointer,-O2 -fprofile-generate}
+AS=${AS:-as --32}
+SEED=${SEED:-1}
+SIZE=${SIZE:-20}
+
+count=100
+checked=0
+failed=0
+work=$(mktemp -d)
+trap 'rm -rf "$work"' 0
+
+if [ $# -gt 0 ]; then
+    count=$1
+fi
+
+nvariants=$(echo "$VARIANTS" | awk -F, '{ print NF }')
+
+
+# Print what objdump and readelf show of an object file, leaving out
+# the name of the file, where things are in it, and the sizes of the
+# string tables, which the assembler may shorten by sharing suffixes.
+
+show()
+{
+    objdump -dr "$1" | tail -n +3
+    objdump -s "$1" | tail -n +3
+    readelf -sW "$1"
+    readelf -SW "$1" | grep '^ *\[' |
+	sed -e 's/ [0-9a-f]\{8\} [0-9a-f]\{6\} / /' -e '/STRTAB/s/ [0-9a-f]\{6\} / /'
+}
+
+
+# Compile a program both ways with the numbered variant and compare the
+# objects.
+
+compare()
+{
+    flags=$(echo "$VARIANTS" | cut -d, -f"$2")
+    checked=$((checked + 1))
+
+    if ! $SCC $flags < "$1" > "$work/a.s" 2> /dev/null ||
+	    ! $AS -o "$work/a.o" "$work/a.s" 2> /dev/null; then
+	if $SCC $flags -c -o "$work/b.o" < "$1" 2> /dev/null; then
+	    echo "$3 [$flags]: assembled what as could not"
+	    failed=$((failed + 1))
+	fi
+
+	return
+    fi
+
+    if ! $SCC $flags -c -o "$work/b.o" < "$1" 2> "$work/errors"; then
+	echo "$3 [$flags]: $(head -1 "$work/errors")"
+	failed=$((failed + 1))
+    elif ! show "$work/a.o" > "$work/a.txt" 2>&1 ||
+	    ! show "$work/b.o" > "$work/b.txt" 2>&1 ||
+	    ! cmp -s "$work/a.txt" "$work/b.txt"; then
+	echo "$3 [$flags]: objects differ"
+	diff "$work/a.txt" "$work/b.txt" | head -10
+	failed=$((failed + 1))
+    fi
+}
+
+
+for program in ../tests/*.c ../examples/*.c ../bench/*.c; do
+    for v in $(seq 1 "$nvariants"); do
+	compare "$program" "$v" "$(basename "$program")"
+    done
+done
+
+seed=$SEED
+
+while [ $seed -lt $((SEED + count)) ]; do
+    ./generate $seed "$SIZE" > "$work/program.c"
+
+    for v in $(seq 1 "$nvariants"); do
+	compare "$work/program.c" "$v" "seed $seed"
+    done
+
+    seed=$((seed + 1))
+done
+
+echo "$checked objects compared, $failed failures"
+[ $failed -eq 0 ]
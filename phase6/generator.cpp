@@ -6,15 +6,23 @@
  *
  *		Extra functionality:
  *		- putting all the global declarations at the end
+ *		- pooling identical literals, which are written once into
+ *		  the read-only data section at the end
  */
 
+# include <map>
+# include <vector>
+# include <unordered_map>
+# include <cstdlib>
 # include <sstream>
 # include <iostream>
 # include "generator.h"
+# include "cache.h"
 # include "Label.h"
 # include "machine.h"
 # include "Tree.h"
 # include "Register.h"
+# include "options.h"
 
 using namespace std;
 
@@ -55,6 +63,27 @@ Register *mm7 = new Register("%xmm7", "%al");
 vector<Register *> fp_registers{mm0, mm1, mm2, mm3, mm4, mm5, mm6, mm7};
 int offset = 0;
 
+/* Without a frame pointer, we need to know how far %esp has moved */
+
+static string functionName;
+static int depth;
+static bool leaf;
+
+/* The labels to which a break statement jumps, innermost last */
+
+static vector<Label> breaks;
+
+/* The temporaries of the current statement */
+
+static int tempBase, tempOffset, naiveOffset;
+static map<Expression *, int> temps;
+static map<unsigned, vector<int>> freeTemps;
+
+/* The literal pool, in the order in which literals were first used */
+
+static unordered_map<string, string> pool;
+static vector<string> strings, reals, tables;
+
 # if CALLEE_SAVED
 static Registers callee_saved = {ebx, esi, edi};
 # else
@@ -78,6 +107,101 @@ void generateGlobals(Scope *scope)
 	}
 }
 
+/*
+ * Function:	literal
+ *
+ * Description:	Return the label of a literal with the given directive
+ *		and text, adding it to the pool if it is not already
+ *		there.
+ */
+
+string literal(const string &directive, const string &text)
+{
+    string key = directive + "\t" + text;
+    unordered_map<string, string>::iterator it = pool.find(key);
+    stringstream ss;
+    Label label;
+
+
+    if (it != pool.end()) {
+	noteLiteral(directive, text, it->second);
+	return it->second;
+    }
+
+    ss << label;
+    pool[key] = ss.str();
+    noteLiteral(directive, text, ss.str());
+
+    if (directive == ".double")
+	reals.push_back(ss.str() + ":\t" + key);
+    else if (directive == ".long")
+	tables.push_back(ss.str() + ":\t" + key);
+    else
+	strings.push_back(ss.str() + ":\t" + key);
+
+    return ss.str();
+}
+
+
+/*
+ * Function:	generateLiterals
+ *
+ * Description:	Write the literal pool into the read-only data section.
+ *		Reals come first so they need only be aligned once, and
+ *		are followed by the jump tables, which stay aligned.
+ */
+
+void generateLiterals()
+{
+    if (strings.empty() && reals.empty() && tables.empty())
+	return;
+
+    cout << "\t.section\t.rodata" << endl;
+
+    if (!reals.empty())
+	cout << "\t.align\t" << SIZEOF_DOUBLE << endl;
+    else if (!tables.empty())
+	cout << "\t.align\t" << SIZEOF_INT << endl;
+
+    for (unsigned i = 0; i < reals.size(); i ++)
+	cout << reals[i] << endl;
+
+    for (unsigned i = 0; i < tables.size(); i ++)
+	cout << tables[i] << endl;
+
+    for (unsigned i = 0; i < strings.size(); i ++)
+	cout << strings[i] << endl;
+}
+
+
+/*
+ * Function:	operand (private)
+ *
+ * Description:	Return an operand as it should be written.  Operands
+ *		within the frame are always computed relative to %ebp.
+ *		Without a frame pointer, they are rewritten relative to
+ *		%esp, which lies below %ebp by the size of the frame and
+ *		by whatever has been pushed for calls in progress.
+ */
+
+static string operand(const string &s)
+{
+    stringstream ss;
+    int n;
+
+    if (!omitFramePointer || s.size() < 6 || s.compare(s.size() - 6, 6, "(%ebp)") != 0)
+	return s;
+
+    n = atoi(s.c_str()) + depth;
+    ss << functionName << ".size";
+
+    if (n != 0)
+	ss << showpos << n << noshowpos;
+
+    ss << "(%esp)";
+    return ss.str();
+}
+
 /*
  * Function:	operator << (private)
  *
@@ -89,7 +213,7 @@ void generateGlobals(Scope *scope)
 static ostream &operator <<(ostream &ostr, Expression *expr)
 {
     if (expr->_register == nullptr)
-		return ostr << expr->_operand;
+		return ostr << operand(expr->_operand);
 	unsigned size = expr->type().size();
 	return ostr << expr->_register->name(size);
 }
@@ -108,7 +232,7 @@ static void compareZero(Expression *expr) {
 		
 		Register *reg = fp_getreg();
 		cout << "\tpxor\t" << reg << ", " << reg << endl;
-		cout << "\tucomsid\t" << reg << ", " << expr << endl;
+		cout << "\tucomisd\t" << reg << ", " << expr << endl;
 		//assign(expr, nullptr);
 		assign(nullptr, reg);
 	}
@@ -155,19 +279,78 @@ void assign(Expression *expr, Register *reg) {
 	}
 }
 
+/*
+ * Function:	release
+ *
+ * Description:	Release all registers and temporaries.  This is only
+ *		done between statements, where nothing is live, so the
+ *		temporaries of one statement share their slots with those
+ *		of every other statement, including those in sibling
+ *		blocks, just as Block::allocate does for declared locals.
+ */
+
 void release() {
 	for(unsigned i = 0; i < registers.size(); i++)
 		assign(nullptr, registers[i]);
+
+	temps.clear();
+	freeTemps.clear();
+	tempOffset = tempBase;
 }
 
+/*
+ * Function:	assigntemp
+ *
+ * Description:	Assign a stack slot to hold the value of an expression.
+ *		A slot freed earlier in the statement is reused if one of
+ *		the same size is available; otherwise, a new slot aligned
+ *		to its size is allocated below the live ones.
+ */
+
 void assigntemp(Expression *expr) {
+	unsigned size = expr->type().size();
+	vector<int> &slots = freeTemps[size];
 	stringstream ss;
-	
-	offset = offset - expr->type().size();
-	ss << offset << "(%ebp)";
+	int slot;
+
+	naiveOffset -= size;
+
+	if(!slots.empty()) {
+		slot = slots.back();
+		slots.pop_back();
+	}
+	else {
+		tempOffset -= size;
+
+		while(tempOffset % (int) size != 0)
+			tempOffset--;
+
+		slot = tempOffset;
+		offset = min(offset, tempOffset);
+	}
+
+	temps[expr] = slot;
+	ss << slot << "(%ebp)";
 	expr->_operand = ss.str();
 }
 
+/*
+ * Function:	freetemp
+ *
+ * Description:	Free the stack slot of an expression whose value has been
+ *		loaded back into a register.  If the register is needed
+ *		again later, the value is simply spilled to a new slot.
+ */
+
+static void freetemp(Expression *expr) {
+	map<Expression *, int>::iterator it = temps.find(expr);
+
+	if(it != temps.end()) {
+		freeTemps[expr->type().size()].push_back(it->second);
+		temps.erase(it);
+	}
+}
+
 void load (Expression *expr, Register *reg) {
 	//cout << "\t#LOAD" << endl;
 	if(reg->_node != expr) {
@@ -176,18 +359,37 @@ void load (Expression *expr, Register *reg) {
 			assigntemp(reg->_node);
 			cout << "\tmov" << suffix(reg->_node);
 			cout << reg->name(size) << ", ";
-			cout << reg->_node->_operand << endl;
+			cout << operand(reg->_node->_operand) << endl;
 		}
 		
 		if(expr != nullptr) {
 			unsigned size = expr->type().size();
 			cout << "\tmov" << suffix(expr) << expr;
 			cout << ", " << reg->name(size) << endl;
+			freetemp(expr);
 		}
 		assign(expr, reg);
 	}
 }
 
+/*
+ * Function:	spill (private)
+ *
+ * Description:	Spill every register that holds a value.  This is done
+ *		before a call, which may clobber them, and before code
+ *		that is only conditionally executed, since a register
+ *		spilled on one path would otherwise be reloaded on both.
+ */
+
+static void spill()
+{
+	for(unsigned i = 0; i < registers.size(); i++)
+		load(nullptr, registers[i]);
+
+	for(unsigned i = 0; i < fp_registers.size(); i++)
+		load(nullptr, fp_registers[i]);
+}
+
 /*
  * Function:	align (private)
  *
@@ -244,24 +446,14 @@ void Integer::generate()
 
 void String::generate() {
 	//cout << "\t#STRING" << endl;
-	stringstream ss;
-	Label ll;
-	ss << ll;
-	_operand = ss.str();
-	cout << "\t.data" << endl;
-	cout << _operand << ":\t.asciz " << value() << "\n\t.text" << endl;
+	_operand = literal(".asciz", value());
 	//assign(this, getreg());
 	//cout << "\tleal\t" << _operand << ", " << _register << endl;
 }
 
 void Real::generate() {
 	//cout << "\t#REAL" << endl;
-	stringstream ss;
-	Label ll;
-	ss << ll;
-	_operand = ss.str();
-	cout << "\t.data" << endl;
-	cout << _operand << ":\t.double " << value() << "\n\t.text" << endl;
+	_operand = literal(".double", value());
 }
 
 /*
@@ -295,6 +487,7 @@ void Call::generate()
 
     if (align(bytesPushed) > 0) {
 	cout << "\tsubl\t$" << align(bytesPushed) << ", %esp" << endl;
+	depth += align(bytesPushed);
 	bytesPushed += align(bytesPushed);
     }
 
@@ -316,22 +509,20 @@ void Call::generate()
 			cout << "\tmovsd\t" << _args[i] << ", " << mm0 << endl;
 			cout << "\tsubl\t$8, %esp" << endl;
 			cout << "\tmovsd\t" << mm0 << ", (%esp)" << endl;
+			depth += 8;
 		}
 		else {
 			cout << "\tpushl\t" << _args[i] << endl;
+			depth += 4;
 		}
 	}
 
-	//spill registers load nullptr
-	for(unsigned i = 0; i < registers.size(); i++) {
-		load(nullptr, registers[i]);
-	}
-	for(unsigned i = 0; i < fp_registers.size(); i++) {
-		load(nullptr, fp_registers[i]);
-	}
+	spill();
+
     /* Call the function and then adjust the stack pointer back. */
 
     cout << "\tcall\t" << global_prefix << _id->name() << endl;
+	leaf = false;
 	
 	if(FP(this)) {
 		assigntemp(this);
@@ -342,6 +533,8 @@ void Call::generate()
 		
 	if (bytesPushed > 0)
 		cout << "\taddl\t$" << bytesPushed << ", %esp" << endl;
+
+	depth -= bytesPushed;
 }
 
 
@@ -395,49 +588,85 @@ void Function::generate()
 	returnLabel = ss.str();
 
     int param_offset;
+    stringstream body;
+    streambuf *saved;
 
 	//cout << "\t#FUNCGENERATE" << endl;
-    /* Generate our prologue. */
+    /* Allocate storage.  Without a frame pointer, nothing is pushed
+       between the return address and the callee-saved registers. */
 
     param_offset = PARAM_OFFSET + SIZEOF_REG * callee_saved.size();
+
+    if (omitFramePointer)
+	param_offset -= SIZEOF_REG;
+
     offset = param_offset;
     allocate(offset);
+    tempBase = naiveOffset = offset;
+    release();
+
+    functionName = _id->name();
+    depth = 0;
+    leaf = true;
+
+
+    /* Generate the body of this function.  We need to know the size of
+       the frame and whether we call anything before writing our
+       prologue, so the body is written to a buffer first. */
+
+    saved = cout.rdbuf(body.rdbuf());
+    _body->generate();
+    cout.rdbuf(saved);
+
+
+    /* Generate our prologue.  A leaf function without a frame pointer
+       does not need an aligned stack, since it calls nothing, and if it
+       has no frame then it needs no prologue at all. */
+
+    if (!omitFramePointer || !leaf)
+	offset -= align(offset - param_offset);
 
     cout << global_prefix << _id->name() << ":" << endl;
-    cout << "\tpushl\t%ebp" << endl;
+
+    if (!omitFramePointer)
+	cout << "\tpushl\t%ebp" << endl;
 
     for (unsigned i = 0; i < callee_saved.size(); i ++)
 	cout << "\tpushl\t" << callee_saved[i] << endl;
 
-    cout << "\tmovl\t%esp, %ebp" << endl;
+    if (!omitFramePointer)
+	cout << "\tmovl\t%esp, %ebp" << endl;
 
-    if (SIMPLE_PROLOGUE) {
-	offset -= align(offset - param_offset);
+    if (SIMPLE_PROLOGUE)
 	cout << "\tsubl\t$" << -offset << ", %esp" << endl;
-    } else
+    else if (!omitFramePointer || offset < 0)
 	cout << "\tsubl\t$" << _id->name() << ".size, %esp" << endl;
 
-	
-	
-    /* Generate the body of this function. */
-
-    _body->generate();
-
+    cout << body.str();
 	cout << returnLabel << ":" << endl;
 
     /* Generate our epilogue. */
 
-    cout << "\tmovl\t%ebp, %esp" << endl;
+    if (!omitFramePointer)
+	cout << "\tmovl\t%ebp, %esp" << endl;
+    else if (offset < 0)
+	cout << "\taddl\t$" << _id->name() << ".size, %esp" << endl;
 
     for (int i = callee_saved.size() - 1; i >= 0; i --)
 	cout << "\tpopl\t" << callee_saved[i] << endl;
 
-    cout << "\tpopl\t%ebp" << endl;
+    if (!omitFramePointer)
+	cout << "\tpopl\t%ebp" << endl;
+
     cout << "\tret" << endl << endl;
 
-    if (!SIMPLE_PROLOGUE) {
-	offset -= align(offset - param_offset);
+    if (!SIMPLE_PROLOGUE || omitFramePointer)
 	cout << "\t.set\t" << _id->name() << ".size, " << -offset << endl;
+
+    if (printStats) {
+	naiveOffset -= align(naiveOffset - param_offset);
+	cerr << _id->name() << ": frame size " << -offset << " bytes, ";
+	cerr << -naiveOffset << " without reusing temporaries" << endl;
     }
 
     cout << "\t.globl\t" << global_prefix << _id->name() << endl << endl;
@@ -479,6 +708,133 @@ void Assignment::generate()
 	assign(_right, nullptr);
 }
 
+/*
+ * Function:	Placeholder::generate
+ *
+ * Description:	Generate code for the old value of an updated lvalue.  The
+ *		update has already given us an operand.
+ */
+
+void Placeholder::generate() {
+}
+
+/*
+ * Function:	Update::generate
+ *
+ * Description:	Generate code for an update of an lvalue, whose address is
+ *		computed only once.  Adding an integer to or subtracting one
+ *		from an integer or pointer is a single instruction with the
+ *		lvalue as its destination, and the result is only loaded if
+ *		the value of the update is used.  Anything else computes the
+ *		new value from the placeholder and stores it back.
+ */
+
+void Update::generate() {
+	Expression *child = _left->isDeref();
+	Binary *binary = dynamic_cast<Binary *>(_expr);
+	Expression *amount = nullptr;
+	Integer *literal;
+	string opcode;
+	stringstream ss;
+	
+	if(binary != nullptr && binary->left() == _old && !FP(this) && !BYTE(this)) {
+		if(dynamic_cast<Add *>(_expr) != nullptr)
+			opcode = "add";
+		else if(dynamic_cast<Subtract *>(_expr) != nullptr)
+			opcode = "sub";
+		
+		if(!opcode.empty())
+			amount = binary->right();
+	}
+	
+	if(amount != nullptr)
+		amount->generate();
+	
+	cout << "\t#UPDATE" << endl;
+	
+	if(child != nullptr) {
+		child->generate();
+		if(child->_register == nullptr)
+			load(child, getreg());
+		ss << "(" << child->_register << ")";
+	}
+	else {
+		_left->generate();
+		ss << _left->_operand;
+	}
+	
+	_old->_operand = ss.str();
+	
+	if(amount == nullptr) {
+		if(child != nullptr)
+			load(_old, FP(this) ? fp_getreg() : getreg());
+		
+		if(_used && _postfix) {
+			_operand = _old->_operand;
+			load(this, FP(this) ? fp_getreg() : getreg());
+		}
+		
+		_expr->generate();
+		if(_expr->_register == nullptr)
+			load(_expr, FP(_expr) ? fp_getreg() : getreg());
+		
+		if(child != nullptr) {
+			if(child->_register == nullptr)
+				load(child, getreg());
+			cout << "\tmov" << suffix(this) << _expr << ", (" << child << ")" << endl;
+		}
+		else
+			cout << "\tmov" << suffix(this) << _expr << ", " << _left << endl;
+		
+		if(_used && !_postfix)
+			assign(this, _expr->_register);
+		else
+			assign(_expr, nullptr);
+		
+		assign(child, nullptr);
+		return;
+	}
+	
+	if(_used && _postfix) {
+		_operand = _old->_operand;
+		load(this, getreg());
+	}
+	
+	literal = dynamic_cast<Integer *>(amount);
+	
+	if(literal == nullptr && amount->_register == nullptr)
+		load(amount, getreg());
+	
+	if(child != nullptr && child->_register == nullptr)
+		load(child, getreg());
+	
+	if(literal != nullptr && literal->value() == "1")
+		cout << "\t" << (opcode == "add" ? "incl" : "decl") << "\t";
+	else
+		cout << "\t" << opcode << "l\t" << amount << ", ";
+	
+	if(child != nullptr)
+		cout << "(" << child << ")" << endl;
+	else
+		cout << _left << endl;
+	
+	assign(amount, nullptr);
+	
+	if(_used && !_postfix) {
+		ss.str("");
+		
+		if(child != nullptr)
+			ss << "(" << child->_register << ")";
+		else
+			ss << _left->_operand;
+		
+		_operand = ss.str();
+		load(this, getreg());
+	}
+	
+	assign(child, nullptr);
+}
+
 //Arithmetic
 void Add::generate() {
 	_left->generate();
@@ -598,18 +954,19 @@ void LessThan::generate() {
 	_right->generate();
 	
 	cout << "\t#LESSTHAN" << endl;
-	if(_left->_register == nullptr)
-		load(_left, FP(_left) ? fp_getreg() : getreg());
-	
 	if(FP(_left)) {
-		cout << "\tucomisd\t" << _right << ", " << _left << endl;
+		if(_right->_register == nullptr)
+			load(_right, fp_getreg());
+		cout << "\tucomisd\t" << _left << ", " << _right << endl;
 		assign(_right, nullptr);
 		assign(_left, nullptr);
 		assign(this, getreg());
-		cout << "\tsetb\t" << _register->byte() << endl;
+		cout << "\tseta\t" << _register->byte() << endl;
 	}
 	
 	else {
+		if(_left->_register == nullptr)
+			load(_left, getreg());
 		cout << "\tcmpl\t" << _right << ", " << _left << endl;
 		assign(_right, nullptr);
 		assign(_left, nullptr);
@@ -650,18 +1007,19 @@ void LessOrEqual::generate() {
 	_right->generate();
 	
 	cout << "\t#LESSEQUAL" << endl;
-	if(_left->_register == nullptr)
-		load(_left, FP(_left) ? fp_getreg() : getreg());
-	
 	if(FP(_left)) {
-		cout << "\tucomisd\t" << _right << ", " << _left << endl;
+		if(_right->_register == nullptr)
+			load(_right, fp_getreg());
+		cout << "\tucomisd\t" << _left << ", " << _right << endl;
 		assign(_right, nullptr);
 		assign(_left, nullptr);
 		assign(this, getreg());
-		cout << "\tsetbe\t" << _register->byte() << endl;
+		cout << "\tsetae\t" << _register->byte() << endl;
 	}
 	
 	else {
+		if(_left->_register == nullptr)
+			load(_left, getreg());
 		cout << "\tcmpl\t" << _right << ", " << _left << endl;
 		assign(_right, nullptr);
 		assign(_left, nullptr);
@@ -706,17 +1064,25 @@ void NotEqual::generate() {
 		load(_left, FP(_left) ? fp_getreg() : getreg());
 	
 	if(FP(_left)) {
+		Label skip;
 		cout << "\tucomisd\t" << _right << ", " << _left << endl;
+		assign(_right, nullptr);
+		assign(_left, nullptr);
+		assign(this, getreg());
+		cout << "\tmovl\t$1, " << this << endl;
+		cout << "\tjp\t" << skip << endl;
+		cout << "\tsetne\t" << _register->byte() << endl;
+		cout << skip << ":" << endl;
 	}
 	
 	else {
 		cout << "\tcmpl\t" << _right << ", " << _left << endl;
+		assign(_right, nullptr);
+		assign(_left, nullptr);
+		assign(this, getreg());
+		cout << "\tsetne\t" << _register->byte() << endl;
+		cout << "\tmovzbl\t" << _register->byte() << ", " << this << endl;
 	}
-	assign(_right, nullptr);
-	assign(_left, nullptr);
-	assign(this, getreg());
-	cout << "\tsetne\t" << _register->byte() << endl;
-	cout << "\tmovzbl\t" << _register->byte() << ", " << this << endl;
 }
 
 void Equal::generate() {
@@ -728,22 +1094,31 @@ void Equal::generate() {
 		load(_left, FP(_left) ? fp_getreg() : getreg());
 	
 	if(FP(_left)) {
+		Label skip;
 		cout << "\tucomisd\t" << _right << ", " << _left << endl;
+		assign(_right, nullptr);
+		assign(_left, nullptr);
+		assign(this, getreg());
+		cout << "\tmovl\t$0, " << this << endl;
+		cout << "\tjp\t" << skip << endl;
+		cout << "\tsete\t" << _register->byte() << endl;
+		cout << skip << ":" << endl;
 	}
 	
 	else {
 		cout << "\tcmpl\t" << _right << ", " << _left << endl;
+		assign(_right, nullptr);
+		assign(_left, nullptr);
+		assign(this, getreg());
+		cout << "\tsete\t" << _register->byte() << endl;
+		cout << "\tmovzbl\t" << _register->byte() << ", " << this << endl;
 	}
-	assign(_right, nullptr);
-	assign(_left, nullptr);
-	assign(this, getreg());
-	cout << "\tsete\t" << _register->byte() << endl;
-	cout << "\tmovzbl\t" << _register->byte() << ", " << this << endl;
 }
 
 void LogicalOr::generate() {
 cout << "\t#OR" << endl;
 	Label onTrue, skip;
+	spill();
 	_left->test(onTrue, true);
 	_right->test(onTrue, true);
 	assign(this, getreg());
@@ -757,6 +1132,7 @@ cout << "\t#OR" << endl;
 void LogicalAnd::generate() {
 	cout << "\t#AND" << endl;
 	Label onTrue, skip;
+	spill();
 	_left->test(onTrue, false);
 	_right->test(onTrue, false);
 	assign(this, getreg());
@@ -775,9 +1151,11 @@ void Negate::generate() {
 	if(_expr->_register == nullptr)
 		load(_expr, FP(_expr) ? fp_getreg() : getreg());
 	if(FP(_expr)) {
-		cout << "\tcmpl\t$0, " << _expr->_register << endl;
-		cout << "\tsete\t" << _expr->_register->byte() << endl;
-		cout << "\tmovzbl\t" << _expr->_register->byte() << ", " << _expr->_register << endl;
+		Register *reg = fp_getreg();
+		cout << "\tpxor\t" << reg << ", " << reg << endl;
+		cout << "\tsubsd\t" << _expr << ", " << reg << endl;
+		assign(_expr, nullptr);
+		assign(this, reg);
 	}
 	else {
 		cout << "\tnegl\t" << _expr->_register << endl;
@@ -793,13 +1171,15 @@ void Not::generate() {
 	}
 	if(FP(_expr)) {
 		Register *reg = fp_getreg();
-		assign(this, getreg());
+		Label skip;
 		cout << "\tpxor\t" << reg << ", " << reg << endl;
-		cout << "\tucomsid\t" << reg << ", " << _expr << endl;
-		cout << "\tsete\t" <<  _expr->_register->byte() << endl;
-		cout << "\tmovzbl\t" <<  _expr->_register->byte() << ", " <<  _expr->_register << endl;
+		cout << "\tucomisd\t" << reg << ", " << _expr << endl;
 		assign(_expr, nullptr);
-		assign(nullptr, reg);
+		assign(this, getreg());
+		cout << "\tmovl\t$0, " << this << endl;
+		cout << "\tjp\t" << skip << endl;
+		cout << "\tsete\t" << _register->byte() << endl;
+		cout << skip << ":" << endl;
 	}
 	else {
 		cout << "\tcmpl\t$0, " << _expr << endl;
@@ -821,7 +1201,7 @@ void Address::generate() {
 	else {
 		_expr->generate();
 		assign(this, getreg());
-		cout << "\tleal\t" << _expr->_operand << ", " << _register << endl;
+		cout << "\tleal\t" << operand(_expr->_operand) << ", " << _register << endl;
 	}
 }
 
@@ -833,7 +1213,7 @@ void Dereference::generate() {
 		load(_expr, getreg());
 	cout << "\tmov" << suffix(this) << "(" << _expr->_register << "), ";
 	assign(_expr, nullptr);
-	assign(this, FP(_expr) ? fp_getreg() : getreg());
+	assign(this, FP(this) ? fp_getreg() : getreg());
 	cout  << this << endl;
 }
 
@@ -893,7 +1273,7 @@ void Cast::generate() {
 		}
 		else if(dest.size() == 4) {
 			//char -> int
-			cout << "\tmovsbl\t" << _expr->_register->name() << ", " << this << endl;
+			cout << "\tmovsbl\t" << _expr << ", " << _expr->_register->name() << endl;
 			assign(this, _expr->_register);
 		}
 		else {
@@ -904,16 +1284,30 @@ void Cast::generate() {
 }
 
 //Control Flow
+/*
+ * Function:	While::generate
+ *
+ * Description:	Generate code for a while statement.  The loop is
+ *		rotated so that the test is at the bottom and branches back
+ *		to the aligned top of the body, with a copy of the test in
+ *		front to guard entry into the loop.
+ */
+
 void While::generate() {
 	Label loop, exit;
 	cout << "\t#LOOP" << endl;
-	cout << loop << ":" << endl;
 	
 	_expr->test(exit, false);
+	release();
+	cout << "\t.p2align\t4" << endl;
+	cout << loop << ":" << endl;
+	breaks.push_back(exit);
 	_stmt->generate();
+	breaks.pop_back();
 	release();
 	
-	cout << "\tjmp\t" << loop << endl;
+	_expr->test(loop, true);
+	release();
 	cout << exit << ":" << endl;
 }
 
@@ -951,6 +1345,87 @@ void If::generate() {
 	cout << skip << ":" << endl;
 }
 
+/*
+ * Function:	dispatch (private)
+ *
+ * Description:	Emit code to jump to the case whose value is in %eax,
+ *		among those in the given range of clusters, or to the
+ *		default label if there is none.  A few single cases are
+ *		compared in turn, a lone cluster of many cases becomes a
+ *		jump table behind a single unsigned range check, and
+ *		anything else is split in half by a binary search.
+ */
+
+static void dispatch(const Cases &cases, const Clusters &clusters,
+	unsigned first, unsigned last, const Label &deflt, Switch *stmt) {
+	unsigned mid;
+	long low, high;
+	stringstream table;
+	Label upper;
+	
+	if(stmt->linear(clusters, first, last)) {
+		for(unsigned i = first; i < last; i++) {
+			Case *label = cases[clusters[i].first];
+			cout << "\tcmpl\t$" << label->value() << ", " << eax << endl;
+			cout << "\tje\t" << label->_label << endl;
+		}
+		cout << "\tjmp\t" << deflt << endl;
+		return;
+	}
+	
+	if(last - first == 1) {
+		low = cases[clusters[first].first]->value();
+		high = cases[clusters[first].second - 1]->value();
+		
+		if(low != 0)
+			cout << "\tsubl\t$" << low << ", " << eax << endl;
+		cout << "\tcmpl\t$" << high - low << ", " << eax << endl;
+		cout << "\tja\t" << deflt << endl;
+		
+		for(unsigned i = clusters[first].first; i < clusters[first].second; i++) {
+			long next = i + 1 < clusters[first].second ? cases[i + 1]->value() : high + 1;
+			table << (i > clusters[first].first ? ", " : "") << cases[i]->_label;
+			for(long v = cases[i]->value() + 1; v < next; v++)
+				table << ", " << deflt;
+		}
+		cout << "\tjmp\t*" << literal(".long", table.str()) << "(," << eax << ",4)" << endl;
+		return;
+	}
+	
+	mid = (first + last) / 2;
+	cout << "\tcmpl\t$" << cases[clusters[mid].first]->value() << ", " << eax << endl;
+	cout << "\tjge\t" << upper << endl;
+	dispatch(cases, clusters, first, mid, deflt, stmt);
+	cout << upper << ":" << endl;
+	dispatch(cases, clusters, mid, last, deflt, stmt);
+}
+
+void Switch::generate() {
+	Label exit;
+	Clusters clusters = this->clusters();
+	
+	_expr->generate();
+	cout << "\t#SWITCH" << endl;
+	load(_expr, eax);
+	dispatch(_cases, clusters, 0, clusters.size(),
+		_default != nullptr ? _default->_label : exit, this);
+	release();
+	
+	breaks.push_back(exit);
+	_stmt->generate();
+	breaks.pop_back();
+	release();
+	cout << exit << ":" << endl;
+}
+
+void Case::generate() {
+	cout << _label << ":" << endl;
+}
+
+void Break::generate() {
+	cout << "\tjmp\t" << breaks.back() << endl;
+}
+
 //Test Functions
 void Expression::test(const Label &label, bool ifTrue) {
 	//compareZero(this);
@@ -961,15 +1436,26 @@ void Expression::test(const Label &label, bool ifTrue) {
 			load(this, fp_getreg());
 		Register *reg = fp_getreg();
 		cout << "\tpxor\t" << reg << ", " << reg << endl;
-		cout << "\tucomsid\t" << reg << ", " << this << endl;
+		cout << "\tucomisd\t" << reg << ", " << this << endl;
 		assign(nullptr, reg);
+
+		if(ifTrue) {
+			cout << "\tjne\t" << label << endl;
+			cout << "\tjp\t" << label << endl;
+		}
+		else {
+			Label skip;
+			cout << "\tjp\t" << skip << endl;
+			cout << "\tje\t" << label << endl;
+			cout << skip << ":" << endl;
+		}
 	}
 	else {
 		if(_register == nullptr) 
 			load(this, getreg());
 		cout << "\tcmpl\t$0, " << this << endl;
+		cout << (ifTrue ? "\tjne\t" : "\tje\t") << label << endl;
 	}
-	cout << (ifTrue ? "\tjne\t" : "\tje\t") << label << endl;
 	
 	assign(this, nullptr);
 }
@@ -979,11 +1465,19 @@ void LessThan::test(const Label &label, bool ifTrue) {
 	_left->generate();
 	_right->generate();
 	
-	if(_left->_register == nullptr)
-		load(_left, getreg());
-		
-	cout << "\tcmpl\t" << _right << ", " << _left << endl;
-	cout << (ifTrue ? "\tjl\t" : "\tjge\t") << label << endl;
+	if(FP(_left)) {
+		if(_right->_register == nullptr)
+			load(_right, fp_getreg());
+		cout << "\tucomisd\t" << _left << ", " << _right << endl;
+		cout << (ifTrue ? "\tja\t" : "\tjbe\t") << label << endl;
+	}
+	
+	else {
+		if(_left->_register == nullptr)
+			load(_left, getreg());
+		cout << "\tcmpl\t" << _right << ", " << _left << endl;
+		cout << (ifTrue ? "\tjl\t" : "\tjge\t") << label << endl;
+	}
 	
 	assign(_left, nullptr);
 	assign(_right, nullptr);
@@ -15,6 +15,8 @@
 # include "Register.h"
 
 void generateGlobals(Scope *scope);
+void generateLiterals();
+std::string literal(const std::string &directive, const std::string &text);
 
 Register *fp_getreg();
 Register *getreg();
@@ -0,0 +1,262 @@
+/*
+ * File:	ifconvert.cpp
+ *
+ * Description:	This file contains the if-conversion pass, which replaces
+ *		short conditional branches with select instructions so that
+ *		the selector can emit conditional moves instead of branches
+ *		that the processor may mispredict.  The pass runs on a flow
+ *		graph in SSA form.
+ *
+ *		A branch is a candidate if it heads a diamond or a triangle
+ *		produced by an if statement:
+ *
+ *		    block:	branch c, then, else
+ *		    then:	...
+ *				jump join
+ *		    else:	...
+ *				jump join
+ *		    join:	x = phi [a, then], [b, else]
+ *
+ *		where either arm may be missing, in which case the block
+ *		jumps straight to the join.  Each arm must have no other
+ *		predecessor, and must be short and consist only of
+ *		instructions that are safe to execute whether or not the
+ *		branch would have been taken.  The arms are hoisted into
+ *		the block, each phi becomes x = select c, a, b, and the
+ *		branch becomes a jump.  Since the join may itself be an arm
+ *		of an enclosing if statement, we repeat until nothing
+ *		changes.
+ *
+ *		Given a profile, a branch that nearly always goes the same
+ *		way, or that never ran, is left alone, since it will be
+ *		predicted well and the select would only add work.
+ */
+
+# include <algorithm>
+# include "optimizer.h"
+# include "profile.h"
+
+using namespace std;
+
+typedef Instruction I;
+
+# define MAX_HOISTED 3
+# define PREDICTABLE 20
+
+
+/*
+ * Function:	speculative (private)
+ *
+ * Description:	Return whether an instruction may be executed even if
+ *		control would never have reached it.  It must have no side
+ *		effects and be unable to trap, so loads through pointers
+ *		and divisions are out.  Variables are always in the frame,
+ *		so reading one is harmless.
+ */
+
+static bool speculative(I *insn)
+{
+    switch (insn->_opcode) {
+    case I::CONST:
+    case I::FCONST:
+    case I::STRING:
+    case I::ADDR:
+    case I::GADDR:
+    case I::LOADVAR:
+    case I::COPY:
+    case I::ADD:
+    case I::SUB:
+    case I::MUL:
+    case I::NEG:
+    case I::NOT:
+    case I::LT:
+    case I::GT:
+    case I::LE:
+    case I::GE:
+    case I::EQ:
+    case I::NE:
+    case I::ITOD:
+    case I::DTOI:
+    case I::TRUNC:
+    case I::SELECT:
+	return true;
+
+    default:
+	return false;
+    }
+}
+
+
+/*
+ * Function:	arm (private)
+ *
+ * Description:	Return whether the target of a branch is an arm that can
+ *		be hoisted into the branching block, given the join.  A
+ *		target that is the join itself is an empty arm.
+ */
+
+static bool arm(BasicBlock *target, BasicBlock *join)
+{
+    if (target == join)
+	return true;
+
+    if (target->_preds.size() != 1 || target->_succs.size() != 1)
+	return false;
+
+    if (target->_succs[0] != join || target->_insns.size() > MAX_HOISTED + 1)
+	return false;
+
+    for (unsigned i = 0; i + 1 < target->_insns.size(); i ++)
+	if (!speculative(target->_insns[i]))
+	    return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	predictable (private)
+ *
+ * Description:	Return whether the profile says that the branch ending the
+ *		given block goes one way at least all but one in twenty
+ *		times, or never ran.
+ */
+
+static bool predictable(FlowGraph *graph, BasicBlock *block)
+{
+    const string &name = graph->_id->name();
+    Count count, taken;
+
+
+    if (!haveProfile() || block->_index < 0)
+	return false;
+
+    count = blockCount(name, block->_index);
+    taken = takenCount(name, block->_index);
+
+    return taken * PREDICTABLE <= count || taken * PREDICTABLE >= count * (PREDICTABLE - 1);
+}
+
+
+/*
+ * Function:	convert (private)
+ *
+ * Description:	Try to if-convert the branch ending the given block, and
+ *		return whether we did.
+ */
+
+static bool convert(FlowGraph *graph, BasicBlock *block)
+{
+    I *term = block->terminator(), *select;
+    BasicBlock *ifTrue, *ifFalse, *join, *from[2];
+    Instructions hoisted, selects, &insns = block->_insns;
+    Instructions::iterator it;
+    int cond;
+
+
+    if (term->_opcode != I::BRANCH || term->_targets[0] == term->_targets[1])
+	return false;
+
+    ifTrue = term->_targets[0];
+    ifFalse = term->_targets[1];
+
+    if (ifTrue == block || ifFalse == block)
+	return false;
+
+    if (ifFalse->_succs.size() == 1 && ifFalse->_succs[0] == ifTrue)
+	join = ifTrue;
+    else if (ifTrue->_succs.size() == 1)
+	join = ifTrue->_succs[0];
+    else
+	return false;
+
+    if (join == block || join->_preds.size() != 2)
+	return false;
+
+    if (!arm(ifTrue, join) || !arm(ifFalse, join))
+	return false;
+
+    if (predictable(graph, block))
+	return false;
+
+
+    /* The phis of the join tell us which value comes from which arm. */
+
+    cond = term->_args[0];
+    from[0] = ifTrue == join ? block : ifTrue;
+    from[1] = ifFalse == join ? block : ifFalse;
+
+    for (it = join->_insns.begin(); it != join->_insns.end() && (*it)->_opcode == I::PHI; it ++) {
+	I *phi = *it;
+
+	select = new I(I::SELECT, phi->_dst);
+	select->_args.assign(3, cond);
+
+	for (unsigned i = 0; i < phi->_sources.size(); i ++)
+	    for (unsigned j = 0; j < 2; j ++)
+		if (phi->_sources[i] == from[j])
+		    select->_args[j + 1] = phi->_args[i];
+
+	selects.push_back(select);
+	delete phi;
+    }
+
+    join->_insns.erase(join->_insns.begin(), it);
+
+
+    /* Hoist the arms above the comparison feeding the branch, if any,
+       so that the selector can still fuse it with a select. */
+
+    for (unsigned i = 0; i < 2; i ++)
+	if (from[i] != block) {
+	    Instructions &moved = from[i]->_insns;
+
+	    hoisted.insert(hoisted.end(), moved.begin(), moved.end() - 1);
+	    delete moved.back();
+	    moved.clear();
+	    graph->_blocks.erase(find(graph->_blocks.begin(), graph->_blocks.end(), from[i]));
+	    delete from[i];
+	}
+
+    it = insns.end() - 1;
+
+    if (it != insns.begin() && (*(it - 1))->_dst == cond && (*(it - 1))->isCompare())
+	it --;
+
+    insns.insert(it, hoisted.begin(), hoisted.end());
+    insns.insert(insns.end() - 1, selects.begin(), selects.end());
+
+    term->_opcode = I::JUMP;
+    term->_args.clear();
+    term->_targets[0] = join;
+    term->_targets[1] = nullptr;
+    return true;
+}
+
+
+/*
+ * Function:	convertBranches
+ *
+ * Description:	If-convert every suitable branch in the flow graph.
+ */
+
+void convertBranches(FlowGraph *graph)
+{
+    unsigned converted = 0;
+    bool changed = true;
+
+
+    while (changed) {
+	changed = false;
+	graph->connect();
+
+	for (unsigned i = 0; i < graph->_blocks.size(); i ++)
+	    if (convert(graph, graph->_blocks[i])) {
+		converted ++;
+		changed = true;
+		break;
+	    }
+    }
+
+    addStatistic("ifconvert", "branches converted", converted);
+}
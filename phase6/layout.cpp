@@ -0,0 +1,266 @@
+/*
+ * File:	layout.cpp
+ *
+ * Description:	This file contains the block layout pass, which runs last
+ *		and decides the order in which the selector emits blocks.
+ *		The pass works on a flow graph that is no longer in SSA
+ *		form, since it duplicates code.
+ *
+ *		A loop as lowered tests its condition at the top and jumps
+ *		back to the test from the bottom, which costs two branches
+ *		per iteration.  We rotate such a loop by copying the test
+ *		to the end of the body, so that the bottom branches back
+ *		to the top of the body directly and the original test only
+ *		guards entry into the loop.  Any register that the test
+ *		defines for its own use gets a new name in the copy, so
+ *		that the selector can still fuse the comparison with its
+ *		branch; the others keep their names, so they are simply
+ *		assigned on both paths.  The top of the body is marked to
+ *		be aligned.
+ *
+ *		Static prediction assumes that forward branches are not
+ *		taken and that backward ones are.  A rotated loop already
+ *		has its back edge taken, and the exit falls through.  A
+ *		block that only returns and is reached by a branch, such as
+ *		the body of an early return, is moved to the end of the
+ *		function so that the branch to it is forward and the path
+ *		that continues falls through.
+ *
+ *		Given a profile, such a block is only moved if it runs less
+ *		often than not, and any block that never ran at all is
+ *		moved to the very end, out of the way of the rest.
+ */
+
+# include <map>
+# include <string>
+# include <sstream>
+# include <iostream>
+# include "optimizer.h"
+# include "options.h"
+# include "profile.h"
+
+using namespace std;
+
+typedef Instruction I;
+
+# define MAX_ROTATED 8
+
+
+/*
+ * Function:	dominates (private)
+ *
+ * Description:	Return whether one block dominates another.
+ */
+
+static bool dominates(BasicBlock *dom, BasicBlock *block)
+{
+    while (block != nullptr && block != dom && block->_idom != block)
+	block = block->_idom;
+
+    return block == dom;
+}
+
+
+/*
+ * Function:	rotate (private)
+ *
+ * Description:	Try to rotate the loop whose test is in the given block,
+ *		and return the block that is now the top of the loop, or a
+ *		null pointer if we could not.  The loop must have a single
+ *		back edge, which ends its latch with a jump to the test.
+ */
+
+static BasicBlock *rotate(FlowGraph *graph, BasicBlock *header, vector<unsigned> &uses)
+{
+    I *term = header->terminator();
+    BasicBlock *latch = nullptr, *top = nullptr;
+    map<int, unsigned> local;
+    map<int, int> renamed;
+
+
+    if (header == graph->entry() || term->_opcode != I::BRANCH)
+	return nullptr;
+
+    if (header->_insns.size() > MAX_ROTATED)
+	return nullptr;
+
+    if (term->_targets[0] == header || term->_targets[1] == header)
+	return nullptr;
+
+    for (unsigned i = 0; i < header->_preds.size(); i ++)
+	if (dominates(header, header->_preds[i])) {
+	    if (latch != nullptr)
+		return nullptr;
+
+	    latch = header->_preds[i];
+	}
+
+    if (latch == nullptr || latch->terminator()->_opcode != I::JUMP)
+	return nullptr;
+
+    for (unsigned i = 0; i < 2; i ++)
+	if (dominates(term->_targets[i], latch))
+	    top = term->_targets[i];
+
+    if (top == nullptr)
+	return nullptr;
+
+
+    /* Copy the test over the jump, renaming what it keeps to itself. */
+
+    for (unsigned i = 0; i < header->_insns.size(); i ++)
+	for (unsigned j = 0; j < header->_insns[i]->_args.size(); j ++)
+	    local[header->_insns[i]->_args[j]] ++;
+
+    delete latch->_insns.back();
+    latch->_insns.pop_back();
+
+    for (unsigned i = 0; i < header->_insns.size(); i ++) {
+	I *insn = header->_insns[i], *copy = new I(*insn);
+
+	for (unsigned j = 0; j < copy->_args.size(); j ++) {
+	    if (renamed.count(copy->_args[j]) > 0)
+		copy->_args[j] = renamed[copy->_args[j]];
+	    else
+		uses[copy->_args[j]] ++;
+	}
+
+	if (insn->_dst >= 0 && uses[insn->_dst] == local[insn->_dst]) {
+	    copy->_dst = graph->newRegister(graph->_reals[insn->_dst]);
+	    renamed[insn->_dst] = copy->_dst;
+	    uses.push_back(0);
+	}
+
+	latch->_insns.push_back(copy);
+    }
+
+    for (auto &it : renamed)
+	uses[it.second] = uses[it.first];
+
+    top->_align = true;
+    return top;
+}
+
+
+/*
+ * Function:	unlikely (private)
+ *
+ * Description:	Return whether a block that only returns is unlikely to
+ *		be reached from the branch before it.
+ */
+
+static bool unlikely(FlowGraph *graph, BasicBlock *block)
+{
+    const string &name = graph->_id->name();
+
+    if (!haveProfile())
+	return true;
+
+    return 2 * blockCount(name, block->_index) < blockCount(name, block->_preds[0]->_index);
+}
+
+
+/*
+ * Function:	cold (private)
+ *
+ * Description:	Return whether the profile says that a block never ran,
+ *		even though its function did.
+ */
+
+static bool cold(FlowGraph *graph, BasicBlock *block)
+{
+    const string &name = graph->_id->name();
+
+    if (!haveProfile() || block->_index < 0 || blockCount(name, 0) == 0)
+	return false;
+
+    return blockCount(name, block->_index) == 0;
+}
+
+
+/*
+ * Function:	layoutBlocks
+ *
+ * Description:	Rotate the loops of the flow graph and order its blocks
+ *		for static prediction, writing the decisions to the
+ *		standard error if requested.
+ */
+
+void layoutBlocks(FlowGraph *graph)
+{
+    vector<unsigned> uses(graph->_reals.size(), 0);
+    BasicBlocks order, returns, colds;
+    vector<string> decisions;
+    stringstream ss;
+    BasicBlock *top;
+    unsigned rotated = 0;
+
+
+    computeDominators(graph);
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	Instructions &insns = graph->_blocks[i]->_insns;
+
+	for (unsigned j = 0; j < insns.size(); j ++)
+	    for (unsigned k = 0; k < insns[j]->_args.size(); k ++)
+		uses[insns[j]->_args[k]] ++;
+    }
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	BasicBlock *header = graph->_blocks[i];
+
+	if ((top = rotate(graph, header, uses)) != nullptr) {
+	    ss.str("");
+	    ss << "rotated loop at " << header << ", aligned " << top;
+	    decisions.push_back(ss.str());
+	    rotated ++;
+	}
+    }
+
+    graph->connect();
+
+
+    /* Move blocks that only return after a branch, and then those that
+       never ran, to the end. */
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	BasicBlock *block = graph->_blocks[i];
+
+	if (i > 0 && cold(graph, block)) {
+	    ss.str("");
+	    ss << "moved cold " << block << " to the end";
+	    decisions.push_back(ss.str());
+	    colds.push_back(block);
+
+	} else if (i > 0 && i + 1 < graph->_blocks.size() &&
+		block->terminator()->_opcode == I::RET &&
+		block->_preds.size() == 1 &&
+		block->_preds[0]->terminator()->_opcode == I::BRANCH &&
+		unlikely(graph, block)) {
+	    ss.str("");
+	    ss << "moved return " << block << " to the end";
+	    decisions.push_back(ss.str());
+	    returns.push_back(block);
+	} else
+	    order.push_back(block);
+    }
+
+    order.insert(order.end(), returns.begin(), returns.end());
+    order.insert(order.end(), colds.begin(), colds.end());
+    graph->_blocks = order;
+
+    addStatistic("layout", "loops rotated", rotated);
+    addStatistic("layout", "returns moved", returns.size());
+
+    if (printLayout) {
+	cerr << graph->_id->name() << ":";
+
+	for (unsigned i = 0; i < order.size(); i ++)
+	    cerr << " " << order[i] << (order[i]->_align ? "*" : "");
+
+	cerr << endl;
+
+	for (unsigned i = 0; i < decisions.size(); i ++)
+	    cerr << "\t" << decisions[i] << endl;
+    }
+}
@@ -6,25 +6,76 @@
  *
  *		Extra functionality:
  *		- checking for improper integer and floating-point literals
+ *		- reading the whole input into a buffer, so that runs of
+ *		  whitespace, identifier characters, digits, and the bodies
+ *		  of strings and comments can be scanned many bytes at a
+ *		  time by the kernels in scanner.cpp
+ *		- leaving each lexeme in the buffer, where its token
+ *		  refers to it, so that a string is made only when needed
+ *		- tokenizing the whole buffer up front on several threads,
+ *		  for the parser to consume as an array
+ *
+ *		To tokenize in parallel, we split the buffer into chunks at
+ *		whitespace outside of any string or comment, found by a
+ *		fast scan that skips from one to the next.  Each thread
+ *		lexes its chunk with its own copy of the lexer state,
+ *		counting lines from zero and deferring any errors, which
+ *		are attached to the token being lexed.  The chunks are
+ *		then stitched together, with their line numbers offset by
+ *		the lines of the chunks before them, and each error is
+ *		reported once the parser reaches its token, exactly as if
+ *		the tokens had been lexed on demand.
  */
 
-# include <map>
+# include <thread>
+# include <vector>
 # include <cstdio>
 # include <cctype>
 # include <cerrno>
 # include <string>
+# include <climits>
+# include <cstring>
 # include <cstdlib>
 # include <iostream>
 # include "lexer.h"
 # include "tokens.h"
+# include "scanner.h"
 
 using namespace std;
-int numerrors, lineno = 1;
+int numerrors;
+thread_local int lineno = 1;
+
+# define CHUNK_MIN 65536
+
+typedef vector<pair<unsigned, const char *>> Errors;
+
+struct Chunk {
+    const char *_first, *_last;
+    vector<Token> _tokens;
+    Errors _errors;
+    unsigned _lines, _index, _base;
+};
+
+static bool started;
+static string input;
+static vector<Token> tokens;
+static Errors errors;
+static unsigned position, reported, current;
+
+static thread_local int c;
+static thread_local const char *cursor, *limit, *mark;
+static thread_local Chunk *chunk;
+
 
+/* Later, we will associate token values with each keyword.  They are
+   kept in order, so that we can search them without making a string. */
 
-/* Later, we will associate token values with each keyword */
+struct Keyword {
+    const char *_name;
+    int _token;
+};
 
-static map<string,int> keywords = {
+static const Keyword keywords[] = {
     {"auto", AUTO},
     {"break", BREAK},
     {"case", CASE},
@@ -81,102 +132,226 @@ void report(const string &str, const string &arg)
 
 
 /*
- * Function:	lexan
+ * Function:	error (private)
+ *
+ * Description:	Report a lexical error, or if tokenizing a chunk, defer it
+ *		until the parser reaches the token being lexed.
+ */
+
+static void error(const char *message)
+{
+    if (chunk != nullptr)
+	chunk->_errors.push_back(make_pair(chunk->_tokens.size(), message));
+    else
+	report(message);
+}
+
+
+/*
+ * Function:	seek (private)
+ *
+ * Description:	Move to the given position in the buffer and return the
+ *		character there, or EOF at the end.
+ */
+
+static int seek(const char *p)
+{
+    cursor = p;
+    return cursor < limit ? (unsigned char) *cursor : EOF;
+}
+
+
+/*
+ * Function:	get (private)
+ *
+ * Description:	Move to the next character in the buffer and return it,
+ *		or EOF at the end.
+ */
+
+static int get()
+{
+    return seek(cursor < limit ? cursor + 1 : limit);
+}
+
+
+/*
+ * Function:	start (private)
+ *
+ * Description:	Read the whole of the standard input stream into the
+ *		buffer and return its first character.
+ */
+
+static int start()
+{
+    char buf[BUFSIZ];
+
+
+    input.clear();
+
+    while (cin.read(buf, sizeof(buf)) || cin.gcount() > 0)
+	input.append(buf, cin.gcount());
+
+    limit = input.data() + input.size();
+    return seek(input.data());
+}
+
+
+/*
+ * Function:	resetLexer
  *
- * Description:	Read and tokenize the standard input stream.  The lexeme is
- *		stored in a buffer.
+ * Description:	Start reading the standard input stream afresh, as is
+ *		needed once its buffer has been replaced.
  */
 
-int lexan(string &lexbuf)
+void resetLexer()
 {
-    long val;
-    static int c = cin.get();
+    started = false;
+    lineno = 1;
+}
+
+
+/*
+ * Function:	keyword (private)
+ *
+ * Description:	Return the token for a keyword, or ID if the given lexeme
+ *		is not one.
+ */
+
+static int keyword(const char *p, unsigned length)
+{
+    unsigned low = 0, high = sizeof(keywords) / sizeof(keywords[0]), mid;
+    int diff;
+
+
+    while (low < high) {
+	mid = (low + high) / 2;
+	diff = strncmp(keywords[mid]._name, p, length);
+
+	if (diff == 0 && keywords[mid]._name[length] != '\0')
+	    diff = 1;
+
+	if (diff == 0)
+	    return keywords[mid]._token;
+
+	if (diff < 0)
+	    low = mid + 1;
+	else
+	    high = mid;
+    }
+
+    return ID;
+}
+
+
+/*
+ * Function:	representable (private)
+ *
+ * Description:	Return whether an integer lexeme fits in an int.  A
+ *		leading zero means octal, and as with strtol, the value
+ *		ends at the first digit that is not valid in its base.
+ */
+
+static bool representable(const char *p, unsigned length)
+{
+    unsigned base = length > 1 && *p == '0' ? 8 : 10;
+    long val = 0;
+
+
+    for (unsigned i = 0; i < length && (unsigned) (p[i] - '0') < base; i ++)
+	if ((val = val * base + p[i] - '0') > INT_MAX)
+	    return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	scan (private)
+ *
+ * Description:	Read and tokenize the standard input stream, returning
+ *		the kind of the next token.  Its lexeme is left between
+ *		mark and cursor.
+ */
+
+static int scan()
+{
+    const char *last;
+
+
+    if (!started) {
+	c = start();
+	started = true;
+    }
 
 
     /* The invariant here is that the next character has already been read
        and is ready to be classified.  In this way, we eliminate having to
        push back characters onto the stream, merely to read them again. */
 
-    while (!cin.eof()) {
-	lexbuf.clear();
+    while (c != EOF) {
 
 
 	/* Ignore white space */
 
-	while (isspace(c)) {
-	    if (c == '\n')
-		lineno ++;
+	if (isspace(c))
+	    c = seek(skipSpace(cursor, limit, lineno));
 
-	    c = cin.get();
-	}
+	mark = cursor;
 
 
 	/* Check for an identifier or a keyword */
 
 	if (isalpha(c) || c == '_') {
-	    do {
-		lexbuf += c;
-		c = cin.get();
-	    } while (isalnum(c) || c == '_');
-
-	    if (keywords.count(lexbuf) > 0)
-		return keywords[lexbuf];
-
-	    return ID;
+	    c = seek(skipWord(cursor + 1, limit));
+	    return keyword(mark, cursor - mark);
 
 
 	/* Check for a number (integer or real). */
 
 	} else if (isdigit(c)) {
-	    do {
-		lexbuf += c;
-		c = cin.get();
-	    } while (isdigit(c));
+	    c = seek(skipDigits(cursor + 1, limit));
 
 	    if (c != '.') {
-		errno = 0;
-		val = strtol(lexbuf.c_str(), NULL, 0);
-
-		if (errno != 0 || val != (int) val)
-		    report("integer constant too large");
+		if (!representable(mark, cursor - mark))
+		    error("integer constant too large");
 
 		return INTEGER;
 	    }
 
-	    lexbuf += c;
-	    c = cin.get();
+	    c = get();
 
 	    if (isdigit(c)) {
-		do {
-		    lexbuf += c;
-		    c = cin.get();
-		} while (isdigit(c));
+		c = seek(skipDigits(cursor + 1, limit));
 
 		if (c == 'e' || c == 'E') {
-		    lexbuf += c;
-		    c = cin.get();
-
-		    if (c == '-' || c == '+') {
-			lexbuf += c;
-			c = cin.get();
-		    }
-
-		    if (isdigit(c)) {
-			do {
-			    lexbuf += c;
-			    c = cin.get();
-			} while (isdigit(c));
-		    } else
-			report("missing exponent of floating-point constant");
+		    c = get();
+
+		    if (c == '-' || c == '+')
+			c = get();
+
+		    if (isdigit(c))
+			c = seek(skipDigits(cursor + 1, limit));
+		    else
+			error("missing exponent of floating-point constant");
 		}
 	    } else
-		report("missing fractional part of floating-point constant");
+		error("missing fractional part of floating-point constant");
+
+
+	    /* The buffer is terminated, so we can convert the lexeme in
+	       place, unless the conversion would go beyond it, as after
+	       a missing fractional part. */
 
 	    errno = 0;
-	    strtod(lexbuf.c_str(), NULL);
+	    strtod(mark, (char **) &last);
+
+	    if (last != cursor) {
+		errno = 0;
+		strtod(string(mark, cursor).c_str(), NULL);
+	    }
 
 	    if (errno != 0)
-		report("floating-point constant out of range");
+		error("floating-point constant out of range");
 
 	    return REAL;
 
@@ -187,19 +362,16 @@ int lexan(string &lexbuf)
 	   might as well do it now. */
 
 	} else {
-	    lexbuf += c;
-
 	    switch(c) {
 
 
 	    /* Check for '||' */
 
 	    case '|':
-		c = cin.get();
+		c = get();
 
 		if (c == '|') {
-		    lexbuf += c;
-		    c = cin.get();
+		    c = get();
 		    return OR;
 		}
 
@@ -209,11 +381,10 @@ int lexan(string &lexbuf)
 	    /* Check for '=' and '==' */
 
 	    case '=':
-		c = cin.get();
+		c = get();
 
 		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
+		    c = get();
 		    return EQL;
 		}
 
@@ -223,11 +394,10 @@ int lexan(string &lexbuf)
 	    /* Check for '&' and '&&' */
 
 	    case '&':
-		c = cin.get();
+		c = get();
 
 		if (c == '&') {
-		    lexbuf += c;
-		    c = cin.get();
+		    c = get();
 		    return AND;
 		}
 
@@ -237,11 +407,10 @@ int lexan(string &lexbuf)
 	    /* Check for '!' and '!=' */
 
 	    case '!':
-		c = cin.get();
+		c = get();
 
 		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
+		    c = get();
 		    return NEQ;
 		}
 
@@ -251,11 +420,10 @@ int lexan(string &lexbuf)
 	    /* Check for '<' and '<=' */
 
 	    case '<':
-		c = cin.get();
+		c = get();
 
 		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
+		    c = get();
 		    return LEQ;
 		}
 
@@ -265,100 +433,102 @@ int lexan(string &lexbuf)
 	    /* Check for '>' and '>=' */
 
 	    case '>':
-		c = cin.get();
+		c = get();
 
 		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
+		    c = get();
 		    return GEQ;
 		}
 
 		return '>';
 
 
-	    /* Check for '-', '--', and '->' */
+	    /* Check for '-', '--', '-=', and '->' */
 
 	    case '-':
-		c = cin.get();
+		c = get();
 
 		if (c == '-') {
-		    lexbuf += c;
-		    c = cin.get();
+		    c = get();
 		    return DEC;
 
+		} else if (c == '=') {
+		    c = get();
+		    return SUBEQ;
+
 		} else if (c == '>') {
-		    lexbuf += c;
-		    c = cin.get();
+		    c = get();
 		    return ARROW;
 		}
 
 		return '-';
 
 
-	    /* Check for '+' and '++' */
+	    /* Check for '+', '++', and '+=' */
 
 	    case '+':
-		c = cin.get();
+		c = get();
 
 		if (c == '+') {
-		    lexbuf += c;
-		    c = cin.get();
+		    c = get();
 		    return INC;
+
+		} else if (c == '=') {
+		    c = get();
+		    return ADDEQ;
 		}
 
 		return '+';
 
 
+	    /* Check for '*' and '*=' */
+
+	    case '*':
+		c = get();
+
+		if (c == '=') {
+		    c = get();
+		    return MULEQ;
+		}
+
+		return '*';
+
+
 	    /* Check for simple, single character tokens */
 
-	    case '*': case '%': case ':': case ';':
+	    case '%': case ':': case ';':
 	    case '(': case ')': case '[': case ']':
 	    case '{': case '}': case '.': case ',':
-		c = cin.get();
-		return lexbuf[0];
+		c = get();
+		return *mark;
 
 
-	    /* Check for '/' or a comment */
+	    /* Check for '/', '/=', or a comment */
 
 	    case '/':
-		c = cin.get();
+		c = get();
 
 		if (c == '*') {
-		    c = cin.get();
-
-		    do {
-			while (c != '*' && !cin.eof()) {
-			    if (c == '\n')
-				lineno ++;
-
-			    c = cin.get();
-			}
-
-			c = cin.get();
-		    } while (c != '/' && !cin.eof());
-
-		    c = cin.get();
+		    c = seek(skipComment(cursor + 1, limit, lineno));
 		    break;
 
-		} else
-		    return '/';
+		} else if (c == '=') {
+		    c = get();
+		    return DIVEQ;
+		}
+
+		return '/';
 
 
 	    /* Check for a string literal */
 
 	    case '"':
-		c = cin.get();
-
-		while (c != '"' && c != '\n' && !cin.eof()) {
-		    lexbuf += c;
-		    c = cin.get();
-		}
+		c = seek(skipString(cursor + 1, limit));
 
-		if (c == '\n' || cin.eof())
-		    report("premature end of string literal");
+		if (c == '\n' || c == EOF)
+		    error("premature end of string literal");
 
-		lexbuf += c;
-		c = cin.get();
+		c = get();
 		return STRING;
 
 
@@ -371,7 +541,7 @@ int lexan(string &lexbuf)
 	    /* Ignore everything else */
 
 	    default:
-		c = cin.get();
+		c = get();
 		break;
 	    }
 	}
@@ -379,3 +549,296 @@ int lexan(string &lexbuf)
 
     return DONE;
 }
+
+
+/*
+ * Function:	lexan
+ *
+ * Description:	Read and tokenize the standard input stream.  The token
+ *		records where its lexeme is in the buffer rather than a
+ *		copy of it, which only those who need one make.
+ */
+
+int lexan(Token &token)
+{
+    token._kind = scan();
+    token._line = lineno;
+
+    if (token._kind == DONE)
+	mark = cursor;
+
+    token._offset = mark - input.data();
+    token._length = cursor - mark;
+    return token._kind;
+}
+
+
+/*
+ * Function:	lexeme
+ *
+ * Description:	Return a copy of the lexeme of a token.
+ */
+
+string lexeme(const Token &token)
+{
+    return string(input.data() + token._offset, token._length);
+}
+
+
+/*
+ * Function:	split (private)
+ *
+ * Description:	Split the buffer into at most the given number of chunks
+ *		of roughly equal size.  Each chunk but the first begins at
+ *		whitespace outside of any string or comment, which is
+ *		found by skipping from one string or comment to the next,
+ *		exactly as the lexer would.
+ */
+
+static void split(vector<Chunk> &chunks, unsigned n)
+{
+    const char *p, *q, *s, *target, *end;
+    size_t size = input.size() / n;
+    int lines = 0;
+
+
+    p = input.data();
+    end = p + input.size();
+    target = p + size;
+    chunks.resize(1);
+    chunks.back()._first = p;
+
+    while (p < end && chunks.size() < n) {
+	q = skipCode(p, end);
+
+	for (s = max(p, target); s < q && chunks.size() < n; s = max(s + 1, target))
+	    if (isspace((unsigned char) *s)) {
+		chunks.back()._last = s;
+		chunks.resize(chunks.size() + 1);
+		chunks.back()._first = s;
+		target = s + size;
+	    }
+
+	if (q == end)
+	    break;
+
+	if (*q == '"') {
+	    q = skipString(q + 1, end);
+	    p = q < end ? q + 1 : end;
+	} else if (q + 1 < end && q[1] == '*')
+	    p = skipComment(q + 2, end, lines);
+	else
+	    p = q + 1;
+    }
+
+    chunks.back()._last = end;
+}
+
+
+/*
+ * Function:	lexChunk (private)
+ *
+ * Description:	Tokenize a chunk of the buffer, counting its lines from
+ *		zero and deferring any errors.
+ */
+
+static void lexChunk(Chunk *ch)
+{
+    Token token;
+
+
+    chunk = ch;
+    limit = ch->_last;
+    lineno = 0;
+    c = seek(ch->_first);
+
+    while (lexan(token) != DONE)
+	ch->_tokens.push_back(token);
+
+    ch->_lines = lineno;
+    chunk = nullptr;
+}
+
+
+/*
+ * Function:	stitch (private)
+ *
+ * Description:	Copy the tokens of a chunk into place in the array,
+ *		offsetting their line numbers.
+ */
+
+static void stitch(Chunk *ch)
+{
+    Token *dest = &tokens[ch->_index];
+
+    for (unsigned i = 0; i < ch->_tokens.size(); i ++) {
+	dest[i] = ch->_tokens[i];
+	dest[i]._line += ch->_base;
+    }
+
+    vector<Token>().swap(ch->_tokens);
+}
+
+
+/*
+ * Function:	tokenize
+ *
+ * Description:	Read the standard input stream and tokenize all of it
+ *		using up to the given number of threads, so that the
+ *		tokens may be consumed with nextToken rather than lexan.
+ *		Chunks smaller than CHUNK_MIN are not worth a thread.
+ */
+
+void tokenize(unsigned threads)
+{
+    vector<Chunk> chunks;
+    vector<thread> workers;
+    unsigned n, index = 0, base = 1;
+
+
+    start();
+    started = true;
+
+    n = max(1u, min<unsigned>(threads, input.size() / CHUNK_MIN));
+    split(chunks, n);
+
+    for (unsigned i = 1; i < chunks.size(); i ++)
+	workers.push_back(thread(lexChunk, &chunks[i]));
+
+    lexChunk(&chunks[0]);
+
+    for (unsigned i = 0; i < workers.size(); i ++)
+	workers[i].join();
+
+    errors.clear();
+
+    for (unsigned i = 0; i < chunks.size(); i ++) {
+	chunks[i]._index = index;
+	chunks[i]._base = base;
+
+	for (unsigned j = 0; j < chunks[i]._errors.size(); j ++) {
+	    errors.push_back(chunks[i]._errors[j]);
+	    errors.back().first += index;
+	}
+
+	index += chunks[i]._tokens.size();
+	base += chunks[i]._lines;
+    }
+
+    tokens.resize(index + 1);
+    workers.clear();
+
+    for (unsigned i = 1; i < chunks.size(); i ++)
+	workers.push_back(thread(stitch, &chunks[i]));
+
+    stitch(&chunks[0]);
+
+    for (unsigned i = 0; i < workers.size(); i ++)
+	workers[i].join();
+
+    Token done = {DONE, base, (unsigned) input.size(), 0};
+    tokens[index] = done;
+    position = reported = 0;
+}
+
+
+/*
+ * Function:	nextToken
+ *
+ * Description:	Get the next token from those tokenized beforehand and
+ *		return its kind, reporting any errors that were found in
+ *		it.  The last token is always DONE.
+ */
+
+int nextToken(Token &token)
+{
+    token = tokens[position];
+    lineno = token._line;
+    current = position;
+
+    while (reported < errors.size() && errors[reported].first == position)
+	report(errors[reported ++].second);
+
+    if (position + 1 < tokens.size())
+	position ++;
+
+    return token._kind;
+}
+
+
+/*
+ * Function:	tokenIndex
+ *
+ * Description:	Return the index of the token last returned by nextToken.
+ */
+
+unsigned tokenIndex()
+{
+    return current;
+}
+
+
+/*
+ * Function:	closingBrace
+ *
+ * Description:	Return the index of the right brace that matches the left
+ *		brace last returned by nextToken, or zero if there is none.
+ */
+
+unsigned closingBrace()
+{
+    unsigned depth = 0;
+
+
+    for (unsigned i = current; i < tokens.size(); i ++)
+	if (tokens[i]._kind == '{')
+	    depth ++;
+	else if (tokens[i]._kind == '}' && -- depth == 0)
+	    return i;
+
+    return 0;
+}
+
+
+/*
+ * Function:	hashTokens
+ *
+ * Description:	Return the 64-bit FNV-1a hash of the kinds and lexemes of
+ *		the tokens from FIRST up to but not including LAST.  The
+ *		lines on which they appear do not matter.
+ */
+
+unsigned long long hashTokens(unsigned first, unsigned last)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    const char *p;
+
+
+    for (unsigned i = first; i < last && i < tokens.size(); i ++) {
+	hash = (hash ^ (unsigned) tokens[i]._kind) * 1099511628211ULL;
+	hash = (hash ^ tokens[i]._length) * 1099511628211ULL;
+	p = input.data() + tokens[i]._offset;
+
+	for (unsigned j = 0; j < tokens[i]._length; j ++)
+	    hash = (hash ^ (unsigned char) p[j]) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+
+/*
+ * Function:	seekToken
+ *
+ * Description:	Skip ahead so that the next call to nextToken returns the
+ *		token at the given index.  Any errors found in the tokens
+ *		skipped are still reported.
+ */
+
+void seekToken(unsigned index)
+{
+    while (reported < errors.size() && errors[reported].first < index)
+	report(errors[reported ++].second);
+
+    position = index;
+}
@@ -9,9 +9,25 @@
 # define LEXER_H
 # include <string>
 
-extern int lineno, numerrors;
+extern int numerrors;
+extern thread_local int lineno;
 
-int lexan(std::string &lexbuf);
+/* A token refers to its lexeme in the buffer of the input */
+
+struct Token {
+    int _kind;
+    unsigned _line, _offset, _length;
+};
+
+int lexan(Token &token);
+std::string lexeme(const Token &token);
+void resetLexer();
+void tokenize(unsigned threads);
+int nextToken(Token &token);
+unsigned tokenIndex();
+unsigned closingBrace();
+unsigned long long hashTokens(unsigned first, unsigned last);
+void seekToken(unsigned index);
 void report(const std::string &str, const std::string &arg = "");
 
 # endif /* LEXER_H */
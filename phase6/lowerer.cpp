@@ -0,0 +1,972 @@
+/*
+ * File:	lowerer.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		lowering the abstract syntax tree of a function into its
+ *		flow graph.  The classes themselves are declared in Tree.h
+ *		and IR.h.
+ *
+ *		Every expression can be lowered for its value, and lvalues
+ *		can also be lowered for their address.  Expressions used
+ *		as tests are lowered directly into branches so that the
+ *		short-circuit operators never need to materialize a value
+ *		unless one is actually required.
+ *
+ *		Since the checker has already made every conversion
+ *		explicit, each instruction operates on operands of a
+ *		single type: either integer (including characters and
+ *		pointers) or real.
+ */
+
+# include <cassert>
+# include <cstdlib>
+# include "IR.h"
+# include "Tree.h"
+# include "machine.h"
+
+using namespace std;
+
+# define FP(expr) ((expr)->type().isReal())
+
+
+/* The blocks to which a break statement jumps, innermost last */
+
+static BasicBlocks breaks;
+
+
+/*
+ * Function:	isLocal (private)
+ *
+ * Description:	Return whether the given symbol is a local variable or
+ *		parameter.  Storage allocation has already assigned
+ *		offsets, and only globals have a zero offset.
+ */
+
+static bool isLocal(const Symbol *symbol)
+{
+    return symbol->_offset != 0;
+}
+
+
+/*
+ * Function:	compare (private)
+ *
+ * Description:	Lower a comparison for its value.
+ */
+
+static int compare(Builder &builder, Instruction::Opcode opcode,
+	Expression *left, Expression *right)
+{
+    int l = left->lowerValue(builder);
+    int r = right->lowerValue(builder);
+
+    return builder.binary(opcode, l, r, FP(left));
+}
+
+
+/*
+ * Function:	compareTest (private)
+ *
+ * Description:	Lower a comparison as a test.  The selector will fuse the
+ *		comparison with the branch that immediately follows it.
+ */
+
+static void compareTest(Builder &builder, Instruction::Opcode opcode,
+	Expression *left, Expression *right, BasicBlock *ifTrue,
+	BasicBlock *ifFalse)
+{
+    builder.branch(compare(builder, opcode, left, right), ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	Expression::lower
+ *
+ * Description:	Lower an expression statement, whose value is discarded.
+ */
+
+void Expression::lower(Builder &builder)
+{
+    lowerValue(builder);
+}
+
+
+/*
+ * Function:	Expression::lowerAddress
+ *
+ * Description:	Lower the address of an expression.  Only lvalues and
+ *		arrays have addresses, and they override this function.
+ */
+
+int Expression::lowerAddress(Builder &builder)
+{
+    assert(0);
+    return -1;
+}
+
+
+/*
+ * Function:	Expression::lowerStore
+ *
+ * Description:	Store a value into the object designated by this lvalue.
+ */
+
+void Expression::lowerStore(Builder &builder, int value)
+{
+    Instruction *insn = new Instruction(Instruction::STORE);
+
+    insn->_args.push_back(lowerAddress(builder));
+    insn->_args.push_back(value);
+    insn->_size = _type.size();
+    builder.emit(insn);
+}
+
+
+/*
+ * Function:	Expression::lowerTest
+ *
+ * Description:	Lower an expression as a test by branching on whether its
+ *		value is nonzero.
+ */
+
+void Expression::lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse)
+{
+    builder.branch(lowerValue(builder), ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	String::lowerValue
+ *
+ * Description:	Lower a string literal.  A string is an array, so its
+ *		value is its address.
+ */
+
+int String::lowerValue(Builder &builder)
+{
+    return lowerAddress(builder);
+}
+
+
+/*
+ * Function:	String::lowerAddress
+ *
+ * Description:	Lower the address of a string literal.
+ */
+
+int String::lowerAddress(Builder &builder)
+{
+    Instruction *insn;
+
+    insn = new Instruction(Instruction::STRING);
+    insn->_dst = builder.graph()->newRegister(false);
+    insn->_text = _value;
+    return builder.emit(insn)->_dst;
+}
+
+
+/*
+ * Function:	Identifier::lowerValue
+ *
+ * Description:	Lower an identifier.  Local scalars are read directly as
+ *		variables, and everything else is read through memory.
+ */
+
+int Identifier::lowerValue(Builder &builder)
+{
+    Instruction *insn;
+    int addr;
+
+
+    if (_type.isArray())
+	return lowerAddress(builder);
+
+    if (isLocal(_symbol)) {
+	insn = new Instruction(Instruction::LOADVAR);
+	insn->_var = builder.variable(_symbol);
+
+    } else {
+	addr = lowerAddress(builder);
+	insn = new Instruction(Instruction::LOAD);
+	insn->_args.push_back(addr);
+	insn->_size = _type.size();
+    }
+
+    insn->_dst = builder.graph()->newRegister(FP(this));
+    return builder.emit(insn)->_dst;
+}
+
+
+/*
+ * Function:	Identifier::lowerAddress
+ *
+ * Description:	Lower the address of an identifier.  Taking the address
+ *		of a local variable means it can never be promoted.
+ */
+
+int Identifier::lowerAddress(Builder &builder)
+{
+    Instruction *insn;
+
+
+    if (isLocal(_symbol)) {
+	insn = new Instruction(Instruction::ADDR);
+	insn->_var = builder.variable(_symbol);
+	builder.graph()->_vars[insn->_var]._addressed = true;
+
+    } else {
+	insn = new Instruction(Instruction::GADDR);
+	insn->_symbol = _symbol;
+    }
+
+    insn->_dst = builder.graph()->newRegister(false);
+    return builder.emit(insn)->_dst;
+}
+
+
+/*
+ * Function:	Identifier::lowerStore
+ *
+ * Description:	Store a value into an identifier.
+ */
+
+void Identifier::lowerStore(Builder &builder, int value)
+{
+    Instruction *insn;
+
+
+    if (isLocal(_symbol)) {
+	insn = new Instruction(Instruction::STOREVAR);
+	insn->_var = builder.variable(_symbol);
+	insn->_args.push_back(value);
+	builder.emit(insn);
+
+    } else
+	Expression::lowerStore(builder, value);
+}
+
+
+/*
+ * Function:	Integer::lowerValue
+ *
+ * Description:	Lower an integer literal.
+ */
+
+int Integer::lowerValue(Builder &builder)
+{
+    return builder.constant(strtol(_value.c_str(), NULL, 0));
+}
+
+
+/*
+ * Function:	Real::lowerValue
+ *
+ * Description:	Lower a real literal.  We keep its text so that the value
+ *		is written exactly as it appeared in the source.
+ */
+
+int Real::lowerValue(Builder &builder)
+{
+    Instruction *insn;
+
+    insn = new Instruction(Instruction::FCONST);
+    insn->_dst = builder.graph()->newRegister(true);
+    insn->_text = _value;
+    return builder.emit(insn)->_dst;
+}
+
+
+/*
+ * Function:	Call::lowerValue
+ *
+ * Description:	Lower a function call.  The arguments are evaluated from
+ *		left to right; the selector takes care of pushing them in
+ *		the proper order.
+ */
+
+int Call::lowerValue(Builder &builder)
+{
+    Instruction *insn;
+    vector<int> args;
+
+
+    for (unsigned i = 0; i < _args.size(); i ++)
+	args.push_back(_args[i]->lowerValue(builder));
+
+    insn = new Instruction(Instruction::CALL);
+    insn->_dst = builder.graph()->newRegister(FP(this));
+    insn->_symbol = _id;
+    insn->_args = args;
+    return builder.emit(insn)->_dst;
+}
+
+
+/*
+ * Function:	Not::lowerValue
+ *
+ * Description:	Lower a logical negation for its value.
+ */
+
+int Not::lowerValue(Builder &builder)
+{
+    return builder.unary(Instruction::NOT, _expr->lowerValue(builder), false);
+}
+
+
+/*
+ * Function:	Not::lowerTest
+ *
+ * Description:	Lower a logical negation as a test by swapping targets.
+ */
+
+void Not::lowerTest(Builder &builder, BasicBlock *ifTrue, BasicBlock *ifFalse)
+{
+    _expr->lowerTest(builder, ifFalse, ifTrue);
+}
+
+
+/*
+ * Function:	Negate::lowerValue
+ *
+ * Description:	Lower an arithmetic negation.
+ */
+
+int Negate::lowerValue(Builder &builder)
+{
+    return builder.unary(Instruction::NEG, _expr->lowerValue(builder), FP(this));
+}
+
+
+/*
+ * Function:	Dereference::lowerValue
+ *
+ * Description:	Lower a dereference by loading through its address.
+ */
+
+int Dereference::lowerValue(Builder &builder)
+{
+    Instruction *insn;
+    int addr;
+
+
+    addr = _expr->lowerValue(builder);
+
+    if (_type.isArray())
+	return addr;
+
+    insn = new Instruction(Instruction::LOAD);
+    insn->_dst = builder.graph()->newRegister(FP(this));
+    insn->_args.push_back(addr);
+    insn->_size = _type.size();
+    return builder.emit(insn)->_dst;
+}
+
+
+/*
+ * Function:	Dereference::lowerAddress
+ *
+ * Description:	The address of a dereference is simply its operand.
+ */
+
+int Dereference::lowerAddress(Builder &builder)
+{
+    return _expr->lowerValue(builder);
+}
+
+
+/*
+ * Function:	Address::lowerValue
+ *
+ * Description:	Lower an address expression.
+ */
+
+int Address::lowerValue(Builder &builder)
+{
+    return _expr->lowerAddress(builder);
+}
+
+
+/*
+ * Function:	Cast::lowerValue
+ *
+ * Description:	Lower a type cast.  Characters are always kept
+ *		sign-extended in integer registers, so widening a
+ *		character is free, but narrowing to a character must
+ *		truncate.
+ */
+
+int Cast::lowerValue(Builder &builder)
+{
+    int value = _expr->lowerValue(builder);
+    unsigned src = _expr->type().size();
+    unsigned dest = _type.size();
+
+
+    if (FP(_expr) && !FP(this))
+	value = builder.unary(Instruction::DTOI, value, false);
+
+    else if (!FP(_expr) && FP(this))
+	return builder.unary(Instruction::ITOD, value, true);
+
+    if (dest == SIZEOF_CHAR && src != SIZEOF_CHAR)
+	value = builder.unary(Instruction::TRUNC, value, false);
+
+    return value;
+}
+
+
+/*
+ * Function:	Multiply::lowerValue
+ */
+
+int Multiply::lowerValue(Builder &builder)
+{
+    int l = _left->lowerValue(builder);
+    int r = _right->lowerValue(builder);
+
+    return builder.binary(Instruction::MUL, l, r, FP(this));
+}
+
+
+/*
+ * Function:	Divide::lowerValue
+ */
+
+int Divide::lowerValue(Builder &builder)
+{
+    int l = _left->lowerValue(builder);
+    int r = _right->lowerValue(builder);
+
+    return builder.binary(Instruction::DIV, l, r, FP(this));
+}
+
+
+/*
+ * Function:	Remainder::lowerValue
+ */
+
+int Remainder::lowerValue(Builder &builder)
+{
+    int l = _left->lowerValue(builder);
+    int r = _right->lowerValue(builder);
+
+    return builder.binary(Instruction::REM, l, r, FP(this));
+}
+
+
+/*
+ * Function:	Add::lowerValue
+ */
+
+int Add::lowerValue(Builder &builder)
+{
+    int l = _left->lowerValue(builder);
+    int r = _right->lowerValue(builder);
+
+    return builder.binary(Instruction::ADD, l, r, FP(this));
+}
+
+
+/*
+ * Function:	Subtract::lowerValue
+ */
+
+int Subtract::lowerValue(Builder &builder)
+{
+    int l = _left->lowerValue(builder);
+    int r = _right->lowerValue(builder);
+
+    return builder.binary(Instruction::SUB, l, r, FP(this));
+}
+
+
+/*
+ * From this point on are the comparison operators, each of which can be
+ * lowered either for its value or as a test.
+ */
+
+int LessThan::lowerValue(Builder &builder)
+{
+    return compare(builder, Instruction::LT, _left, _right);
+}
+
+void LessThan::lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse)
+{
+    compareTest(builder, Instruction::LT, _left, _right, ifTrue, ifFalse);
+}
+
+int GreaterThan::lowerValue(Builder &builder)
+{
+    return compare(builder, Instruction::GT, _left, _right);
+}
+
+void GreaterThan::lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse)
+{
+    compareTest(builder, Instruction::GT, _left, _right, ifTrue, ifFalse);
+}
+
+int LessOrEqual::lowerValue(Builder &builder)
+{
+    return compare(builder, Instruction::LE, _left, _right);
+}
+
+void LessOrEqual::lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse)
+{
+    compareTest(builder, Instruction::LE, _left, _right, ifTrue, ifFalse);
+}
+
+int GreaterOrEqual::lowerValue(Builder &builder)
+{
+    return compare(builder, Instruction::GE, _left, _right);
+}
+
+void GreaterOrEqual::lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse)
+{
+    compareTest(builder, Instruction::GE, _left, _right, ifTrue, ifFalse);
+}
+
+int Equal::lowerValue(Builder &builder)
+{
+    return compare(builder, Instruction::EQ, _left, _right);
+}
+
+void Equal::lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse)
+{
+    compareTest(builder, Instruction::EQ, _left, _right, ifTrue, ifFalse);
+}
+
+int NotEqual::lowerValue(Builder &builder)
+{
+    return compare(builder, Instruction::NE, _left, _right);
+}
+
+void NotEqual::lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse)
+{
+    compareTest(builder, Instruction::NE, _left, _right, ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	LogicalAnd::lowerTest
+ *
+ * Description:	Lower a logical-and expression as a test.  The right
+ *		operand is only tested if the left operand is true.
+ */
+
+void LogicalAnd::lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse)
+{
+    BasicBlock *right = builder.create();
+
+    _left->lowerTest(builder, right, ifFalse);
+    builder.enter(right);
+    _right->lowerTest(builder, ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	LogicalOr::lowerTest
+ *
+ * Description:	Lower a logical-or expression as a test.  The right
+ *		operand is only tested if the left operand is false.
+ */
+
+void LogicalOr::lowerTest(Builder &builder, BasicBlock *ifTrue,
+	BasicBlock *ifFalse)
+{
+    BasicBlock *right = builder.create();
+
+    _left->lowerTest(builder, ifTrue, right);
+    builder.enter(right);
+    _right->lowerTest(builder, ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	logical (private)
+ *
+ * Description:	Lower a short-circuit operator for its value.  The result
+ *		is written to a scratch variable along each path.
+ */
+
+static int logical(Builder &builder, Expression *expr)
+{
+    BasicBlock *ifTrue, *ifFalse, *join;
+    Instruction *insn;
+    int var;
+
+
+    var = builder.scratch(false);
+    ifTrue = builder.create();
+    ifFalse = builder.create();
+    join = builder.create();
+
+    expr->lowerTest(builder, ifTrue, ifFalse);
+
+    builder.enter(ifTrue);
+    insn = new Instruction(Instruction::STOREVAR);
+    insn->_var = var;
+    insn->_args.push_back(builder.constant(1));
+    builder.emit(insn);
+    builder.jump(join);
+
+    builder.enter(ifFalse);
+    insn = new Instruction(Instruction::STOREVAR);
+    insn->_var = var;
+    insn->_args.push_back(builder.constant(0));
+    builder.emit(insn);
+
+    builder.enter(join);
+    insn = new Instruction(Instruction::LOADVAR);
+    insn->_dst = builder.graph()->newRegister(false);
+    insn->_var = var;
+    return builder.emit(insn)->_dst;
+}
+
+int LogicalAnd::lowerValue(Builder &builder)
+{
+    return logical(builder, this);
+}
+
+int LogicalOr::lowerValue(Builder &builder)
+{
+    return logical(builder, this);
+}
+
+
+/*
+ * Function:	Placeholder::lowerValue
+ *
+ * Description:	Lower the old value of an updated lvalue, which the update
+ *		has already loaded.
+ */
+
+int Placeholder::lowerValue(Builder &builder)
+{
+    assert(_value >= 0);
+    return _value;
+}
+
+
+/*
+ * Function:	Update::lowerValue
+ *
+ * Description:	Lower an update of an lvalue.  A dereference is lowered
+ *		for its address only once, so that any side effects within
+ *		it happen only once, and the old value is loaded from and
+ *		the new value stored to that address.
+ */
+
+int Update::lowerValue(Builder &builder)
+{
+    Expression *pointer = _left->isDeref();
+    Instruction *insn;
+    int addr, value;
+
+
+    if (pointer == nullptr) {
+	_old->_value = _left->lowerValue(builder);
+	value = _expr->lowerValue(builder);
+	_left->lowerStore(builder, value);
+
+    } else {
+	addr = pointer->lowerValue(builder);
+	insn = new Instruction(Instruction::LOAD);
+	insn->_dst = builder.graph()->newRegister(FP(this));
+	insn->_args.push_back(addr);
+	insn->_size = _type.size();
+	_old->_value = builder.emit(insn)->_dst;
+	value = _expr->lowerValue(builder);
+
+	insn = new Instruction(Instruction::STORE);
+	insn->_args.push_back(addr);
+	insn->_args.push_back(value);
+	insn->_size = _type.size();
+	builder.emit(insn);
+    }
+
+    return _postfix ? _old->_value : value;
+}
+
+
+/*
+ * Function:	Assignment::lower
+ *
+ * Description:	Lower an assignment statement.  As in the generator, the
+ *		right-hand side is evaluated first.
+ */
+
+void Assignment::lower(Builder &builder)
+{
+    _left->lowerStore(builder, _right->lowerValue(builder));
+}
+
+
+/*
+ * Function:	Return::lower
+ *
+ * Description:	Lower a return statement.  Any code that follows it is
+ *		placed in a new, unreachable block that is later pruned.
+ */
+
+void Return::lower(Builder &builder)
+{
+    Instruction *insn = new Instruction(Instruction::RET);
+
+    insn->_args.push_back(_expr->lowerValue(builder));
+    builder.emit(insn);
+    builder.enter(builder.create());
+}
+
+
+/*
+ * Function:	Block::lower
+ *
+ * Description:	Lower each statement in this block.
+ */
+
+void Block::lower(Builder &builder)
+{
+    for (unsigned i = 0; i < _stmts.size(); i ++)
+	_stmts[i]->lower(builder);
+}
+
+
+/*
+ * Function:	While::lower
+ *
+ * Description:	Lower a while statement into a test block, a body, and an
+ *		exit block.
+ */
+
+void While::lower(Builder &builder)
+{
+    BasicBlock *test, *body, *exit;
+
+
+    test = builder.create();
+    body = builder.create();
+    exit = builder.create();
+
+    builder.enter(test);
+    _expr->lowerTest(builder, body, exit);
+
+    builder.enter(body);
+    breaks.push_back(exit);
+    _stmt->lower(builder);
+    breaks.pop_back();
+    builder.jump(test);
+
+    builder.enter(exit);
+}
+
+
+/*
+ * Function:	If::lower
+ *
+ * Description:	Lower an if-then or if-then-else statement.
+ */
+
+void If::lower(Builder &builder)
+{
+    BasicBlock *thenBlock, *elseBlock, *join;
+
+
+    thenBlock = builder.create();
+    elseBlock = _elseStmt != nullptr ? builder.create() : nullptr;
+    join = builder.create();
+
+    _expr->lowerTest(builder, thenBlock, elseBlock ? elseBlock : join);
+
+    builder.enter(thenBlock);
+    _thenStmt->lower(builder);
+
+    if (elseBlock != nullptr) {
+	builder.jump(join);
+	builder.enter(elseBlock);
+	_elseStmt->lower(builder);
+    }
+
+    builder.enter(join);
+}
+
+
+/*
+ * Function:	dispatch (private)
+ *
+ * Description:	Lower the search for the case whose value is in the
+ *		given register, among those in the given range of
+ *		clusters, jumping to the default block if there is none.
+ *		A few single cases are compared in turn, a lone cluster of
+ *		many cases becomes a switch instruction, and anything else
+ *		is split in half by a binary search.
+ */
+
+static void dispatch(Builder &builder, Switch *stmt, int value,
+	const Clusters &clusters, unsigned first, unsigned last,
+	BasicBlock *deflt)
+{
+    const Cases &cases = stmt->cases();
+    BasicBlock *next, *lower, *upper;
+    Instruction *insn;
+    unsigned mid;
+    long low;
+    int cond;
+
+
+    if (stmt->linear(clusters, first, last)) {
+	for (unsigned i = first; i < last; i ++) {
+	    Case *label = cases[clusters[i].first];
+
+	    next = builder.create();
+	    cond = builder.constant(label->value());
+	    cond = builder.binary(Instruction::EQ, value, cond, false);
+	    builder.branch(cond, label->_block, next);
+	    builder.enter(next);
+	}
+
+	builder.jump(deflt);
+	return;
+    }
+
+    if (last - first == 1) {
+	insn = new Instruction(Instruction::SWITCH);
+	insn->_args.push_back(value);
+	insn->_value = low = cases[clusters[first].first]->value();
+	insn->_targets[0] = deflt;
+
+	for (unsigned i = clusters[first].first; i < clusters[first].second; i ++) {
+	    insn->_table.resize(cases[i]->value() - low, deflt);
+	    insn->_table.push_back(cases[i]->_block);
+	}
+
+	builder.emit(insn);
+	return;
+    }
+
+    mid = (first + last) / 2;
+    lower = builder.create();
+    upper = builder.create();
+    cond = builder.constant(cases[clusters[mid].first]->value());
+    cond = builder.binary(Instruction::LT, value, cond, false);
+    builder.branch(cond, lower, upper);
+
+    builder.enter(lower);
+    dispatch(builder, stmt, value, clusters, first, mid, deflt);
+    builder.enter(upper);
+    dispatch(builder, stmt, value, clusters, mid, last, deflt);
+}
+
+
+/*
+ * Function:	Switch::lower
+ *
+ * Description:	Lower a switch statement.  Each case gets a block of its
+ *		own, the search for the right one ends the current block,
+ *		and the body is then lowered, with each label entering its
+ *		block so that control falls through from one case to the
+ *		next.  Any statements before the first label are
+ *		unreachable and so will be pruned.
+ */
+
+void Switch::lower(Builder &builder)
+{
+    Clusters clusters = this->clusters();
+    BasicBlock *exit, *deflt;
+    int value;
+
+
+    value = _expr->lowerValue(builder);
+    exit = builder.create();
+
+    for (unsigned i = 0; i < _cases.size(); i ++)
+	_cases[i]->_block = builder.create();
+
+    if (_default != nullptr)
+	deflt = _default->_block = builder.create();
+    else
+	deflt = exit;
+
+    dispatch(builder, this, value, clusters, 0, clusters.size(), deflt);
+    builder.enter(builder.create());
+
+    breaks.push_back(exit);
+    _stmt->lower(builder);
+    breaks.pop_back();
+    builder.enter(exit);
+}
+
+
+/*
+ * Function:	Case::lower
+ *
+ * Description:	Lower a case or default label by entering its block.
+ */
+
+void Case::lower(Builder &builder)
+{
+    builder.enter(_block);
+}
+
+
+/*
+ * Function:	Break::lower
+ *
+ * Description:	Lower a break statement into a jump out of the innermost
+ *		loop or switch statement.
+ */
+
+void Break::lower(Builder &builder)
+{
+    builder.jump(breaks.back());
+    builder.enter(builder.create());
+}
+
+
+/*
+ * Function:	Function::lower
+ *
+ * Description:	Lower this function into a new flow graph.  Storage is
+ *		allocated first so that we can distinguish locals from
+ *		globals and so that parameters have their offsets.  All
+ *		parameters are entered as variables up front, in order.
+ *		The blocks that remain are then numbered in order.
+ */
+
+FlowGraph *Function::lower()
+{
+    FlowGraph *graph;
+    Symbols symbols;
+    int offset;
+
+
+    offset = PARAM_OFFSET;
+    allocate(offset);
+
+    graph = new FlowGraph(_id);
+    Builder builder(graph);
+
+    symbols = _body->declarations()->symbols();
+
+    for (unsigned i = 0; i < _id->type().parameters()->size(); i ++)
+	builder.variable(symbols[i]);
+
+    _body->lower(builder);
+
+    if (builder.block()->terminator() == nullptr)
+	builder.emit(new Instruction(Instruction::RET));
+
+    graph->prune();
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++)
+	graph->_blocks[i]->_index = i;
+
+    return graph;
+}
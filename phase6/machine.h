@@ -11,18 +11,25 @@
 # define SIZEOF_PTR 4
 # define SIZEOF_REG 4
 # define PARAM_OFFSET 8
+# define SIZEOF_COUNT 8
 
 # if defined (__linux__) && (defined(__i386__) || defined(__x86_64__))
 
 # define STACK_ALIGNMENT 4
 # define global_prefix ""
 # define label_prefix ".L"
+# define hot_text_section "\t.section\t.text.hot,\"ax\",@progbits"
+# define cold_text_section "\t.section\t.text.unlikely,\"ax\",@progbits"
+# define exit_section "\t.section\t.fini_array,\"aw\""
 
 # elif defined (__APPLE__) && (defined(__i386__) || defined(__x86_64__))
 
 # define STACK_ALIGNMENT 16
 # define global_prefix "_"
 # define label_prefix "L"
+# define hot_text_section "\t.text"
+# define cold_text_section "\t.text"
+# define exit_section "\t.mod_term_func"
 
 # else
 
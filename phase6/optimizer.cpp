@@ -0,0 +1,310 @@
+/*
+ * File:	optimizer.cpp
+ *
+ * Description:	This file contains the pass manager for the optimization
+ *		passes that operate on flow graphs, along with the
+ *		statistics they report and the simplest of the passes
+ *		themselves.
+ *
+ *		The passes are run in the order of the table below, each
+ *		by default only at or above its level.  At -O1, a function
+ *		is simply lowered, its blocks are laid out, and it is
+ *		passed to the selector.  At -O2, before the layout,
+ *		constants are propagated, dead code is removed, simple
+ *		loops are vectorized, and short branches are if-converted.
+ *		A pass may be turned on or off regardless of the level with
+ *		-fpass=name and -fno-pass=name.  The passes that need SSA
+ *		form are run together, with the graph converted into SSA
+ *		form before the first of them and back out after the last.
+ *
+ *		When instrumenting, we leave out the passes that only
+ *		reshape control flow, so that the counts of the blocks
+ *		keep their meaning.
+ */
+
+# include <map>
+# include <chrono>
+# include <vector>
+# include <iomanip>
+# include <iostream>
+# include "optimizer.h"
+# include "options.h"
+
+using namespace std;
+using namespace std::chrono;
+
+typedef Instruction I;
+
+struct Pass {
+    const char *_name;
+    int _level;
+    bool _ssa, _reshapes;
+    void (*_run)(FlowGraph *graph);
+};
+
+struct PassTimes {
+    unsigned _runs;
+    double _seconds;
+    long _blocks, _insns;
+};
+
+static const Pass passes[] = {
+    {"sccp", 2, true, false, propagateConstants},
+    {"dce", 2, true, false, eliminateDeadCode},
+    {"vectorize", 2, true, false, vectorizeLoops},
+    {"ifconvert", 2, true, true, convertBranches},
+    {"layout", 1, false, true, layoutBlocks},
+};
+
+static map<pair<string, string>, unsigned> statistics;
+static map<string, PassTimes> reports;
+static vector<string> order;
+
+
+/*
+ * Function:	addStatistic
+ *
+ * Description:	Add to the named statistic for the given pass.
+ */
+
+void addStatistic(const string &pass, const string &what, unsigned n)
+{
+    statistics[make_pair(pass, what)] += n;
+}
+
+
+/*
+ * Function:	writeStatistics
+ *
+ * Description:	Write all statistics collected so far to a stream.
+ */
+
+void writeStatistics(ostream &ostr)
+{
+    map<pair<string, string>, unsigned>::iterator it;
+
+    for (it = statistics.begin(); it != statistics.end(); it ++) {
+	ostr << setw(8) << it->second << " " << it->first.first << " - ";
+	ostr << it->first.second << endl;
+    }
+}
+
+
+/*
+ * Function:	eliminateDeadCode
+ *
+ * Description:	Delete every instruction whose result is never used and
+ *		that has no side effects.  Deleting an instruction may
+ *		make its operands dead in turn, so we iterate until
+ *		nothing changes.
+ */
+
+void eliminateDeadCode(FlowGraph *graph)
+{
+    vector<unsigned> uses(graph->_reals.size(), 0);
+    unsigned deleted = 0;
+    bool changed = true;
+
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	Instructions &insns = graph->_blocks[i]->_insns;
+
+	for (unsigned j = 0; j < insns.size(); j ++)
+	    for (unsigned k = 0; k < insns[j]->_args.size(); k ++)
+		uses[insns[j]->_args[k]] ++;
+    }
+
+    while (changed) {
+	changed = false;
+
+	for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	    Instructions &insns = graph->_blocks[i]->_insns;
+	    Instructions kept;
+
+	    for (unsigned j = 0; j < insns.size(); j ++) {
+		I *insn = insns[j];
+
+		if (insn->_dst >= 0 && uses[insn->_dst] == 0 &&
+			!insn->hasSideEffects()) {
+		    for (unsigned k = 0; k < insn->_args.size(); k ++)
+			uses[insn->_args[k]] --;
+
+		    delete insn;
+		    deleted ++;
+		    changed = true;
+
+		} else
+		    kept.push_back(insn);
+	    }
+
+	    insns = kept;
+	}
+    }
+
+    addStatistic("dce", "instructions deleted", deleted);
+}
+
+
+/*
+ * Function:	knownPass
+ *
+ * Description:	Return whether there is a pass with the given name.
+ */
+
+bool knownPass(const string &name)
+{
+    for (unsigned i = 0; i < sizeof(passes) / sizeof(passes[0]); i ++)
+	if (name == passes[i]._name)
+	    return true;
+
+    return false;
+}
+
+
+/*
+ * Function:	passNames
+ *
+ * Description:	Return the names of all passes, separated by spaces.
+ */
+
+string passNames()
+{
+    string result;
+
+    for (unsigned i = 0; i < sizeof(passes) / sizeof(passes[0]); i ++)
+	result += (i > 0 ? " " : "") + string(passes[i]._name);
+
+    return result;
+}
+
+
+/*
+ * Function:	enabled (private)
+ *
+ * Description:	Return whether a pass is to be run, which depends on the
+ *		level unless it has been turned on or off explicitly.
+ */
+
+static bool enabled(const Pass &pass)
+{
+    map<string, bool>::const_iterator it = passOverrides.find(pass._name);
+
+
+    if (pass._reshapes && !profileGenerate.empty())
+	return false;
+
+    if (it != passOverrides.end())
+	return it->second;
+
+    return optimize >= pass._level;
+}
+
+
+/*
+ * Function:	pipeline
+ *
+ * Description:	Return the names of the passes that will be run, in order,
+ *		separated by commas.
+ */
+
+string pipeline()
+{
+    string result;
+
+    for (unsigned i = 0; i < sizeof(passes) / sizeof(passes[0]); i ++)
+	if (enabled(passes[i]))
+	    result += (result.empty() ? "" : ",") + string(passes[i]._name);
+
+    return result;
+}
+
+
+/*
+ * Function:	run (private)
+ *
+ * Description:	Run a pass over a flow graph.  If a report was requested,
+ *		also record how long it took and how many blocks and
+ *		instructions it added or removed.
+ */
+
+static void run(const string &name, void (*pass)(FlowGraph *), FlowGraph *graph)
+{
+    steady_clock::time_point start;
+    long blocks, insns;
+
+
+    if (!passReport) {
+	pass(graph);
+	return;
+    }
+
+    blocks = graph->_blocks.size();
+    insns = graph->size();
+    start = steady_clock::now();
+
+    pass(graph);
+
+    if (reports.count(name) == 0)
+	order.push_back(name);
+
+    PassTimes &times = reports[name];
+
+    times._runs ++;
+    times._seconds += duration<double>(steady_clock::now() - start).count();
+    times._blocks += (long) graph->_blocks.size() - blocks;
+    times._insns += (long) graph->size() - insns;
+}
+
+
+/*
+ * Function:	optimizeGraph
+ *
+ * Description:	Run the enabled passes over a flow graph in order,
+ *		converting it into SSA form for those that need it.
+ */
+
+void optimizeGraph(FlowGraph *graph)
+{
+    bool ssa = false;
+
+
+    for (unsigned i = 0; i < sizeof(passes) / sizeof(passes[0]); i ++) {
+	if (!enabled(passes[i]))
+	    continue;
+
+	if (passes[i]._ssa && !ssa)
+	    run("ssa", buildSSA, graph);
+	else if (!passes[i]._ssa && ssa)
+	    run("out-of-ssa", destroySSA, graph);
+
+	ssa = passes[i]._ssa;
+	run(passes[i]._name, passes[i]._run, graph);
+    }
+
+    if (ssa)
+	run("out-of-ssa", destroySSA, graph);
+}
+
+
+/*
+ * Function:	writePassReport
+ *
+ * Description:	Write, for each pass that was run, how many times it was
+ *		run, the time spent in it, and the net number of blocks
+ *		and instructions it added, to a stream.
+ */
+
+void writePassReport(ostream &ostr)
+{
+    ostr << fixed << setprecision(3);
+    ostr << "pass          runs   seconds    blocks  instructions" << endl;
+
+    for (unsigned i = 0; i < order.size(); i ++) {
+	PassTimes &times = reports[order[i]];
+
+	ostr << left << setw(10) << order[i] << right;
+	ostr << setw(8) << times._runs << setw(10) << times._seconds;
+	ostr << showpos << setw(10) << times._blocks << setw(14) << times._insns;
+	ostr << noshowpos << endl;
+    }
+}
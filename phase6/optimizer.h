@@ -0,0 +1,32 @@
+/*
+ * File:	optimizer.h
+ *
+ * Description:	This file contains the function declarations for the
+ *		optimization passes that operate on the flow graph of a
+ *		function, between lowering and instruction selection.
+ */
+
+# ifndef OPTIMIZER_H
+# define OPTIMIZER_H
+# include <string>
+# include "IR.h"
+
+void optimizeGraph(FlowGraph *graph);
+bool knownPass(const std::string &name);
+std::string passNames();
+std::string pipeline();
+void writePassReport(std::ostream &ostr);
+void addStatistic(const std::string &pass, const std::string &what, unsigned n);
+void writeStatistics(std::ostream &ostr);
+
+void computeDominators(FlowGraph *graph);
+void buildSSA(FlowGraph *graph);
+void destroySSA(FlowGraph *graph);
+
+void propagateConstants(FlowGraph *graph);
+void eliminateDeadCode(FlowGraph *graph);
+void vectorizeLoops(FlowGraph *graph);
+void convertBranches(FlowGraph *graph);
+void layoutBlocks(FlowGraph *graph);
+
+# endif /* OPTIMIZER_H */
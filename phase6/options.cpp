@@ -0,0 +1,223 @@
+/*
+ * File:	options.cpp
+ *
+ * Description:	This file contains the public variable and function
+ *		definitions for the command-line options of the compiler.
+ *		The compiler always reads its source from the standard
+ *		input and writes its output to the standard output unless
+ *		told otherwise, so the only options are those that affect
+ *		compilation itself.
+ *
+ *		-O0		generate code directly from the tree (default)
+ *		-O1		lower each function to the IR and select
+ *				instructions from it
+ *		-O2		also convert to SSA form and propagate
+ *				constants before selection
+ *		-emit-ir	write the IR instead of assembly
+ *		-emit-tree	write the abstract syntax tree of each
+ *				function instead of assembly
+ *		-c		write an ELF relocatable object instead of
+ *				assembly; ignored with -emit-ir and
+ *				-emit-tree
+ *		-o file		write the output to the file rather than
+ *				the standard output
+ *		-fomit-frame-pointer
+ *				address the frame relative to %esp and
+ *				do not set up %ebp
+ *		-fpass=name	run the named pass at -O1 and above, even if
+ *				the level would leave it out
+ *		-fno-pass=name	do not run the named pass
+ *		-fno-if-conversion
+ *				keep short branches at -O2 rather than
+ *				replacing them with conditional moves; the
+ *				same as -fno-pass=ifconvert
+ *		-stats		write optimization statistics and frame
+ *				sizes to the standard error
+ *		-print-layout	write the block order chosen for each
+ *				function at -O1 and above, and why, to
+ *				the standard error
+ *		-time-report	write the time and peak memory of each
+ *				phase, and the lines and tokens compiled
+ *				per second, to the standard error
+ *		-pass-report	write the time spent in each pass, and the
+ *				blocks and instructions it added or removed,
+ *				to the standard error
+ *		-fprofile-generate[=file]
+ *				at -O1 and above, count how often each
+ *				block runs and append the counts to the
+ *				file (scc.profile by default) at exit
+ *		-fprofile-use[=file]
+ *				at -O1 and above, optimize using the
+ *				counts in the file
+ *		-fpretokenize[=threads]
+ *				tokenize the whole input before parsing,
+ *				using the given number of threads (one
+ *				per processor by default)
+ *		-fcache[=dir]	reuse the code generated for functions
+ *				that have not changed, keeping it in the
+ *				directory (.scc-cache by default); this
+ *				implies -fpretokenize=1 at least, and is
+ *				ignored with -emit-ir, -emit-tree,
+ *				-print-layout, and profiles
+ *		-fcache-size=kilobytes
+ *				remove the entries least recently used
+ *				once the cache grows beyond this size
+ *				(65536 by default)
+ *		-emit-pch=file	also write the global declarations to the
+ *				file once the input has been compiled
+ *		-include-pch=file
+ *				start with the global declarations written
+ *				to the file by -emit-pch
+ *		--server[=socket]
+ *				compile requests from the standard input,
+ *				or from connections to the Unix domain
+ *				socket, until there are no more, with the
+ *				other options as defaults for each
+ */
+
+# include <string>
+# include <thread>
+# include <algorithm>
+# include <cstdlib>
+# include <iostream>
+# include "optimizer.h"
+# include "options.h"
+
+using namespace std;
+
+# define DEFAULT_PROFILE "scc.profile"
+# define DEFAULT_CACHE ".scc-cache"
+
+int optimize = 0;
+bool emitIR = false;
+bool emitTree = false;
+bool emitObject = false;
+string outputFile;
+bool printStats = false;
+bool omitFramePointer = false;
+map<string, bool> passOverrides;
+bool printLayout = false;
+bool timeReport = false;
+bool passReport = false;
+string profileGenerate;
+string profileUse;
+unsigned pretokenize = 0;
+string cacheDirectory;
+unsigned long cacheSize = 65536;
+string emitPCH;
+string includePCH;
+bool server = false;
+string serverSocket;
+
+
+/*
+ * Function:	usage (private)
+ *
+ * Description:	Report an invalid option and exit.
+ */
+
+static void usage(const string &arg)
+{
+    cerr << "scc: unrecognized option '" << arg << "'" << endl;
+    cerr << "usage: scc [-O0|-O1|-O2] [-emit-ir] [-emit-tree] [-c] [-o file] [-stats]";
+    cerr << " [-fomit-frame-pointer] [-fpass=name] [-fno-pass=name]";
+    cerr << " [-fno-if-conversion] [-print-layout] [-time-report] [-pass-report]";
+    cerr << " [-fprofile-generate[=file]] [-fprofile-use[=file]]";
+    cerr << " [-fpretokenize[=threads]]";
+    cerr << " [-fcache[=dir]] [-fcache-size=kilobytes]";
+    cerr << " [-emit-pch=file] [-include-pch=file] [--server[=socket]]";
+    cerr << " < file.c > file.s";
+    cerr << endl;
+
+    if (arg.compare(0, 7, "-fpass=") == 0 || arg.compare(0, 10, "-fno-pass=") == 0)
+	cerr << "passes: " << passNames() << endl;
+
+    exit(EXIT_FAILURE);
+}
+
+
+/*
+ * Function:	parseOptions
+ *
+ * Description:	Parse the command-line options.
+ */
+
+void parseOptions(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i ++) {
+	string arg = argv[i];
+
+	if (arg == "-O0" || arg == "-O1" || arg == "-O2")
+	    optimize = arg[2] - '0';
+	else if (arg == "-O")
+	    optimize = 1;
+	else if (arg == "-emit-ir")
+	    emitIR = true;
+	else if (arg == "-emit-tree")
+	    emitTree = true;
+	else if (arg == "-c")
+	    emitObject = true;
+	else if (arg == "-o" && i + 1 < argc)
+	    outputFile = argv[++ i];
+	else if (arg == "-stats")
+	    printStats = true;
+	else if (arg == "-print-layout")
+	    printLayout = true;
+	else if (arg == "-time-report")
+	    timeReport = true;
+	else if (arg == "-fomit-frame-pointer")
+	    omitFramePointer = true;
+	else if (arg == "-pass-report")
+	    passReport = true;
+	else if (arg.compare(0, 7, "-fpass=") == 0 && knownPass(arg.substr(7)))
+	    passOverrides[arg.substr(7)] = true;
+	else if (arg.compare(0, 10, "-fno-pass=") == 0 && knownPass(arg.substr(10)))
+	    passOverrides[arg.substr(10)] = false;
+	else if (arg == "-fno-if-conversion")
+	    passOverrides["ifconvert"] = false;
+	else if (arg == "-fprofile-generate")
+	    profileGenerate = DEFAULT_PROFILE;
+	else if (arg.compare(0, 19, "-fprofile-generate=") == 0)
+	    profileGenerate = arg.substr(19);
+	else if (arg == "-fprofile-use")
+	    profileUse = DEFAULT_PROFILE;
+	else if (arg.compare(0, 14, "-fprofile-use=") == 0)
+	    profileUse = arg.substr(14);
+	else if (arg == "-fpretokenize")
+	    pretokenize = max(1u, thread::hardware_concurrency());
+	else if (arg.compare(0, 14, "-fpretokenize=") == 0) {
+	    pretokenize = strtoul(arg.c_str() + 14, NULL, 10);
+
+	    if (pretokenize == 0)
+		usage(arg);
+	}
+	else if (arg == "-fcache")
+	    cacheDirectory = DEFAULT_CACHE;
+	else if (arg.compare(0, 8, "-fcache=") == 0 && arg.size() > 8)
+	    cacheDirectory = arg.substr(8);
+	else if (arg.compare(0, 13, "-fcache-size=") == 0) {
+	    cacheSize = strtoul(arg.c_str() + 13, NULL, 10);
+
+	    if (cacheSize == 0)
+		usage(arg);
+	}
+	else if (arg.compare(0, 10, "-emit-pch=") == 0 && arg.size() > 10)
+	    emitPCH = arg.substr(10);
+	else if (arg.compare(0, 13, "-include-pch=") == 0 && arg.size() > 13)
+	    includePCH = arg.substr(13);
+	else if (arg == "--server")
+	    server = true;
+	else if (arg.compare(0, 9, "--server=") == 0 && arg.size() > 9) {
+	    server = true;
+	    serverSocket = arg.substr(9);
+	}
+	else
+	    usage(arg);
+    }
+
+    if (emitIR || emitTree || printLayout || !profileGenerate.empty() || !profileUse.empty())
+	cacheDirectory.clear();
+
+    if (!cacheDirectory.empty() && pretokenize == 0)
+	pretokenize = 1;
+}
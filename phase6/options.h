@@ -0,0 +1,36 @@
+/*
+ * File:	options.h
+ *
+ * Description:	This file contains the public variable and function
+ *		declarations for the command-line options of the compiler.
+ */
+
+# ifndef OPTIONS_H
+# define OPTIONS_H
+# include <map>
+# include <string>
+
+extern int optimize;
+extern bool emitIR;
+extern bool emitTree;
+extern bool emitObject;
+extern std::string outputFile;
+extern bool printStats;
+extern bool omitFramePointer;
+extern std::map<std::string, bool> passOverrides;
+extern bool printLayout;
+extern bool timeReport;
+extern bool passReport;
+extern std::string profileGenerate;
+extern std::string profileUse;
+extern unsigned pretokenize;
+extern std::string cacheDirectory;
+extern unsigned long cacheSize;
+extern std::string emitPCH;
+extern std::string includePCH;
+extern bool server;
+extern std::string serverSocket;
+
+void parseOptions(int argc, char *argv[]);
+
+# endif /* OPTIONS_H */
@@ -7,16 +7,27 @@
  */
 
 # include <cstdlib>
+# include <fstream>
+# include <sstream>
 # include <iostream>
 # include "generator.h"
+# include "selector.h"
+# include "optimizer.h"
 # include "checker.h"
+# include "options.h"
+# include "profile.h"
 # include "tokens.h"
 # include "lexer.h"
+# include "timing.h"
+# include "cache.h"
+# include "server.h"
+# include "assembler.h"
 
 using namespace std;
 
 static int lookahead;
-static string lexbuf;
+static Token token;
+static unsigned numtokens;
 
 static Type returnType;
 static Expression *expression();
@@ -34,12 +45,25 @@ static void error()
     if (lookahead == DONE)
 	report("syntax error at end of file");
     else
-	report("syntax error at '%s'", lexbuf);
+	report("syntax error at '%s'", lexeme(token));
 
     exit(EXIT_FAILURE);
 }
 
 
+/*
+ * Function:	next
+ *
+ * Description:	Return the next token, either from those tokenized before
+ *		parsing or straight from the lexer.
+ */
+
+static int next()
+{
+    return pretokenize > 0 ? nextToken(token) : lexan(token);
+}
+
+
 /*
  * Function:	match
  *
@@ -53,7 +77,8 @@ static void match(int t)
     if (lookahead != t)
 	error();
 
-    lookahead = lexan(lexbuf);
+    if ((lookahead = next()) != DONE)
+	numtokens ++;
 }
 
 
@@ -68,7 +93,7 @@ static unsigned integer()
     string buf;
 
 
-    buf = lexbuf;
+    buf = lexeme(token);
     match(INTEGER);
     return strtoul(buf.c_str(), NULL, 0);
 }
@@ -85,7 +110,7 @@ static string identifier()
     string buf;
 
 
-    buf = lexbuf;
+    buf = lexeme(token);
     match(ID);
     return buf;
 }
@@ -262,15 +287,15 @@ static Expression *primaryExpression(bool lparenMatched)
 	match(')');
 
     } else if (lookahead == STRING) {
-	expr = new String(lexbuf);
+	expr = new String(lexeme(token));
 	match(STRING);
 
     } else if (lookahead == INTEGER) {
-	expr = new Integer(lexbuf);
+	expr = new Integer(lexeme(token));
 	match(INTEGER);
 
     } else if (lookahead == REAL) {
-	expr = new Real(lexbuf);
+	expr = new Real(lexeme(token));
 	match(REAL);
 
     } else if (lookahead == ID) {
@@ -313,6 +338,8 @@ static Expression *primaryExpression(bool lparenMatched)
  *		postfix-expression:
  *		  primary-expression
  *		  postfix-expression [ expression ]
+ *		  postfix-expression ++
+ *		  postfix-expression --
  */
 
 static Expression *postfixExpression(bool lparenMatched)
@@ -322,11 +349,23 @@ static Expression *postfixExpression(bool lparenMatched)
 
     left = primaryExpression(lparenMatched);
 
-    while (lookahead == '[') {
-	match('[');
-	right = expression();
-	left = checkArray(left, right);
-	match(']');
+    while (1) {
+	if (lookahead == '[') {
+	    match('[');
+	    right = expression();
+	    left = checkArray(left, right);
+	    match(']');
+
+	} else if (lookahead == INC) {
+	    match(INC);
+	    left = checkIncrement(left, true);
+
+	} else if (lookahead == DEC) {
+	    match(DEC);
+	    left = checkDecrement(left, true);
+
+	} else
+	    break;
     }
 
     return left;
@@ -344,6 +383,8 @@ static Expression *postfixExpression(bool lparenMatched)
  *		  - prefix-expression
  *		  * prefix-expression
  *		  & prefix-expression
+ *		  ++ prefix-expression
+ *		  -- prefix-expression
  *		  sizeof ( specifier pointers )
  *		  ( specifier pointers ) prefix-expression
  */
@@ -375,6 +416,16 @@ static Expression *prefixExpression()
 	expr = prefixExpression();
 	expr = checkAddress(expr);
 
+    } else if (lookahead == INC) {
+	match(INC);
+	expr = prefixExpression();
+	expr = checkIncrement(expr, false);
+
+    } else if (lookahead == DEC) {
+	match(DEC);
+	expr = prefixExpression();
+	expr = checkDecrement(expr, false);
+
     } else if (lookahead == SIZEOF) {
 	match(SIZEOF);
 	match('(');
@@ -665,7 +716,16 @@ static Statements statements()
  *		  while ( expression ) statement
  *		  if ( expression ) statement
  *		  if ( expression ) statement else statement
+ *		  switch ( expression ) statement
+ *		  case INTEGER :
+ *		  case - INTEGER :
+ *		  default :
+ *		  break ;
  *		  expression = expression ;
+ *		  expression += expression ;
+ *		  expression -= expression ;
+ *		  expression *= expression ;
+ *		  expression /= expression ;
  *		  expression ;
  */
 
@@ -675,6 +735,8 @@ static Statement *statement()
     Expression *expr;
     Statement *stmt;
     Statements stmts;
+    long value;
+    int op;
 
 
     if (lookahead == '{') {
@@ -701,7 +763,9 @@ static Statement *statement()
 	expr = expression();
 	checkTest(expr);
 	match(')');
+	openLoop();
 	stmt = statement();
+	closeLoop();
 	return new While(expr, stmt);
     }
 
@@ -720,13 +784,56 @@ static Statement *statement()
 	return new If(expr, stmt, statement());
     }
 
+    if (lookahead == SWITCH) {
+	match(SWITCH);
+	match('(');
+	expr = expression();
+	openSwitch(expr);
+	match(')');
+	stmt = statement();
+	return closeSwitch(expr, stmt);
+    }
+
+    if (lookahead == CASE) {
+	match(CASE);
+
+	if (lookahead == '-') {
+	    match('-');
+	    value = - (long) integer();
+	} else
+	    value = integer();
+
+	match(':');
+	return checkCase(value);
+    }
+
+    if (lookahead == DEFAULT) {
+	match(DEFAULT);
+	match(':');
+	return checkDefault();
+    }
+
+    if (lookahead == BREAK) {
+	match(BREAK);
+	match(';');
+	return checkBreak();
+    }
+
     expr = expression();
 
     if (lookahead == '=') {
 	match('=');
 	stmt = checkAssignment(expr, expression());
-    } else
+
+    } else if (lookahead >= ADDEQ && lookahead <= DIVEQ) {
+	op = lookahead;
+	match(op);
+	stmt = checkCompoundAssignment(expr, op, expression());
+
+    } else {
+	expr->discard();
 	stmt = expr;
+    }
 
     match(';');
     return stmt;
@@ -858,6 +965,52 @@ static void remainingDeclarators(int typespec)
 }
 
 
+/*
+ * Function:	discard
+ *
+ * Description:	Delete a scope that is no longer needed and the symbols
+ *		declared in it, such as the parameters of a prototype.
+ */
+
+static void discard(Scope *scope)
+{
+    const Symbols &symbols = scope->symbols();
+
+    for (unsigned i = 0; i < symbols.size(); i ++)
+	delete symbols[i];
+
+    delete scope;
+}
+
+
+/*
+ * Function:	cached
+ *
+ * Description:	Look up the code for the definition of a function, whose
+ *		first token is at the given index, in the cache.  If it is
+ *		found, the code has been written and we skip its body.
+ */
+
+static bool cached(Symbol *symbol, unsigned first)
+{
+    unsigned last;
+
+
+    if (cacheDirectory.empty() || numerrors > 0 || (last = closingBrace()) == 0)
+	return false;
+
+    if (!findFunction(symbol, hashTokens(first, last + 1)))
+	return false;
+
+    numtokens += last - tokenIndex();
+    seekToken(last);
+    lookahead = next();
+    discard(closeScope());
+    match('}');
+    return true;
+}
+
+
 /*
  * Function:	globalOrFunction
  *
@@ -873,11 +1026,12 @@ static void remainingDeclarators(int typespec)
 static void globalOrFunction()
 {
     int typespec;
-    unsigned indirection;
+    unsigned indirection, first;
     Parameters *params;
     string name;
 
 
+    first = pretokenize > 0 ? tokenIndex() : 0;
     typespec = specifier();
     indirection = pointers();
     name = identifier();
@@ -901,6 +1055,10 @@ static void globalOrFunction()
 
 	    returnType = Type(typespec, indirection);
 	    symbol = defineFunction(name, Type(typespec, indirection, params));
+
+	    if (cached(symbol, first))
+		return;
+
 	    match('{');
 	    declarations();
 	    stmts = statements();
@@ -910,12 +1068,47 @@ static void globalOrFunction()
 	    function = new Function(symbol, new Block(decls, stmts));
 
 	    if (numerrors == 0) {
-		//function->write(cerr);
-		function->generate();
+		stringstream code;
+		streambuf *output = cout.rdbuf();
+
+		if (!cacheDirectory.empty())
+		    cout.rdbuf(code.rdbuf());
+
+		if (emitTree) {
+		    enterPhase("write");
+		    function->write(cout);
+		    cout << endl;
+		} else if (optimize > 0 || emitIR) {
+		    enterPhase("lower");
+		    FlowGraph *graph = function->lower();
+		    enterPhase("optimize");
+		    optimizeGraph(graph);
+		    enterPhase("select");
+
+		    if (emitIR)
+			graph->write(cout);
+		    else
+			selectInstructions(graph);
+
+		    delete graph;
+		} else {
+		    enterPhase("generate");
+		    function->generate();
 		}
 
+		if (!cacheDirectory.empty()) {
+		    cout.rdbuf(output);
+		    storeFunction(code.str());
+		    cout << code.str();
+		}
+
+		enterPhase("parse");
+		}
+
+	    Node::reclaim();
+
 	} else {
-	    closeScope();
+	    discard(closeScope());
 	    declareFunction(name, Type(typespec, indirection, params));
 	    remainingDeclarators(typespec);
 	}
@@ -927,22 +1120,110 @@ static void globalOrFunction()
 }
 
 
+/*
+ * Function:	writeOutput (private)
+ *
+ * Description:	Write the text that the compiler has produced, or the
+ *		object assembled from it, to the output file or to the
+ *		standard output.  Nothing is assembled once there have
+ *		been errors, since the text may be incomplete.
+ */
+
+static void writeOutput(const string &text)
+{
+    string output = text;
+    ofstream ofs;
+
+
+    if (emitObject && !emitIR && !emitTree) {
+	if (numerrors > 0)
+	    return;
+
+	enterPhase("assemble");
+	output = assemble(text);
+    }
+
+    if (outputFile.empty()) {
+	cout.write(output.data(), output.size());
+	return;
+    }
+
+    ofs.open(outputFile.c_str(), ios::binary);
+    ofs.write(output.data(), output.size());
+    ofs.close();
+
+    if (ofs.fail()) {
+	cerr << "scc: cannot write '" << outputFile << "'" << endl;
+	exit(EXIT_FAILURE);
+    }
+}
+
+
 /*
  * Function:	main
  *
  * Description:	Analyze the standard input stream.
  */
 
-int main()
+int main(int argc, char *argv[])
 {
+    stringstream text;
+    streambuf *output = cout.rdbuf();
+
+    parseOptions(argc, argv);
     openScope();
-    lookahead = lexan(lexbuf);
+
+    if (!includePCH.empty())
+	loadDeclarations(includePCH);
+
+    if (server)
+	serve(serverSocket);
+
+    if (emitObject || !outputFile.empty())
+	cout.rdbuf(text.rdbuf());
+
+    enterPhase("parse");
+
+    if (!profileUse.empty())
+	readProfile(profileUse);
+
+    if (pretokenize > 0) {
+	enterPhase("lex");
+	tokenize(pretokenize);
+	enterPhase("parse");
+    }
+
+    if ((lookahead = next()) != DONE)
+	numtokens ++;
 
     while (lookahead != DONE)
 	globalOrFunction();
 
-    if (numerrors == 0)
+    if (numerrors == 0 && !emitPCH.empty())
+	saveDeclarations(emitPCH);
+
+    if (numerrors == 0 && !emitIR && !emitTree) {
+	enterPhase("globals");
 	generateGlobals(closeScope());
+	generateProfiler();
+	generateLiterals();
+    }
+
+    if (emitObject || !outputFile.empty()) {
+	cout.rdbuf(output);
+	writeOutput(text.str());
+    }
+
+    closeCache();
+
+    if (printStats)
+	writeStatistics(cerr);
+
+    if (passReport)
+	writePassReport(cerr);
+
+    if (timeReport)
+	writeTimings(cerr, lineno, numtokens);
 
     exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,356 @@
+/*
+ * File:	precompiled.cpp
+ *
+ * Description:	This file contains the function definitions for writing
+ *		and reading files of precompiled global declarations, so
+ *		that long lists of prototypes and shared globals need not
+ *		be lexed and checked again for every translation unit.
+ *
+ *		A file is a header giving the number of each kind of
+ *		record, followed by arrays of the types, the parameter
+ *		lists, the symbols, and the names of functions that have
+ *		been defined, and finally the characters of all names.
+ *		Types are interned, and a type refers to the types of its
+ *		parameters by index, which are always written before it.
+ *		Every record is a multiple of four bytes, so the file may
+ *		be mapped into memory and used in place, and reading it
+ *		is a single pass over each array with no parsing at all.
+ *
+ *		The file is only meant for the compiler that wrote it, on
+ *		the same machine, so the records are in native byte order
+ *		and the tokens for the specifiers are stored as they are.
+ */
+
+# include <map>
+# include <vector>
+# include <cstring>
+# include <cstdint>
+# include <fstream>
+# include <unordered_set>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include "precompiled.h"
+# include "tokens.h"
+
+using namespace std;
+
+# define MAGIC "SCCDECL1"
+# define UNSPECIFIED 0xffffffff
+
+struct Header {
+    char _magic[8];
+    uint32_t _types, _parameters, _symbols, _defined, _strings;
+};
+
+struct TypeRecord {
+    enum { ARRAY, ERROR, FUNCTION, SCALAR };
+    int32_t _specifier;
+    uint32_t _indirection, _length, _kind, _first, _count;
+};
+
+struct Name {
+    uint32_t _offset, _length;
+};
+
+struct SymbolRecord {
+    Name _name;
+    uint32_t _type;
+};
+
+struct Tables {
+    vector<TypeRecord> _types;
+    vector<uint32_t> _parameters;
+    map<string, uint32_t> _interned;
+    string _strings;
+};
+
+
+/*
+ * Function:	intern (private)
+ *
+ * Description:	Return the index of a type in the tables, adding it and
+ *		the types of its parameters if they are not already there.
+ */
+
+static uint32_t intern(Tables &tables, const Type &type)
+{
+    TypeRecord record = {0, 0, 0, TypeRecord::ERROR, 0, 0};
+    vector<uint32_t> params;
+    string key;
+
+
+    if (!type.isError()) {
+	record._specifier = type.specifier();
+	record._indirection = type.indirection();
+	record._kind = type.isArray() ? TypeRecord::ARRAY :
+	    type.isFunction() ? TypeRecord::FUNCTION : TypeRecord::SCALAR;
+
+	if (type.isArray())
+	    record._length = type.length();
+    }
+
+    if (type.isFunction()) {
+	if (type.parameters() == nullptr)
+	    record._count = UNSPECIFIED;
+	else
+	    for (unsigned i = 0; i < type.parameters()->size(); i ++)
+		params.push_back(intern(tables, (*type.parameters())[i]));
+    }
+
+    key.assign((const char *) &record, sizeof(record));
+    key.append((const char *) params.data(), params.size() * sizeof(uint32_t));
+
+    if (tables._interned.count(key) == 0) {
+	if (record._count != UNSPECIFIED) {
+	    record._first = tables._parameters.size();
+	    record._count = params.size();
+	    tables._parameters.insert(tables._parameters.end(), params.begin(), params.end());
+	}
+
+	tables._interned[key] = tables._types.size();
+	tables._types.push_back(record);
+    }
+
+    return tables._interned[key];
+}
+
+
+/*
+ * Function:	name (private)
+ *
+ * Description:	Add a name to the characters of the tables.
+ */
+
+static Name name(Tables &tables, const string &s)
+{
+    Name result = {(uint32_t) tables._strings.size(), (uint32_t) s.size()};
+
+    tables._strings += s;
+    return result;
+}
+
+
+/*
+ * Function:	writePrecompiled
+ *
+ * Description:	Write the symbols of a scope, and the names of the
+ *		functions that have been defined, to the given file.
+ *		Return whether it was written.
+ */
+
+bool writePrecompiled(const string &filename, const Scope *scope, const set<string> &defined)
+{
+    vector<SymbolRecord> symbols;
+    const Symbols &list = scope->symbols();
+    vector<Name> names;
+    Header header;
+    Tables tables;
+    ofstream ofs;
+
+
+    for (unsigned i = 0; i < list.size(); i ++) {
+	SymbolRecord record;
+
+	record._type = intern(tables, list[i]->type());
+	record._name = name(tables, list[i]->name());
+	symbols.push_back(record);
+    }
+
+    for (auto &function : defined)
+	names.push_back(name(tables, function));
+
+    while (tables._strings.size() % 4 != 0)
+	tables._strings += '\0';
+
+    memcpy(header._magic, MAGIC, sizeof(header._magic));
+    header._types = tables._types.size();
+    header._parameters = tables._parameters.size();
+    header._symbols = symbols.size();
+    header._defined = names.size();
+    header._strings = tables._strings.size();
+
+    ofs.open(filename.c_str(), ios::binary);
+    ofs.write((const char *) &header, sizeof(header));
+    ofs.write((const char *) tables._types.data(), tables._types.size() * sizeof(TypeRecord));
+    ofs.write((const char *) tables._parameters.data(), tables._parameters.size() * sizeof(uint32_t));
+    ofs.write((const char *) symbols.data(), symbols.size() * sizeof(SymbolRecord));
+    ofs.write((const char *) names.data(), names.size() * sizeof(Name));
+    ofs.write(tables._strings.data(), tables._strings.size());
+    ofs.close();
+
+    return !ofs.fail();
+}
+
+
+/*
+ * Function:	build (private)
+ *
+ * Description:	Return the type with the given index.  Each function type
+ *		gets its own parameter list, since the checker deletes the
+ *		list of a function when it is declared again.
+ */
+
+static Type build(const TypeRecord *types, const uint32_t *params, uint32_t index)
+{
+    const TypeRecord &record = types[index];
+    Parameters *parameters;
+
+
+    if (record._kind == TypeRecord::SCALAR)
+	return Type(record._specifier, record._indirection);
+
+    if (record._kind == TypeRecord::ARRAY)
+	return Type(record._specifier, record._indirection, record._length);
+
+    if (record._count == UNSPECIFIED)
+	parameters = nullptr;
+    else {
+	parameters = new Parameters();
+
+	for (uint32_t i = 0; i < record._count; i ++)
+	    parameters->push_back(build(types, params, params[record._first + i]));
+    }
+
+    return Type(record._specifier, record._indirection, parameters);
+}
+
+
+/*
+ * Function:	isSpecifier (private)
+ *
+ * Description:	Return whether the given token is a type specifier.
+ */
+
+static bool isSpecifier(int token)
+{
+    return token == CHAR || token == INT || token == DOUBLE;
+}
+
+
+/*
+ * Function:	valid (private)
+ *
+ * Description:	Return whether the arrays of a mapped file, whose sizes
+ *		have already been checked, are consistent, so that we
+ *		never look outside of them, and describe only types that
+ *		could have been declared.  A file is only written when
+ *		there are no errors, so it never has an erroneous type.
+ */
+
+static bool valid(const Header *header, const TypeRecord *types, const uint32_t *params,
+	const SymbolRecord *symbols, const Name *names, const char *strings)
+{
+    unordered_set<string> seen;
+
+
+    for (uint32_t i = 0; i < header->_types; i ++) {
+	if (types[i]._kind > TypeRecord::SCALAR || types[i]._kind == TypeRecord::ERROR)
+	    return false;
+
+	if (!isSpecifier(types[i]._specifier))
+	    return false;
+
+	if (types[i]._kind == TypeRecord::FUNCTION && types[i]._count != UNSPECIFIED) {
+	    if (types[i]._first > header->_parameters)
+		return false;
+
+	    if (types[i]._count > header->_parameters - types[i]._first)
+		return false;
+
+	    for (uint32_t j = 0; j < types[i]._count; j ++)
+		if (params[types[i]._first + j] >= i)
+		    return false;
+	}
+    }
+
+    for (uint32_t i = 0; i < header->_symbols + header->_defined; i ++) {
+	const Name &name = i < header->_symbols ? symbols[i]._name : names[i - header->_symbols];
+
+	if (name._offset > header->_strings || name._length > header->_strings - name._offset)
+	    return false;
+
+	if (i < header->_symbols) {
+	    if (symbols[i]._type >= header->_types)
+		return false;
+
+	    if (!seen.insert(string(strings + name._offset, name._length)).second)
+		return false;
+	}
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	readPrecompiled
+ *
+ * Description:	Map the given file into memory and insert its symbols into
+ *		a scope, replacing any of the same names, and the names of
+ *		its defined functions into a set.  Return whether the file
+ *		could be read and was valid.
+ */
+
+bool readPrecompiled(const string &filename, Scope *scope, set<string> &defined)
+{
+    const Header *header;
+    const TypeRecord *types;
+    const uint32_t *params;
+    const SymbolRecord *symbols;
+    const Name *names;
+    const char *strings, *base;
+    uint64_t size;
+    struct stat st;
+    bool result;
+    int fd;
+
+
+    if ((fd = open(filename.c_str(), O_RDONLY)) < 0)
+	return false;
+
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(Header)) {
+	close(fd);
+	return false;
+    }
+
+    base = (const char *) mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED)
+	return false;
+
+    header = (const Header *) base;
+    size = sizeof(Header) + (uint64_t) header->_types * sizeof(TypeRecord);
+    size += (uint64_t) header->_parameters * sizeof(uint32_t);
+    size += (uint64_t) header->_symbols * sizeof(SymbolRecord);
+    size += (uint64_t) header->_defined * sizeof(Name) + header->_strings;
+
+    result = memcmp(header->_magic, MAGIC, sizeof(header->_magic)) == 0;
+    result = result && size == (uint64_t) st.st_size;
+
+    if (result) {
+	types = (const TypeRecord *) (header + 1);
+	params = (const uint32_t *) (types + header->_types);
+	symbols = (const SymbolRecord *) (params + header->_parameters);
+	names = (const Name *) (symbols + header->_symbols);
+	strings = (const char *) (names + header->_defined);
+	result = valid(header, types, params, symbols, names, strings);
+    }
+
+    for (uint32_t i = 0; result && i < header->_symbols; i ++) {
+	string name(strings + symbols[i]._name._offset, symbols[i]._name._length);
+
+	if (scope->find(name) != nullptr)
+	    scope->remove(name);
+
+	scope->insert(new Symbol(name, build(types, params, symbols[i]._type)));
+    }
+
+    for (uint32_t i = 0; result && i < header->_defined; i ++)
+	defined.insert(string(strings + names[i]._offset, names[i]._length));
+
+    munmap((void *) base, st.st_size);
+    return result;
+}
@@ -0,0 +1,17 @@
+/*
+ * File:	precompiled.h
+ *
+ * Description:	This file contains the function declarations for writing
+ *		and reading files of precompiled global declarations.
+ */
+
+# ifndef PRECOMPILED_H
+# define PRECOMPILED_H
+# include <set>
+# include <string>
+# include "Scope.h"
+
+bool writePrecompiled(const std::string &filename, const Scope *scope, const std::set<std::string> &defined);
+bool readPrecompiled(const std::string &filename, Scope *scope, std::set<std::string> &defined);
+
+# endif /* PRECOMPILED_H */
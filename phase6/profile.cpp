@@ -0,0 +1,296 @@
+/*
+ * File:	profile.cpp
+ *
+ * Description:	This file contains the function definitions for
+ *		profile-guided optimization.
+ *
+ *		An instrumented function has two 64-bit counters for each
+ *		block numbered during lowering: the number of times the
+ *		block was entered, and, if it ends in a branch, the number
+ *		of times the branch went to its first target.  The numbers
+ *		depend only on the function itself, so a profile survives
+ *		edits to other functions.  The selector increments the
+ *		counters, and we write a small runtime that appends them to
+ *		the profile when the program exits.  Each line of the
+ *		profile gives a function, a block number, and its two
+ *		counts.  Blocks that never ran are omitted, and repeated
+ *		lines are summed, so that several runs may share a file.
+ *
+ *		A function is hot if it was entered at least a hundredth as
+ *		often as the function entered most often, and cold if it
+ *		was never entered at all.
+ */
+
+# include <map>
+# include <vector>
+# include <cstdlib>
+# include <algorithm>
+# include <fstream>
+# include <sstream>
+# include <iostream>
+# include "profile.h"
+# include "generator.h"
+# include "options.h"
+# include "machine.h"
+# include "Label.h"
+
+using namespace std;
+
+# define HOT_FRACTION 100
+
+struct BlockCounts {
+    Count _count, _taken;
+};
+
+static map<string, map<int, BlockCounts>> profile;
+static Count hottest;
+static vector<pair<string, unsigned>> instrumented;
+
+
+/*
+ * Function:	readProfile
+ *
+ * Description:	Read the profile from the given file.  A missing file is
+ *		an error, since the user asked for it explicitly.
+ */
+
+void readProfile(const string &filename)
+{
+    ifstream ifs(filename.c_str());
+    string line, function;
+    BlockCounts counts;
+    int block;
+
+
+    if (!ifs) {
+	cerr << "scc: cannot read profile '" << filename << "'" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    while (getline(ifs, line)) {
+	istringstream iss(line);
+
+	if (iss >> function >> block >> counts._count >> counts._taken) {
+	    BlockCounts &total = profile[function][block];
+
+	    total._count += counts._count;
+	    total._taken += counts._taken;
+	}
+    }
+
+    for (auto &it : profile)
+	hottest = max(hottest, it.second[0]._count);
+}
+
+
+/*
+ * Function:	haveProfile
+ *
+ * Description:	Return whether we have a profile.  Once a profile is read,
+ *		a function or block that is missing from it simply never
+ *		ran.
+ */
+
+bool haveProfile()
+{
+    return !profileUse.empty();
+}
+
+
+/*
+ * Function:	blockCount
+ *
+ * Description:	Return the number of times a block was entered.
+ */
+
+Count blockCount(const string &function, int block)
+{
+    map<string, map<int, BlockCounts>>::iterator it = profile.find(function);
+
+    if (block < 0 || it == profile.end() || it->second.count(block) == 0)
+	return 0;
+
+    return it->second[block]._count;
+}
+
+
+/*
+ * Function:	takenCount
+ *
+ * Description:	Return the number of times the branch ending a block
+ *		went to its first target.
+ */
+
+Count takenCount(const string &function, int block)
+{
+    map<string, map<int, BlockCounts>>::iterator it = profile.find(function);
+
+    if (block < 0 || it == profile.end() || it->second.count(block) == 0)
+	return 0;
+
+    return it->second[block]._taken;
+}
+
+
+/*
+ * Function:	textSection
+ *
+ * Description:	Return the directive for the section in which to place
+ *		the code for a function.
+ */
+
+string textSection(const string &function)
+{
+    Count entered = blockCount(function, 0);
+
+    if (entered == 0)
+	return cold_text_section;
+
+    if (entered * HOT_FRACTION >= hottest)
+	return hot_text_section;
+
+    return "\t.text";
+}
+
+
+/*
+ * Function:	counter
+ *
+ * Description:	Return the memory operand for the low word of a counter.
+ */
+
+string counter(const string &function, int block, bool taken)
+{
+    stringstream ss;
+
+    ss << global_prefix << function << ".counts+";
+    ss << 2 * SIZEOF_COUNT * block + (taken ? SIZEOF_COUNT : 0);
+    return ss.str();
+}
+
+
+/*
+ * Function:	instrumentFunction
+ *
+ * Description:	Note that a function with the given number of blocks has
+ *		been instrumented.
+ */
+
+void instrumentFunction(const string &function, unsigned blocks)
+{
+    instrumented.push_back(make_pair(function, blocks));
+}
+
+
+/*
+ * Function:	generateProfiler
+ *
+ * Description:	Generate the counters of the instrumented functions, a
+ *		table describing them, and a function that appends them to
+ *		the profile and that is run when the program exits.  Each
+ *		entry of the table has the name of a function, its number
+ *		of blocks, and the address of its counters, and the table
+ *		ends with a null name.
+ */
+
+void generateProfiler()
+{
+    Label table, function, block, next, close, done, dump;
+    string name;
+
+
+    if (instrumented.empty())
+	return;
+
+    for (unsigned i = 0; i < instrumented.size(); i ++) {
+	name = global_prefix + instrumented[i].first + ".counts";
+	cout << "\t.local\t" << name << endl;
+	cout << "\t.comm\t" << name << ", ";
+	cout << 2 * SIZEOF_COUNT * instrumented[i].second << ", 8" << endl;
+    }
+
+    cout << "\t.data" << endl;
+    cout << "\t.align\t4" << endl;
+    cout << table << ":" << endl;
+
+    for (unsigned i = 0; i < instrumented.size(); i ++) {
+	cout << "\t.long\t" << literal(".asciz", "\"" + instrumented[i].first + "\"");
+	cout << ", " << instrumented[i].second << ", " << global_prefix;
+	cout << instrumented[i].first << ".counts" << endl;
+    }
+
+    cout << "\t.long\t0" << endl << endl;
+
+
+    /* The dump function saves the callee-saved registers and keeps the
+       stack aligned to sixteen bytes at each call.  It holds the table
+       entry in %ebx, the block number in %esi, the counters of the
+       block in %edi, and the file in %ebp. */
+
+    cout << "\t.text" << endl;
+    cout << dump << ":" << endl;
+    cout << "\tpushl\t%ebx" << endl;
+    cout << "\tpushl\t%esi" << endl;
+    cout << "\tpushl\t%edi" << endl;
+    cout << "\tpushl\t%ebp" << endl;
+    cout << "\tsubl\t$12, %esp" << endl;
+    cout << "\tsubl\t$8, %esp" << endl;
+    cout << "\tpushl\t$" << literal(".asciz", "\"a\"") << endl;
+    cout << "\tpushl\t$" << literal(".asciz", "\"" + profileGenerate + "\"") << endl;
+    cout << "\tcall\t" << global_prefix << "fopen" << endl;
+    cout << "\taddl\t$16, %esp" << endl;
+    cout << "\ttestl\t%eax, %eax" << endl;
+    cout << "\tje\t" << done << endl;
+    cout << "\tmovl\t%eax, %ebp" << endl;
+    cout << "\tmovl\t$" << table << ", %ebx" << endl;
+
+    cout << function << ":" << endl;
+    cout << "\tcmpl\t$0, (%ebx)" << endl;
+    cout << "\tje\t" << close << endl;
+    cout << "\txorl\t%esi, %esi" << endl;
+
+    cout << block << ":" << endl;
+    cout << "\tcmpl\t4(%ebx), %esi" << endl;
+    cout << "\tjge\t" << next << endl;
+    cout << "\tmovl\t%esi, %edi" << endl;
+    cout << "\tshll\t$4, %edi" << endl;
+    cout << "\taddl\t8(%ebx), %edi" << endl;
+    cout << "\tincl\t%esi" << endl;
+    cout << "\tmovl\t(%edi), %eax" << endl;
+    cout << "\torl\t4(%edi), %eax" << endl;
+    cout << "\tje\t" << block << endl;
+    cout << "\tpushl\t12(%edi)" << endl;
+    cout << "\tpushl\t8(%edi)" << endl;
+    cout << "\tpushl\t4(%edi)" << endl;
+    cout << "\tpushl\t(%edi)" << endl;
+    cout << "\tleal\t-1(%esi), %eax" << endl;
+    cout << "\tpushl\t%eax" << endl;
+    cout << "\tpushl\t(%ebx)" << endl;
+    cout << "\tpushl\t$" << literal(".asciz", "\"%s %d %llu %llu\\n\"") << endl;
+    cout << "\tpushl\t%ebp" << endl;
+    cout << "\tcall\t" << global_prefix << "fprintf" << endl;
+    cout << "\taddl\t$32, %esp" << endl;
+    cout << "\tjmp\t" << block << endl;
+
+    cout << next << ":" << endl;
+    cout << "\taddl\t$12, %ebx" << endl;
+    cout << "\tjmp\t" << function << endl;
+
+    cout << close << ":" << endl;
+    cout << "\tsubl\t$12, %esp" << endl;
+    cout << "\tpushl\t%ebp" << endl;
+    cout << "\tcall\t" << global_prefix << "fclose" << endl;
+    cout << "\taddl\t$16, %esp" << endl;
+
+    cout << done << ":" << endl;
+    cout << "\taddl\t$12, %esp" << endl;
+    cout << "\tpopl\t%ebp" << endl;
+    cout << "\tpopl\t%edi" << endl;
+    cout << "\tpopl\t%esi" << endl;
+    cout << "\tpopl\t%ebx" << endl;
+    cout << "\tret" << endl << endl;
+
+    cout << exit_section << endl;
+    cout << "\t.align\t4" << endl;
+    cout << "\t.long\t" << dump << endl << endl;
+}
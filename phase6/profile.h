@@ -0,0 +1,26 @@
+/*
+ * File:	profile.h
+ *
+ * Description:	This file contains the function declarations for
+ *		profile-guided optimization: writing the counters and the
+ *		runtime of an instrumented program, and reading back the
+ *		profile that such a program writes.
+ */
+
+# ifndef PROFILE_H
+# define PROFILE_H
+# include <string>
+
+typedef unsigned long long Count;
+
+void readProfile(const std::string &filename);
+bool haveProfile();
+Count blockCount(const std::string &function, int block);
+Count takenCount(const std::string &function, int block);
+std::string textSection(const std::string &function);
+
+std::string counter(const std::string &function, int block, bool taken);
+void instrumentFunction(const std::string &function, unsigned blocks);
+void generateProfiler();
+
+# endif /* PROFILE_H */
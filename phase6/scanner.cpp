@@ -0,0 +1,543 @@
+/*
+ * File:	scanner.cpp
+ *
+ * Description:	This file contains the function definitions for the
+ *		kernels that the lexical analyzer uses to scan runs of
+ *		whitespace, identifier characters, digits, the bodies of
+ *		strings and comments, and code up to the next string or
+ *		possible comment in its buffer.  Each kernel
+ *		returns a pointer to the first character not in the run,
+ *		or for a comment, just past its terminator.
+ *
+ *		On x86, the kernels classify 16 bytes at a time with SSE2
+ *		or 32 bytes at a time with AVX2, turning each class into a
+ *		bit mask so that the end of the run is its first zero bit.
+ *		Whatever remains at the end of the buffer is left to the
+ *		scalar kernels, so we never read past it.  The fastest
+ *		kernels that the processor supports are chosen at startup,
+ *		and the others remain available for testing.
+ */
+
+# include <cctype>
+# include "scanner.h"
+
+# if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define VECTORS
+# include <immintrin.h>
+# define SSE2 __attribute__((target("sse2")))
+# define AVX2 __attribute__((target("avx2")))
+# endif
+
+using namespace std;
+
+enum { SPACE, WORD, DIGITS, STRING, CODE, COMMENT, KERNELS };
+
+typedef const char *(*Kernel)(const char *p, const char *end, int &lines);
+
+struct Scanner {
+    const char *_name;
+    bool (*_supported)();
+    Kernel _kernels[KERNELS];
+};
+
+
+/*
+ * Function:	member (private)
+ *
+ * Description:	Return whether a character belongs to the given class.
+ *		The body of a string ends at a quote or a newline, and
+ *		code ends at a quote or a slash.
+ */
+
+static inline bool member(int kind, int c)
+{
+    if (kind == SPACE)
+	return isspace(c);
+
+    if (kind == WORD)
+	return isalnum(c) || c == '_';
+
+    if (kind == DIGITS)
+	return isdigit(c);
+
+    if (kind == CODE)
+	return c != '"' && c != '/';
+
+    return c != '"' && c != '\n';
+}
+
+
+/*
+ * Function:	skip (private)
+ *
+ * Description:	Skip a run of characters of the given class one at a
+ *		time, counting any newlines.
+ */
+
+template <int kind>
+static const char *skip(const char *p, const char *end, int &lines)
+{
+    while (p < end && member(kind, (unsigned char) *p)) {
+	if (kind == SPACE && *p == '\n')
+	    lines ++;
+
+	p ++;
+    }
+
+    return p;
+}
+
+
+/*
+ * Function:	comment (private)
+ *
+ * Description:	Skip the body of a comment one character at a time,
+ *		counting any newlines.
+ */
+
+static const char *comment(const char *p, const char *end, int &lines)
+{
+    for (; p < end; p ++)
+	if (*p == '\n')
+	    lines ++;
+	else if (*p == '*' && p + 1 < end && p[1] == '/')
+	    return p + 2;
+
+    return end;
+}
+
+
+/*
+ * Function:	scalar (private)
+ *
+ * Description:	Return whether the scalar kernels are supported, which
+ *		they always are.
+ */
+
+static bool scalar()
+{
+    return true;
+}
+
+
+# ifdef VECTORS
+
+/*
+ * Function:	before (private)
+ *
+ * Description:	Return the number of bits set in a mask below the first
+ *		bit set in another, or in all of it if none is.
+ */
+
+static inline unsigned before(unsigned bits, unsigned stop)
+{
+    return __builtin_popcount(stop != 0 ? bits & ((stop & -stop) - 1) : bits);
+}
+
+
+/*
+ * Function:	equal16 (private)
+ *
+ * Description:	Return the mask of the bytes equal to a character.
+ */
+
+SSE2 static inline unsigned equal16(__m128i v, char c)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+
+/*
+ * Function:	within16 (private)
+ *
+ * Description:	Return the mask of the bytes within the given number of
+ *		characters from the given one.  Subtracting the lowest
+ *		makes this a single unsigned comparison, done by checking
+ *		that the minimum leaves the byte unchanged.
+ */
+
+SSE2 static inline unsigned within16(__m128i v, char low, char count)
+{
+    __m128i x = _mm_sub_epi8(v, _mm_set1_epi8(low));
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(count - 1)), x));
+}
+
+
+/*
+ * Function:	classify16 (private)
+ *
+ * Description:	Return the mask of the bytes in the given class.  Setting
+ *		the case bit folds upper case letters into lower case.
+ */
+
+template <int kind>
+SSE2 static inline unsigned classify16(__m128i v)
+{
+    if (kind == SPACE)
+	return equal16(v, ' ') | within16(v, '\t', 5);
+
+    if (kind == WORD)
+	return within16(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 26) |
+	    within16(v, '0', 10) | equal16(v, '_');
+
+    if (kind == DIGITS)
+	return within16(v, '0', 10);
+
+    if (kind == CODE)
+	return ~(equal16(v, '"') | equal16(v, '/')) & 0xffff;
+
+    return ~(equal16(v, '"') | equal16(v, '\n')) & 0xffff;
+}
+
+
+/*
+ * Function:	skip16 (private)
+ *
+ * Description:	Skip a run of characters of the given class 16 bytes at
+ *		a time.
+ */
+
+template <int kind>
+SSE2 static const char *skip16(const char *p, const char *end, int &lines)
+{
+    unsigned stop;
+    __m128i v;
+
+
+    while (end - p >= 16) {
+	v = _mm_loadu_si128((const __m128i *) p);
+	stop = ~classify16<kind>(v) & 0xffff;
+
+	if (kind == SPACE)
+	    lines += before(equal16(v, '\n'), stop);
+
+	if (stop != 0)
+	    return p + __builtin_ctz(stop);
+
+	p += 16;
+    }
+
+    return skip<kind>(p, end, lines);
+}
+
+
+/*
+ * Function:	comment16 (private)
+ *
+ * Description:	Skip the body of a comment 16 bytes at a time.  The
+ *		terminator is found by comparing the bytes for a star and
+ *		the bytes one further on for a slash.
+ */
+
+SSE2 static const char *comment16(const char *p, const char *end, int &lines)
+{
+    unsigned stop;
+    __m128i v;
+
+
+    while (end - p > 16) {
+	v = _mm_loadu_si128((const __m128i *) p);
+	stop = equal16(v, '*') & equal16(_mm_loadu_si128((const __m128i *) (p + 1)), '/');
+	lines += before(equal16(v, '\n'), stop);
+
+	if (stop != 0)
+	    return p + __builtin_ctz(stop) + 2;
+
+	p += 16;
+    }
+
+    return comment(p, end, lines);
+}
+
+
+/*
+ * Function:	sse2 (private)
+ *
+ * Description:	Return whether the processor supports SSE2.
+ */
+
+static bool sse2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+
+/*
+ * Function:	equal32 (private)
+ *
+ * Description:	Return the mask of the bytes equal to a character.
+ */
+
+AVX2 static inline unsigned equal32(__m256i v, char c)
+{
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+}
+
+
+/*
+ * Function:	within32 (private)
+ *
+ * Description:	Return the mask of the bytes within the given number of
+ *		characters from the given one.
+ */
+
+AVX2 static inline unsigned within32(__m256i v, char low, char count)
+{
+    __m256i x = _mm256_sub_epi8(v, _mm256_set1_epi8(low));
+
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(count - 1)), x));
+}
+
+
+/*
+ * Function:	classify32 (private)
+ *
+ * Description:	Return the mask of the bytes in the given class.
+ */
+
+template <int kind>
+AVX2 static inline unsigned classify32(__m256i v)
+{
+    if (kind == SPACE)
+	return equal32(v, ' ') | within32(v, '\t', 5);
+
+    if (kind == WORD)
+	return within32(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 26) |
+	    within32(v, '0', 10) | equal32(v, '_');
+
+    if (kind == DIGITS)
+	return within32(v, '0', 10);
+
+    if (kind == CODE)
+	return ~(equal32(v, '"') | equal32(v, '/'));
+
+    return ~(equal32(v, '"') | equal32(v, '\n'));
+}
+
+
+/*
+ * Function:	skip32 (private)
+ *
+ * Description:	Skip a run of characters of the given class 32 bytes at
+ *		a time.
+ */
+
+template <int kind>
+AVX2 static const char *skip32(const char *p, const char *end, int &lines)
+{
+    unsigned stop;
+    __m256i v;
+
+
+    while (end - p >= 32) {
+	v = _mm256_loadu_si256((const __m256i *) p);
+	stop = ~classify32<kind>(v);
+
+	if (kind == SPACE)
+	    lines += before(equal32(v, '\n'), stop);
+
+	if (stop != 0)
+	    return p + __builtin_ctz(stop);
+
+	p += 32;
+    }
+
+    return skip16<kind>(p, end, lines);
+}
+
+
+/*
+ * Function:	comment32 (private)
+ *
+ * Description:	Skip the body of a comment 32 bytes at a time.
+ */
+
+AVX2 static const char *comment32(const char *p, const char *end, int &lines)
+{
+    unsigned stop;
+    __m256i v;
+
+
+    while (end - p > 32) {
+	v = _mm256_loadu_si256((const __m256i *) p);
+	stop = equal32(v, '*') & equal32(_mm256_loadu_si256((const __m256i *) (p + 1)), '/');
+	lines += before(equal32(v, '\n'), stop);
+
+	if (stop != 0)
+	    return p + __builtin_ctz(stop) + 2;
+
+	p += 32;
+    }
+
+    return comment16(p, end, lines);
+}
+
+
+/*
+ * Function:	avx2 (private)
+ *
+ * Description:	Return whether the processor supports AVX2, which also
+ *		requires that the operating system saves its registers.
+ */
+
+static bool avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+# endif /* VECTORS */
+
+
+/* The kernels in order of preference */
+
+static const Scanner table[] = {
+# ifdef VECTORS
+    {"avx2", avx2, {skip32<SPACE>, skip32<WORD>, skip32<DIGITS>, skip32<STRING>, skip32<CODE>, comment32}},
+    {"sse2", sse2, {skip16<SPACE>, skip16<WORD>, skip16<DIGITS>, skip16<STRING>, skip16<CODE>, comment16}},
+# endif
+    {"scalar", scalar, {skip<SPACE>, skip<WORD>, skip<DIGITS>, skip<STRING>, skip<CODE>, comment}},
+};
+
+static const unsigned ntable = sizeof(table) / sizeof(table[0]);
+
+
+/*
+ * Function:	fastest (private)
+ *
+ * Description:	Return the fastest kernels that the processor supports.
+ */
+
+static const Scanner *fastest()
+{
+    for (unsigned i = 0; i + 1 < ntable; i ++)
+	if (table[i]._supported())
+	    return &table[i];
+
+    return &table[ntable - 1];
+}
+
+static const Scanner *current = fastest();
+
+
+/*
+ * Function:	scanners
+ *
+ * Description:	Return the names of the kernels that the processor
+ *		supports, fastest first.
+ */
+
+vector<string> scanners()
+{
+    vector<string> names;
+
+    for (unsigned i = 0; i < ntable; i ++)
+	if (table[i]._supported())
+	    names.push_back(table[i]._name);
+
+    return names;
+}
+
+
+/*
+ * Function:	selectScanner
+ *
+ * Description:	Use the named kernels if the processor supports them, and
+ *		return whether it does.
+ */
+
+bool selectScanner(const string &name)
+{
+    for (unsigned i = 0; i < ntable; i ++)
+	if (name == table[i]._name && table[i]._supported()) {
+	    current = &table[i];
+	    return true;
+	}
+
+    return false;
+}
+
+
+/*
+ * Function:	skipSpace
+ *
+ * Description:	Skip a run of whitespace, counting any newlines.
+ */
+
+const char *skipSpace(const char *p, const char *end, int &lines)
+{
+    return current->_kernels[SPACE](p, end, lines);
+}
+
+
+/*
+ * Function:	skipWord
+ *
+ * Description:	Skip a run of letters, digits, and underscores.
+ */
+
+const char *skipWord(const char *p, const char *end)
+{
+    int lines = 0;
+
+    return current->_kernels[WORD](p, end, lines);
+}
+
+
+/*
+ * Function:	skipDigits
+ *
+ * Description:	Skip a run of digits.
+ */
+
+const char *skipDigits(const char *p, const char *end)
+{
+    int lines = 0;
+
+    return current->_kernels[DIGITS](p, end, lines);
+}
+
+
+/*
+ * Function:	skipString
+ *
+ * Description:	Skip the body of a string literal, stopping at the
+ *		closing quote or at a newline, which ends it prematurely.
+ */
+
+const char *skipString(const char *p, const char *end)
+{
+    int lines = 0;
+
+    return current->_kernels[STRING](p, end, lines);
+}
+
+
+/*
+ * Function:	skipCode
+ *
+ * Description:	Skip code up to the next quote or slash, which may begin
+ *		a string or a comment.
+ */
+
+const char *skipCode(const char *p, const char *end)
+{
+    int lines = 0;
+
+    return current->_kernels[CODE](p, end, lines);
+}
+
+
+/*
+ * Function:	skipComment
+ *
+ * Description:	Skip the body of a comment and its terminator, counting
+ *		any newlines.  An unterminated comment runs to the end.
+ */
+
+const char *skipComment(const char *p, const char *end, int &lines)
+{
+    return current->_kernels[COMMENT](p, end, lines);
+}
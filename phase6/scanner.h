@@ -0,0 +1,24 @@
+/*
+ * File:	scanner.h
+ *
+ * Description:	This file contains the function declarations for the
+ *		kernels that the lexical analyzer uses to scan runs of
+ *		characters in its buffer.
+ */
+
+# ifndef SCANNER_H
+# define SCANNER_H
+# include <string>
+# include <vector>
+
+const char *skipSpace(const char *p, const char *end, int &lines);
+const char *skipWord(const char *p, const char *end);
+const char *skipDigits(const char *p, const char *end);
+const char *skipString(const char *p, const char *end);
+const char *skipCode(const char *p, const char *end);
+const char *skipComment(const char *p, const char *end, int &lines);
+
+std::vector<std::string> scanners();
+bool selectScanner(const std::string &name);
+
+# endif /* SCANNER_H */
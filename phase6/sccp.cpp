@@ -0,0 +1,524 @@
+/*
+ * File:	sccp.cpp
+ *
+ * Description:	This file contains the sparse conditional constant
+ *		propagation pass of Wegman and Zadeck.  The pass runs on
+ *		a flow graph in SSA form.
+ *
+ *		Every register starts out undefined, and can only move down
+ *		the lattice to a constant and then to varying.  Blocks are
+ *		only considered once some edge into them is known to be
+ *		executable, and a branch on a constant only makes one of
+ *		its edges executable.  This way, constants propagate
+ *		through phis along paths that are actually taken, and
+ *		blocks that can never be reached are deleted.
+ *
+ *		Integer arithmetic is carried out in 32 bits, just as the
+ *		target would.  We never fold anything whose result the
+ *		target would trap on or leave undefined, such as division
+ *		by zero or converting an out-of-range real to an integer.
+ */
+
+# include <set>
+# include <map>
+# include <cmath>
+# include <cstdio>
+# include <cstdlib>
+# include <cstdint>
+# include <algorithm>
+# include "optimizer.h"
+
+using namespace std;
+
+typedef Instruction I;
+
+enum { UNDEFINED, CONSTANT, VARYING };
+
+struct Value {
+    int _state;
+    long _int;
+    double _real;
+};
+
+typedef pair<BasicBlock *, BasicBlock *> Edge;
+
+
+/* The state of the propagation */
+
+struct Propagator {
+    FlowGraph *graph;
+    vector<Value> values;
+    vector<vector<I *>> uses;
+    map<I *, BasicBlock *> blocks;
+    set<BasicBlock *> visited;
+    set<Edge> edges;
+    vector<Edge> flowWork;
+    vector<I *> ssaWork;
+};
+
+
+/*
+ * Function:	wrap (private)
+ *
+ * Description:	Reduce an integer to 32 bits as the target would.
+ */
+
+static long wrap(long value)
+{
+    return (int32_t) (uint32_t) value;
+}
+
+
+/*
+ * Function:	fold (private)
+ *
+ * Description:	Evaluate an instruction given constant operands.  Return
+ *		false if the result cannot or should not be folded.
+ */
+
+static bool fold(FlowGraph *graph, I *insn, const vector<Value> &args, Value &result)
+{
+    bool real = insn->_args.size() > 0 && graph->_reals[insn->_args[0]];
+    long a = args.size() > 0 ? args[0]._int : 0;
+    long b = args.size() > 1 ? args[1]._int : 0;
+    double x = args.size() > 0 ? args[0]._real : 0;
+    double y = args.size() > 1 ? args[1]._real : 0;
+
+
+    result._state = CONSTANT;
+    result._int = 0;
+    result._real = 0;
+
+    switch (insn->_opcode) {
+    case I::COPY:
+	result = args[0];
+	return true;
+
+    case I::ADD:
+	if (real)
+	    result._real = x + y;
+	else
+	    result._int = wrap((uint32_t) a + (uint32_t) b);
+	break;
+
+    case I::SUB:
+	if (real)
+	    result._real = x - y;
+	else
+	    result._int = wrap((uint32_t) a - (uint32_t) b);
+	break;
+
+    case I::MUL:
+	if (real)
+	    result._real = x * y;
+	else
+	    result._int = wrap((uint32_t) a * (uint32_t) b);
+	break;
+
+    case I::DIV:
+    case I::REM:
+	if (real) {
+	    if (y == 0)
+		return false;
+
+	    result._real = x / y;
+
+	} else {
+	    if (b == 0 || (a == INT32_MIN && b == -1))
+		return false;
+
+	    result._int = insn->_opcode == I::DIV ? a / b : a % b;
+	}
+
+	break;
+
+    case I::NEG:
+	if (real)
+	    result._real = -x;
+	else
+	    result._int = wrap(-(uint32_t) a);
+	break;
+
+    case I::NOT:
+	result._int = real ? x == 0 : a == 0;
+	break;
+
+    case I::LT:
+	result._int = real ? x < y : a < b;
+	break;
+
+    case I::GT:
+	result._int = real ? x > y : a > b;
+	break;
+
+    case I::LE:
+	result._int = real ? x <= y : a <= b;
+	break;
+
+    case I::GE:
+	result._int = real ? x >= y : a >= b;
+	break;
+
+    case I::EQ:
+	result._int = real ? x == y : a == b;
+	break;
+
+    case I::NE:
+	result._int = real ? x != y : a != b;
+	break;
+
+    case I::ITOD:
+	result._real = a;
+	break;
+
+    case I::DTOI:
+	if (!(x > INT32_MIN - 1.0 && x < INT32_MAX + 1.0))
+	    return false;
+
+	result._int = (long) x;
+	break;
+
+    case I::TRUNC:
+	result._int = (int8_t) (uint8_t) a;
+	break;
+
+    default:
+	return false;
+    }
+
+    return !std::isnan(result._real) && !std::isinf(result._real);
+}
+
+
+/*
+ * Function:	lower (private)
+ *
+ * Description:	Lower the value of a register, adding its uses to the
+ *		worklist if it changed.
+ */
+
+static void lower(Propagator &p, int reg, const Value &value)
+{
+    Value &old = p.values[reg];
+
+    if (value._state < old._state)
+	return;
+
+    if (old._state == value._state && (old._state != CONSTANT ||
+	    (old._int == value._int && old._real == value._real)))
+	return;
+
+    if (old._state == CONSTANT && value._state == CONSTANT)
+	old._state = VARYING;
+    else
+	old = value;
+
+    for (unsigned i = 0; i < p.uses[reg].size(); i ++)
+	p.ssaWork.push_back(p.uses[reg][i]);
+}
+
+
+/*
+ * Function:	destination (private)
+ *
+ * Description:	Return the block to which a switch jumps on the given
+ *		value.  The range check is unsigned, as on the target.
+ */
+
+static BasicBlock *destination(I *insn, long value)
+{
+    uint32_t index = value - insn->_value;
+
+    if (index >= insn->_table.size())
+	return insn->_targets[0];
+
+    return insn->_table[index];
+}
+
+
+/*
+ * Function:	visit (private)
+ *
+ * Description:	Evaluate a single instruction in an executable block.
+ */
+
+static void visit(Propagator &p, I *insn)
+{
+    BasicBlock *block = p.blocks[insn];
+    vector<Value> args;
+    Value result;
+
+
+    if (insn->_opcode == I::JUMP) {
+	p.flowWork.push_back(Edge(block, insn->_targets[0]));
+	return;
+    }
+
+    if (insn->_opcode == I::BRANCH) {
+	const Value &cond = p.values[insn->_args[0]];
+	bool real = p.graph->_reals[insn->_args[0]];
+
+	if (cond._state == VARYING) {
+	    p.flowWork.push_back(Edge(block, insn->_targets[0]));
+	    p.flowWork.push_back(Edge(block, insn->_targets[1]));
+
+	} else if (cond._state == CONSTANT) {
+	    bool taken = real ? cond._real != 0 : cond._int != 0;
+	    p.flowWork.push_back(Edge(block, insn->_targets[taken ? 0 : 1]));
+	}
+
+	return;
+    }
+
+    if (insn->_opcode == I::SWITCH) {
+	const Value &index = p.values[insn->_args[0]];
+
+	if (index._state == VARYING) {
+	    p.flowWork.push_back(Edge(block, insn->_targets[0]));
+
+	    for (unsigned i = 0; i < insn->_table.size(); i ++)
+		p.flowWork.push_back(Edge(block, insn->_table[i]));
+
+	} else if (index._state == CONSTANT)
+	    p.flowWork.push_back(Edge(block, destination(insn, index._int)));
+
+	return;
+    }
+
+    if (insn->_dst < 0)
+	return;
+
+    result._state = UNDEFINED;
+
+    if (insn->_opcode == I::PHI) {
+	for (unsigned i = 0; i < insn->_args.size(); i ++) {
+	    if (p.edges.count(Edge(insn->_sources[i], block)) == 0)
+		continue;
+
+	    const Value &arg = p.values[insn->_args[i]];
+
+	    if (arg._state == UNDEFINED)
+		continue;
+
+	    if (arg._state == VARYING || (result._state == CONSTANT &&
+		    (arg._int != result._int || arg._real != result._real))) {
+		result._state = VARYING;
+		break;
+	    }
+
+	    result = arg;
+	}
+
+    } else if (insn->_opcode == I::CONST) {
+	result._state = CONSTANT;
+	result._int = wrap(insn->_value);
+	result._real = 0;
+
+    } else if (insn->_opcode == I::FCONST) {
+	result._state = CONSTANT;
+	result._int = 0;
+	result._real = strtod(insn->_text.c_str(), NULL);
+
+    } else if (insn->hasSideEffects() || insn->_args.empty()) {
+	result._state = VARYING;
+
+    } else {
+	result._state = CONSTANT;
+
+	for (unsigned i = 0; i < insn->_args.size(); i ++) {
+	    args.push_back(p.values[insn->_args[i]]);
+
+	    if (args.back()._state == VARYING)
+		result._state = VARYING;
+	    else if (args.back()._state == UNDEFINED && result._state != VARYING)
+		result._state = UNDEFINED;
+	}
+
+	if (result._state == CONSTANT && !fold(p.graph, insn, args, result))
+	    result._state = VARYING;
+    }
+
+    lower(p, insn->_dst, result);
+}
+
+
+/*
+ * Function:	propagate (private)
+ *
+ * Description:	Run the propagation to a fixed point.
+ */
+
+static void propagate(Propagator &p)
+{
+    p.flowWork.push_back(Edge(nullptr, p.graph->entry()));
+
+    while (!p.flowWork.empty() || !p.ssaWork.empty()) {
+	while (!p.flowWork.empty()) {
+	    Edge edge = p.flowWork.back();
+	    BasicBlock *block = edge.second;
+	    p.flowWork.pop_back();
+
+	    if (p.edges.count(edge) > 0)
+		continue;
+
+	    p.edges.insert(edge);
+
+	    for (unsigned i = 0; i < block->_insns.size(); i ++)
+		if (block->_insns[i]->_opcode == I::PHI)
+		    visit(p, block->_insns[i]);
+
+	    if (p.visited.count(block) == 0) {
+		p.visited.insert(block);
+
+		for (unsigned i = 0; i < block->_insns.size(); i ++)
+		    if (block->_insns[i]->_opcode != I::PHI)
+			visit(p, block->_insns[i]);
+	    }
+	}
+
+	while (!p.ssaWork.empty()) {
+	    I *insn = p.ssaWork.back();
+	    p.ssaWork.pop_back();
+
+	    if (p.visited.count(p.blocks[insn]) > 0)
+		visit(p, insn);
+	}
+    }
+}
+
+
+/*
+ * Function:	materialize (private)
+ *
+ * Description:	Turn an instruction whose result is known into a constant.
+ */
+
+static void materialize(FlowGraph *graph, I *insn, const Value &value)
+{
+    char buf[64];
+
+
+    insn->_args.clear();
+    insn->_sources.clear();
+    insn->_var = -1;
+    insn->_symbol = nullptr;
+
+    if (graph->_reals[insn->_dst]) {
+	snprintf(buf, sizeof(buf), "%.17g", value._real);
+	insn->_opcode = I::FCONST;
+	insn->_text = buf;
+    } else {
+	insn->_opcode = I::CONST;
+	insn->_value = value._int;
+    }
+}
+
+
+/*
+ * Function:	propagateConstants
+ *
+ * Description:	Propagate constants through the flow graph, replace every
+ *		computation with a known result by a constant, fold
+ *		branches on constants, and delete unreachable blocks.
+ */
+
+void propagateConstants(FlowGraph *graph)
+{
+    unsigned folded = 0, branches = 0, size;
+    Propagator p;
+
+
+    graph->connect();
+    p.graph = graph;
+    p.values.assign(graph->_reals.size(), Value());
+    p.uses.resize(graph->_reals.size());
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	BasicBlock *block = graph->_blocks[i];
+
+	for (unsigned j = 0; j < block->_insns.size(); j ++) {
+	    I *insn = block->_insns[j];
+	    p.blocks[insn] = block;
+
+	    for (unsigned k = 0; k < insn->_args.size(); k ++)
+		p.uses[insn->_args[k]].push_back(insn);
+	}
+    }
+
+    for (unsigned i = 0; i < p.values.size(); i ++)
+	p.values[i]._state = UNDEFINED;
+
+    propagate(p);
+
+
+    /* Rewrite the executable blocks. */
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	BasicBlock *block = graph->_blocks[i];
+
+	if (p.visited.count(block) == 0)
+	    continue;
+
+	for (unsigned j = 0; j < block->_insns.size(); j ++) {
+	    I *insn = block->_insns[j];
+
+	    if (insn->_opcode == I::BRANCH) {
+		for (unsigned k = 0; k < 2; k ++)
+		    if (p.edges.count(Edge(block, insn->_targets[k])) == 0) {
+			insn->_opcode = I::JUMP;
+			insn->_args.clear();
+			insn->_targets[0] = insn->_targets[1 - k];
+			insn->_targets[1] = nullptr;
+			branches ++;
+			break;
+		    }
+
+	    } else if (insn->_opcode == I::SWITCH &&
+		    p.values[insn->_args[0]]._state == CONSTANT) {
+		insn->_opcode = I::JUMP;
+		insn->_targets[0] = destination(insn, p.values[insn->_args[0]]._int);
+		insn->_args.clear();
+		insn->_table.clear();
+		branches ++;
+
+	    } else if (insn->_dst >= 0 && p.values[insn->_dst]._state == CONSTANT
+		    && insn->_opcode != I::CONST && insn->_opcode != I::FCONST
+		    && (insn->_opcode == I::PHI || !insn->hasSideEffects())) {
+		materialize(graph, insn, p.values[insn->_dst]);
+		folded ++;
+	    }
+	}
+
+	stable_partition(block->_insns.begin(), block->_insns.end(),
+	    [](I *insn) { return insn->_opcode == I::PHI; });
+    }
+
+
+    /* Delete the unreachable blocks and any phi operands that came from
+       edges that no longer exist. */
+
+    size = graph->_blocks.size();
+    graph->prune();
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	BasicBlock *block = graph->_blocks[i];
+
+	for (unsigned j = 0; j < block->_insns.size(); j ++) {
+	    I *phi = block->_insns[j];
+
+	    if (phi->_opcode != I::PHI)
+		break;
+
+	    for (unsigned k = phi->_args.size(); k > 0; k --)
+		if (find(block->_preds.begin(), block->_preds.end(),
+			phi->_sources[k - 1]) == block->_preds.end()) {
+		    phi->_args.erase(phi->_args.begin() + k - 1);
+		    phi->_sources.erase(phi->_sources.begin() + k - 1);
+		}
+	}
+    }
+
+    addStatistic("sccp", "values folded", folded);
+    addStatistic("sccp", "branches folded", branches);
+    addStatistic("sccp", "blocks deleted", size - graph->_blocks.size());
+}
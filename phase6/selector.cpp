@@ -0,0 +1,1188 @@
+/*
+ * File:	selector.cpp
+ *
+ * Description:	This file contains the instruction selector, which emits
+ *		Intel 32-bit assembly for a function given its flow graph.
+ *
+ *		The selector is deliberately simple.  Every virtual
+ *		register that must be materialized lives in its own stack
+ *		slot, and each instruction loads its operands into fixed
+ *		scratch registers (%eax, %ecx, and %edx for integers, and
+ *		%xmm0 through %xmm2 for reals), computes its result, and
+ *		stores it back.  Any smarter register assignment belongs
+ *		in the optimization passes that run before us.
+ *
+ *		However, we do avoid the most obvious waste:
+ *		- constants and the addresses of globals and literals are
+ *		  used as immediate operands rather than materialized
+ *		- loads and stores through the address of a variable or
+ *		  global use the memory operand directly
+ *		- a comparison immediately followed by a branch or select
+ *		  on its result is emitted as a compare and conditional
+ *		  jump or move
+ *		- instructions whose results are unused and that have no
+ *		  side effects are not emitted at all
+ *		- jumps to the next block in the layout are omitted
+ *		- a load whose value is only added to or subtracted from
+ *		  and stored back to the same address is emitted as a
+ *		  single instruction on memory
+ *		- a switch is a single unsigned range check and an
+ *		  indirect jump through a table in the literal pool
+ *		- the tops of loops are aligned, as marked by the layout
+ *
+ *		Vector registers get 16-byte slots, which are not aligned,
+ *		so all vector loads and stores use the unaligned moves.
+ *
+ *		Given a profile, the registers used most often get the
+ *		slots nearest the frame pointer, whose offsets are more
+ *		likely to fit in a byte, and each function is placed in a
+ *		hot or cold text section.  When instrumenting, each block
+ *		numbered during lowering increments its counter on entry,
+ *		and the first target of each branch is reached through a
+ *		stub that counts the branch as taken.
+ */
+
+# include <cassert>
+# include <sstream>
+# include <iostream>
+# include <algorithm>
+# include "selector.h"
+# include "generator.h"
+# include "profile.h"
+# include "machine.h"
+# include "options.h"
+
+using namespace std;
+
+typedef Instruction I;
+
+# define VECTOR_SIZE 16
+
+
+/* Where the value of a virtual register can be found */
+
+enum { IMMEDIATE, SYMBOLIC, FRAME, SLOT, LITERAL };
+
+struct Location {
+    int _kind;
+    string _text;
+    int _offset;
+};
+
+static vector<Location> locations;
+static vector<unsigned> uses;
+static int frameSize, frameOffset, depth;
+
+static BasicBlock *current;
+static BasicBlocks stubs;
+
+
+/*
+ * Function:	frame (private)
+ *
+ * Description:	Return the memory operand for the given frame offset.
+ *		Without a frame pointer, the offset is adjusted to be
+ *		relative to %esp, taking into account anything pushed for
+ *		a call in progress.
+ */
+
+static string frame(int offset)
+{
+    stringstream ss;
+
+    if (omitFramePointer)
+	ss << offset + frameOffset + depth << "(%esp)";
+    else
+	ss << offset << "(%ebp)";
+
+    return ss.str();
+}
+
+
+/*
+ * Function:	operand (private)
+ *
+ * Description:	Return a source operand for the given register without
+ *		emitting any code.  Addresses of variables have no such
+ *		operand and must first be loaded into a register.
+ */
+
+static string operand(int v)
+{
+    const Location &loc = locations[v];
+
+    if (loc._kind == IMMEDIATE || loc._kind == SYMBOLIC)
+	return "$" + loc._text;
+
+    if (loc._kind == LITERAL)
+	return loc._text;
+
+    return frame(loc._offset);
+}
+
+
+/*
+ * Function:	load (private)
+ *
+ * Description:	Load an integer register into the given machine register.
+ */
+
+static void load(int v, const string &reg)
+{
+    if (locations[v]._kind == FRAME)
+	cout << "\tleal\t" << frame(locations[v]._offset) << ", " << reg << endl;
+    else
+	cout << "\tmovl\t" << operand(v) << ", " << reg << endl;
+}
+
+
+/*
+ * Function:	loadReal (private)
+ *
+ * Description:	Load a real register into the given machine register.
+ */
+
+static void loadReal(int v, const string &reg)
+{
+    cout << "\tmovsd\t" << operand(v) << ", " << reg << endl;
+}
+
+
+/*
+ * Function:	source (private)
+ *
+ * Description:	Return an operand for an integer register that can be
+ *		used as the source of an arithmetic instruction, loading it
+ *		into the given machine register only if necessary.
+ */
+
+static string source(int v, const string &reg)
+{
+    if (locations[v]._kind == FRAME) {
+	load(v, reg);
+	return reg;
+    }
+
+    return operand(v);
+}
+
+
+/*
+ * Function:	store (private)
+ *
+ * Description:	Store a machine register into the slot for the given
+ *		virtual register.
+ */
+
+static void store(FlowGraph *graph, int v, const string &reg)
+{
+    if (graph->_reals[v])
+	cout << "\tmovsd\t" << reg << ", " << frame(locations[v]._offset) << endl;
+    else
+	cout << "\tmovl\t" << reg << ", " << frame(locations[v]._offset) << endl;
+}
+
+
+/*
+ * Function:	memory (private)
+ *
+ * Description:	Return a memory operand for the location whose address is
+ *		in the given register, using %ecx if the address must be
+ *		loaded first.
+ */
+
+static string memory(int addr)
+{
+    const Location &loc = locations[addr];
+
+    if (loc._kind == FRAME)
+	return frame(loc._offset);
+
+    if (loc._kind == SYMBOLIC || loc._kind == IMMEDIATE)
+	return loc._text;
+
+    load(addr, "%ecx");
+    return "(%ecx)";
+}
+
+
+/*
+ * Function:	variable (private)
+ *
+ * Description:	Return the memory operand for a variable.
+ */
+
+static string variable(FlowGraph *graph, int var)
+{
+    return frame(graph->_vars[var]._offset);
+}
+
+
+/*
+ * Function:	layout (private)
+ *
+ * Description:	Assign frame offsets to the variables and to every virtual
+ *		register that needs a slot, and determine the location of
+ *		those that do not.  Variables that are no longer referenced,
+ *		such as those promoted to registers, get no slot.  Return
+ *		the size of the frame.  Given a profile, registers are
+ *		assigned slots in order of how often they are used.
+ *
+ *		Without a frame pointer, the slot that would hold the old
+ *		%ebp is free for our own use, and a leaf function need not
+ *		keep the stack aligned, since it calls nothing.
+ */
+
+static int layout(FlowGraph *graph)
+{
+    vector<bool> referenced(graph->_vars.size(), false);
+    vector<Count> weights(graph->_reals.size(), 0);
+    vector<int> sizes(graph->_reals.size(), 0);
+    const string &name = graph->_id->name();
+    int base = omitFramePointer ? SIZEOF_REG : 0;
+    int offset = base;
+    vector<int> slots;
+    bool leaf = true;
+
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	Instructions &insns = graph->_blocks[i]->_insns;
+
+	for (unsigned j = 0; j < insns.size(); j ++) {
+	    if (insns[j]->_var >= 0)
+		referenced[insns[j]->_var] = true;
+
+	    if (insns[j]->_opcode == I::CALL)
+		leaf = false;
+	}
+    }
+
+    for (unsigned i = 0; i < graph->_vars.size(); i ++) {
+	Variable &var = graph->_vars[i];
+
+	if (!var._param && referenced[i]) {
+	    offset -= var._size;
+	    var._offset = offset;
+	}
+    }
+
+    locations.assign(graph->_reals.size(), Location());
+    uses.assign(graph->_reals.size(), 0);
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	Instructions &insns = graph->_blocks[i]->_insns;
+	Count count = blockCount(name, graph->_blocks[i]->_index);
+
+	for (unsigned j = 0; j < insns.size(); j ++) {
+	    for (unsigned k = 0; k < insns[j]->_args.size(); k ++) {
+		uses[insns[j]->_args[k]] ++;
+		weights[insns[j]->_args[k]] += count;
+	    }
+
+	    if (insns[j]->_dst >= 0)
+		weights[insns[j]->_dst] += count;
+	}
+    }
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	Instructions &insns = graph->_blocks[i]->_insns;
+
+	for (unsigned j = 0; j < insns.size(); j ++) {
+	    I *insn = insns[j];
+	    int v = insn->_dst;
+
+	    if (v < 0)
+		continue;
+
+	    Location &loc = locations[v];
+	    stringstream ss;
+
+	    if (insn->_opcode == I::CONST) {
+		ss << insn->_value;
+		loc._kind = IMMEDIATE;
+		loc._text = ss.str();
+
+	    } else if (insn->_opcode == I::GADDR) {
+		loc._kind = SYMBOLIC;
+		loc._text = global_prefix + insn->_symbol->name();
+
+	    } else if (insn->_opcode == I::STRING) {
+		loc._kind = SYMBOLIC;
+		loc._text = literal(".asciz", insn->_text);
+
+	    } else if (insn->_opcode == I::FCONST) {
+		loc._kind = LITERAL;
+		loc._text = literal(".double", insn->_text);
+
+	    } else if (insn->_opcode == I::ADDR) {
+		loc._kind = FRAME;
+		loc._offset = graph->_vars[insn->_var]._offset;
+
+	    } else {
+		loc._kind = SLOT;
+		slots.push_back(v);
+
+		if (insn->isVector())
+		    sizes[v] = VECTOR_SIZE;
+		else
+		    sizes[v] = graph->_reals[v] ? SIZEOF_DOUBLE : SIZEOF_REG;
+	    }
+	}
+    }
+
+    if (haveProfile())
+	stable_sort(slots.begin(), slots.end(),
+	    [&](int a, int b) { return weights[a] > weights[b]; });
+
+    for (unsigned i = 0; i < slots.size(); i ++) {
+	offset -= sizes[slots[i]];
+	locations[slots[i]]._offset = offset;
+    }
+
+    if (!omitFramePointer || !leaf)
+	while ((PARAM_OFFSET - offset) % STACK_ALIGNMENT != 0)
+	    offset --;
+
+    frameOffset = -offset;
+    return base - offset;
+}
+
+
+/*
+ * Function:	condition (private)
+ *
+ * Description:	Return the condition code suffix for a comparison.  Real
+ *		comparisons use the unsigned conditions and always have
+ *		their operands ordered so that an unordered result (i.e.,
+ *		a NaN) compares false.
+ */
+
+static string condition(I::Opcode opcode, bool real, bool negate)
+{
+    static const char *integers[][2] = {
+	{"l", "ge"}, {"g", "le"}, {"le", "g"}, {"ge", "l"}, {"e", "ne"},
+	{"ne", "e"}
+    };
+
+    static const char *reals[][2] = {
+	{"a", "be"}, {"a", "be"}, {"ae", "b"}, {"ae", "b"}, {"e", "ne"},
+	{"ne", "e"}
+    };
+
+    return (real ? reals : integers)[opcode - I::LT][negate];
+}
+
+
+/*
+ * Function:	compare (private)
+ *
+ * Description:	Emit the comparison for the given instruction, leaving the
+ *		result in the flags.
+ */
+
+static void compare(FlowGraph *graph, I *insn)
+{
+    int left = insn->_args[0], right = insn->_args[1];
+
+
+    if (graph->_reals[left]) {
+	if (insn->_opcode == I::LT || insn->_opcode == I::LE) {
+	    loadReal(right, "%xmm0");
+	    cout << "\tucomisd\t" << operand(left) << ", %xmm0" << endl;
+	} else {
+	    loadReal(left, "%xmm0");
+	    cout << "\tucomisd\t" << operand(right) << ", %xmm0" << endl;
+	}
+
+    } else {
+	string src = source(right, "%ecx");
+
+	load(left, "%eax");
+	cout << "\tcmpl\t" << src << ", %eax" << endl;
+    }
+}
+
+
+/*
+ * Function:	branch (private)
+ *
+ * Description:	Emit a conditional branch given the condition for the true
+ *		target, its negation, and the block that follows.
+ */
+
+static void branch(const string &cc, const string &ncc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse, BasicBlock *next)
+{
+    if (ifTrue == next)
+	cout << "\tj" << ncc << "\t" << ifFalse << endl;
+
+    else {
+	cout << "\tj" << cc << "\t" << ifTrue << endl;
+
+	if (ifFalse != next)
+	    cout << "\tjmp\t" << ifFalse << endl;
+    }
+}
+
+
+/*
+ * Function:	branchUnordered (private)
+ *
+ * Description:	Emit a branch after a real comparison for equality.  The
+ *		comparison is true (for equality) only if the zero flag is
+ *		set and the parity flag is clear.
+ */
+
+static void branchUnordered(bool equal, BasicBlock *ifTrue,
+	BasicBlock *ifFalse, BasicBlock *next)
+{
+    BasicBlock *ne = equal ? ifFalse : ifTrue;
+    BasicBlock *eq = equal ? ifTrue : ifFalse;
+
+    cout << "\tjne\t" << ne << endl;
+    cout << "\tjp\t" << ne << endl;
+
+    if (eq != next)
+	cout << "\tjmp\t" << eq << endl;
+}
+
+
+/*
+ * Function:	setcc (private)
+ *
+ * Description:	Materialize the result of a comparison whose flags have
+ *		already been set into %eax.
+ */
+
+static void setcc(I::Opcode opcode, bool real)
+{
+    cout << "\tset" << condition(opcode, real, false) << "\t%al" << endl;
+
+    if (real && opcode == I::EQ) {
+	cout << "\tsetnp\t%cl" << endl;
+	cout << "\tandb\t%cl, %al" << endl;
+    } else if (real && opcode == I::NE) {
+	cout << "\tsetp\t%cl" << endl;
+	cout << "\torb\t%cl, %al" << endl;
+    }
+
+    cout << "\tmovzbl\t%al, %eax" << endl;
+}
+
+
+/*
+ * Function:	testZero (private)
+ *
+ * Description:	Compare a register against zero, leaving the result in the
+ *		flags.
+ */
+
+static void testZero(FlowGraph *graph, int v)
+{
+    if (graph->_reals[v]) {
+	loadReal(v, "%xmm0");
+	cout << "\txorpd\t%xmm1, %xmm1" << endl;
+	cout << "\tucomisd\t%xmm1, %xmm0" << endl;
+    } else {
+	load(v, "%eax");
+	cout << "\ttestl\t%eax, %eax" << endl;
+    }
+}
+
+
+/*
+ * Function:	select (private)
+ *
+ * Description:	Emit a select given the comparison fused with it, if any.
+ *		An integer select is a conditional move.  A real select on
+ *		a real comparison builds a mask with cmpsd, unless it just
+ *		picks the smaller or larger of the operands compared, in
+ *		which case it is a minsd or maxsd.  Any other real select
+ *		builds the mask from the flags.  The mask then blends the
+ *		two operands.
+ */
+
+static void select(FlowGraph *graph, I *insn, I *fused)
+{
+    static const char *predicates[] = {"lt", "lt", "le", "le", "eq", "neq"};
+    int cond = insn->_args[0], a = insn->_args[1], b = insn->_args[2];
+    I::Opcode opcode = fused != nullptr ? fused->_opcode : I::NE;
+    bool freal = graph->_reals[fused != nullptr ? fused->_args[0] : cond];
+    int x, y;
+
+
+    if (graph->_reals[insn->_dst] && fused != nullptr && freal) {
+	x = fused->_args[0];
+	y = fused->_args[1];
+
+	if (opcode == I::GT || opcode == I::GE)
+	    swap(x, y);
+
+	if ((opcode == I::LT || opcode == I::GT) && a == x && b == y) {
+	    loadReal(x, "%xmm0");
+	    cout << "\tminsd\t" << operand(y) << ", %xmm0" << endl;
+	    store(graph, insn->_dst, "%xmm0");
+	    return;
+	}
+
+	if ((opcode == I::LT || opcode == I::GT) && a == y && b == x) {
+	    loadReal(y, "%xmm0");
+	    cout << "\tmaxsd\t" << operand(x) << ", %xmm0" << endl;
+	    store(graph, insn->_dst, "%xmm0");
+	    return;
+	}
+
+	loadReal(x, "%xmm0");
+	cout << "\tcmp" << predicates[opcode - I::LT] << "sd\t";
+	cout << operand(y) << ", %xmm0" << endl;
+
+    } else {
+	if (fused != nullptr)
+	    compare(graph, fused);
+	else
+	    testZero(graph, cond);
+
+	if (!graph->_reals[insn->_dst]) {
+	    load(b, "%eax");
+	    load(a, "%edx");
+
+	    if (freal && opcode == I::EQ) {
+		load(b, "%ecx");
+		cout << "\tcmove\t%edx, %eax" << endl;
+		cout << "\tcmovp\t%ecx, %eax" << endl;
+	    } else if (freal && opcode == I::NE) {
+		cout << "\tcmovne\t%edx, %eax" << endl;
+		cout << "\tcmovp\t%edx, %eax" << endl;
+	    } else {
+		cout << "\tcmov" << condition(opcode, freal, false);
+		cout << "\t%edx, %eax" << endl;
+	    }
+
+	    store(graph, insn->_dst, "%eax");
+	    return;
+	}
+
+	setcc(opcode, freal);
+	cout << "\tnegl\t%eax" << endl;
+	cout << "\tmovd\t%eax, %xmm0" << endl;
+	cout << "\tpshufd\t$0, %xmm0, %xmm0" << endl;
+    }
+
+    loadReal(a, "%xmm1");
+    cout << "\tandpd\t%xmm0, %xmm1" << endl;
+    loadReal(b, "%xmm2");
+    cout << "\tandnpd\t%xmm2, %xmm0" << endl;
+    cout << "\torpd\t%xmm1, %xmm0" << endl;
+    store(graph, insn->_dst, "%xmm0");
+}
+
+
+/*
+ * Function:	target (private)
+ *
+ * Description:	Return the first target of a branch.  When instrumenting,
+ *		this is instead a new stub that counts the branch as taken
+ *		and then jumps to the real target.
+ */
+
+static BasicBlock *target(I *insn)
+{
+    BasicBlock *stub;
+    I *jump;
+
+
+    if (profileGenerate.empty() || current->_index < 0)
+	return insn->_targets[0];
+
+    stub = new BasicBlock();
+    stub->_index = current->_index;
+    jump = new I(I::JUMP);
+    jump->_targets[0] = insn->_targets[0];
+    stub->_insns.push_back(jump);
+    stubs.push_back(stub);
+    return stub;
+}
+
+
+/*
+ * Function:	increment (private)
+ *
+ * Description:	Emit code to increment a 64-bit counter in memory.
+ */
+
+static void increment(const string &counter)
+{
+    cout << "\taddl\t$1, " << counter << endl;
+    cout << "\tadcl\t$0, " << counter << "+4" << endl;
+}
+
+
+/*
+ * Function:	call (private)
+ *
+ * Description:	Emit a function call.  Arguments are pushed from right to
+ *		left after first keeping the stack aligned.
+ */
+
+static void call(FlowGraph *graph, I *insn)
+{
+    unsigned bytesPushed = 0;
+    int v;
+
+
+    for (unsigned i = 0; i < insn->_args.size(); i ++)
+	bytesPushed += graph->_reals[insn->_args[i]] ? SIZEOF_DOUBLE : SIZEOF_REG;
+
+    if (bytesPushed % STACK_ALIGNMENT != 0) {
+	unsigned pad = STACK_ALIGNMENT - bytesPushed % STACK_ALIGNMENT;
+	cout << "\tsubl\t$" << pad << ", %esp" << endl;
+	bytesPushed += pad;
+	depth += pad;
+    }
+
+    for (int i = insn->_args.size() - 1; i >= 0; i --) {
+	v = insn->_args[i];
+
+	if (graph->_reals[v]) {
+	    loadReal(v, "%xmm0");
+	    cout << "\tsubl\t$8, %esp" << endl;
+	    cout << "\tmovsd\t%xmm0, (%esp)" << endl;
+	    depth += SIZEOF_DOUBLE;
+	} else {
+	    string src = source(v, "%eax");
+	    cout << "\tpushl\t" << src << endl;
+	    depth += SIZEOF_REG;
+	}
+    }
+
+    cout << "\tcall\t" << global_prefix << insn->_symbol->name() << endl;
+
+    if (bytesPushed > 0)
+	cout << "\taddl\t$" << bytesPushed << ", %esp" << endl;
+
+    depth -= bytesPushed;
+
+    if (graph->_reals[insn->_dst]) {
+	if (uses[insn->_dst] > 0)
+	    cout << "\tfstpl\t" << frame(locations[insn->_dst]._offset) << endl;
+	else
+	    cout << "\tfstp\t%st(0)" << endl;
+
+    } else if (uses[insn->_dst] > 0)
+	store(graph, insn->_dst, "%eax");
+}
+
+
+/*
+ * Function:	vmove (private)
+ *
+ * Description:	Return the unaligned move for a vector register.
+ */
+
+static string vmove(FlowGraph *graph, int v)
+{
+    return graph->_reals[v] ? "movupd" : "movdqu";
+}
+
+
+/*
+ * Function:	epilogue (private)
+ *
+ * Description:	Emit the epilogue of the function.  Every return has its
+ *		own copy, so that a return that is moved out of the way
+ *		by the layout need not jump back to a shared one.
+ */
+
+static void epilogue()
+{
+    if (!omitFramePointer) {
+	cout << "\tmovl\t%ebp, %esp" << endl;
+	cout << "\tpopl\t%ebp" << endl;
+    } else if (frameSize > 0)
+	cout << "\taddl\t$" << frameSize << ", %esp" << endl;
+
+    cout << "\tret" << endl;
+}
+
+
+/*
+ * Function:	emit (private)
+ *
+ * Description:	Emit the code for a single instruction.  The following
+ *		instruction is given so that a comparison can be fused
+ *		with the branch that uses it, and the next block is given
+ *		so that jumps to it can be omitted.
+ */
+
+static void emit(FlowGraph *graph, I *insn, I *following, BasicBlock *next)
+{
+    static const char *integers[] = {"addl", "subl", "imull"};
+    static const char *reals[] = {"addsd", "subsd", "mulsd"};
+    static const char *packed[][4] = {
+	{"paddd", "psubd", nullptr, nullptr},
+	{"addpd", "subpd", "mulpd", "divpd"},
+    };
+    static I *fused = nullptr;
+    int dst = insn->_dst;
+    bool real = dst >= 0 && graph->_reals[dst];
+    stringstream ss;
+    string mem;
+
+
+    if (dst >= 0 && uses[dst] == 0 && !insn->hasSideEffects())
+	return;
+
+    switch (insn->_opcode) {
+    case I::CONST:
+    case I::FCONST:
+    case I::STRING:
+    case I::GADDR:
+    case I::ADDR:
+	break;
+
+    case I::LOAD:
+	mem = memory(insn->_args[0]);
+
+	if (real) {
+	    cout << "\tmovsd\t" << mem << ", %xmm0" << endl;
+	    store(graph, dst, "%xmm0");
+	} else {
+	    cout << (insn->_size == 1 ? "\tmovsbl\t" : "\tmovl\t");
+	    cout << mem << ", %eax" << endl;
+	    store(graph, dst, "%eax");
+	}
+
+	break;
+
+    case I::STORE:
+	if (graph->_reals[insn->_args[1]]) {
+	    loadReal(insn->_args[1], "%xmm0");
+	    mem = memory(insn->_args[0]);
+	    cout << "\tmovsd\t%xmm0, " << mem << endl;
+	} else {
+	    load(insn->_args[1], "%eax");
+	    mem = memory(insn->_args[0]);
+	    cout << (insn->_size == 1 ? "\tmovb\t%al, " : "\tmovl\t%eax, ");
+	    cout << mem << endl;
+	}
+
+	break;
+
+    case I::LOADVAR:
+	mem = variable(graph, insn->_var);
+
+	if (real) {
+	    cout << "\tmovsd\t" << mem << ", %xmm0" << endl;
+	    store(graph, dst, "%xmm0");
+	} else {
+	    cout << (graph->_vars[insn->_var]._size == 1 ? "\tmovsbl\t" : "\tmovl\t");
+	    cout << mem << ", %eax" << endl;
+	    store(graph, dst, "%eax");
+	}
+
+	break;
+
+    case I::STOREVAR:
+	mem = variable(graph, insn->_var);
+
+	if (graph->_reals[insn->_args[0]]) {
+	    loadReal(insn->_args[0], "%xmm0");
+	    cout << "\tmovsd\t%xmm0, " << mem << endl;
+	} else {
+	    load(insn->_args[0], "%eax");
+	    cout << (graph->_vars[insn->_var]._size == 1 ? "\tmovb\t%al, " : "\tmovl\t%eax, ");
+	    cout << mem << endl;
+	}
+
+	break;
+
+    case I::COPY:
+	if (real) {
+	    loadReal(insn->_args[0], "%xmm0");
+	    store(graph, dst, "%xmm0");
+	} else {
+	    load(insn->_args[0], "%eax");
+	    store(graph, dst, "%eax");
+	}
+
+	break;
+
+    case I::ADD:
+    case I::SUB:
+    case I::MUL:
+	if (real) {
+	    loadReal(insn->_args[0], "%xmm0");
+	    cout << "\t" << reals[insn->_opcode - I::ADD] << "\t";
+	    cout << operand(insn->_args[1]) << ", %xmm0" << endl;
+	    store(graph, dst, "%xmm0");
+	} else {
+	    mem = source(insn->_args[1], "%ecx");
+	    load(insn->_args[0], "%eax");
+	    cout << "\t" << integers[insn->_opcode - I::ADD] << "\t";
+	    cout << mem << ", %eax" << endl;
+	    store(graph, dst, "%eax");
+	}
+
+	break;
+
+    case I::DIV:
+    case I::REM:
+	if (real) {
+	    loadReal(insn->_args[0], "%xmm0");
+	    cout << "\tdivsd\t" << operand(insn->_args[1]) << ", %xmm0" << endl;
+	    store(graph, dst, "%xmm0");
+	} else {
+	    load(insn->_args[0], "%eax");
+	    load(insn->_args[1], "%ecx");
+	    cout << "\tcltd" << endl;
+	    cout << "\tidivl\t%ecx" << endl;
+	    store(graph, dst, insn->_opcode == I::DIV ? "%eax" : "%edx");
+	}
+
+	break;
+
+    case I::NEG:
+	if (real) {
+	    loadReal(insn->_args[0], "%xmm1");
+	    cout << "\txorpd\t%xmm0, %xmm0" << endl;
+	    cout << "\tsubsd\t%xmm1, %xmm0" << endl;
+	    store(graph, dst, "%xmm0");
+	} else {
+	    load(insn->_args[0], "%eax");
+	    cout << "\tnegl\t%eax" << endl;
+	    store(graph, dst, "%eax");
+	}
+
+	break;
+
+    case I::NOT:
+	testZero(graph, insn->_args[0]);
+	setcc(I::EQ, graph->_reals[insn->_args[0]]);
+	store(graph, dst, "%eax");
+	break;
+
+    case I::LT:
+    case I::GT:
+    case I::LE:
+    case I::GE:
+    case I::EQ:
+    case I::NE:
+	if (following != nullptr && (following->_opcode == I::BRANCH ||
+		following->_opcode == I::SELECT) &&
+		following->_args[0] == dst && uses[dst] == 1) {
+	    fused = insn;
+	    break;
+	}
+
+	compare(graph, insn);
+	setcc(insn->_opcode, graph->_reals[insn->_args[0]]);
+	store(graph, dst, "%eax");
+	break;
+
+    case I::ITOD:
+	load(insn->_args[0], "%eax");
+	cout << "\tcvtsi2sd\t%eax, %xmm0" << endl;
+	store(graph, dst, "%xmm0");
+	break;
+
+    case I::DTOI:
+	loadReal(insn->_args[0], "%xmm0");
+	cout << "\tcvttsd2si\t%xmm0, %eax" << endl;
+	store(graph, dst, "%eax");
+	break;
+
+    case I::TRUNC:
+	load(insn->_args[0], "%eax");
+	cout << "\tmovsbl\t%al, %eax" << endl;
+	store(graph, dst, "%eax");
+	break;
+
+    case I::SELECT:
+	select(graph, insn, fused != nullptr && fused->_dst == insn->_args[0] ? fused : nullptr);
+	fused = nullptr;
+	break;
+
+    case I::VLOAD:
+	mem = memory(insn->_args[0]);
+	cout << "\t" << vmove(graph, dst) << "\t" << mem << ", %xmm0" << endl;
+	cout << "\t" << vmove(graph, dst) << "\t%xmm0, " << operand(dst) << endl;
+	break;
+
+    case I::VSTORE:
+	cout << "\t" << vmove(graph, insn->_args[1]) << "\t";
+	cout << operand(insn->_args[1]) << ", %xmm0" << endl;
+	mem = memory(insn->_args[0]);
+	cout << "\t" << vmove(graph, insn->_args[1]) << "\t%xmm0, " << mem << endl;
+	break;
+
+    case I::VSPLAT:
+	if (real) {
+	    loadReal(insn->_args[0], "%xmm0");
+	    cout << "\tunpcklpd\t%xmm0, %xmm0" << endl;
+	} else {
+	    load(insn->_args[0], "%eax");
+	    cout << "\tmovd\t%eax, %xmm0" << endl;
+	    cout << "\tpshufd\t$0, %xmm0, %xmm0" << endl;
+	}
+
+	cout << "\t" << vmove(graph, dst) << "\t%xmm0, " << operand(dst) << endl;
+	break;
+
+    case I::VADD:
+    case I::VSUB:
+    case I::VMUL:
+    case I::VDIV:
+	cout << "\t" << vmove(graph, dst) << "\t" << operand(insn->_args[0]) << ", %xmm0" << endl;
+	cout << "\t" << vmove(graph, dst) << "\t" << operand(insn->_args[1]) << ", %xmm1" << endl;
+	cout << "\t" << packed[real][insn->_opcode - I::VADD] << "\t%xmm1, %xmm0" << endl;
+	cout << "\t" << vmove(graph, dst) << "\t%xmm0, " << operand(dst) << endl;
+	break;
+
+    case I::CALL:
+	call(graph, insn);
+	break;
+
+    case I::PHI:
+	assert(false && "phi instruction reached the selector");
+	break;
+
+    case I::JUMP:
+	if (insn->_targets[0] != next)
+	    cout << "\tjmp\t" << insn->_targets[0] << endl;
+
+	break;
+
+    case I::BRANCH:
+	if (fused != nullptr && fused->_dst == insn->_args[0]) {
+	    bool freal = graph->_reals[fused->_args[0]];
+
+	    compare(graph, fused);
+
+	    if (freal && (fused->_opcode == I::EQ || fused->_opcode == I::NE))
+		branchUnordered(fused->_opcode == I::EQ, target(insn),
+		    insn->_targets[1], next);
+	    else
+		branch(condition(fused->_opcode, freal, false),
+		    condition(fused->_opcode, freal, true), target(insn),
+		    insn->_targets[1], next);
+
+	} else {
+	    testZero(graph, insn->_args[0]);
+
+	    if (graph->_reals[insn->_args[0]])
+		branchUnordered(false, target(insn), insn->_targets[1], next);
+	    else
+		branch("ne", "e", target(insn), insn->_targets[1], next);
+	}
+
+	fused = nullptr;
+	break;
+
+    case I::SWITCH:
+	load(insn->_args[0], "%eax");
+
+	if (insn->_value != 0)
+	    cout << "\tsubl\t$" << insn->_value << ", %eax" << endl;
+
+	cout << "\tcmpl\t$" << insn->_table.size() - 1 << ", %eax" << endl;
+	cout << "\tja\t" << insn->_targets[0] << endl;
+
+	for (unsigned i = 0; i < insn->_table.size(); i ++)
+	    ss << (i > 0 ? ", " : "") << insn->_table[i];
+
+	cout << "\tjmp\t*" << literal(".long", ss.str()) << "(,%eax,4)" << endl;
+	break;
+
+    case I::RET:
+	if (!insn->_args.empty()) {
+	    if (graph->_reals[insn->_args[0]])
+		cout << "\tfldl\t" << operand(insn->_args[0]) << endl;
+	    else
+		load(insn->_args[0], "%eax");
+	}
+
+	epilogue();
+	break;
+    }
+}
+
+
+/*
+ * Function:	same (private)
+ *
+ * Description:	Return whether two registers are known to hold the same
+ *		address, either by being the same register or by both
+ *		being the address of the same global or variable.
+ */
+
+static bool same(int v1, int v2)
+{
+    const Location &loc1 = locations[v1], &loc2 = locations[v2];
+
+    if (v1 == v2)
+	return true;
+
+    if (loc1._kind != loc2._kind)
+	return false;
+
+    if (loc1._kind == SYMBOLIC)
+	return loc1._text == loc2._text;
+
+    return loc1._kind == FRAME && loc1._offset == loc2._offset;
+}
+
+
+/*
+ * Function:	modify (private)
+ *
+ * Description:	Try to emit the instructions of a block starting with the
+ *		load at the given index as a single read-modify-write of
+ *		memory.  The load must be used only by an add or subtract
+ *		whose result is used only by a store back to the same
+ *		address, with nothing in between that could write memory.
+ *		Any other instructions in between are emitted first.  The
+ *		index of the store is returned, or the given index if the
+ *		instructions cannot be combined.
+ */
+
+static unsigned modify(FlowGraph *graph, BasicBlock *block, unsigned j)
+{
+    I *first = block->_insns[j], *insn, *op = nullptr;
+    string src, mem;
+    unsigned k;
+
+
+    if (first->_opcode != I::LOAD || first->_size != SIZEOF_INT ||
+	    graph->_reals[first->_dst] || uses[first->_dst] != 1)
+	return j;
+
+    for (k = j + 1; k < block->_insns.size(); k ++) {
+	insn = block->_insns[k];
+
+	if (op == nullptr && (insn->_opcode == I::ADD || insn->_opcode == I::SUB)) {
+	    if (insn->_args[0] != first->_dst || insn->_args[1] == first->_dst)
+		return j;
+
+	    if (uses[insn->_dst] != 1 || graph->_reals[insn->_dst])
+		return j;
+
+	    op = insn;
+
+	} else if (insn->_opcode == I::STORE) {
+	    if (op == nullptr || !same(insn->_args[0], first->_args[0]))
+		return j;
+
+	    if (insn->_args[1] != op->_dst || insn->_size != SIZEOF_INT)
+		return j;
+
+	    break;
+
+	} else if (insn->hasSideEffects())
+	    return j;
+    }
+
+    if (k == block->_insns.size())
+	return j;
+
+    for (unsigned i = j + 1; i < k; i ++)
+	if (block->_insns[i] != op)
+	    emit(graph, block->_insns[i], nullptr, nullptr);
+
+    src = source(op->_args[1], "%eax");
+
+    if (src[0] != '$') {
+	load(op->_args[1], "%eax");
+	src = "%eax";
+    }
+
+    mem = memory(first->_args[0]);
+
+    if (src == "$1")
+	cout << (op->_opcode == I::ADD ? "\tincl\t" : "\tdecl\t") << mem << endl;
+    else {
+	cout << (op->_opcode == I::ADD ? "\taddl\t" : "\tsubl\t");
+	cout << src << ", " << mem << endl;
+    }
+
+    return k;
+}
+
+
+/*
+ * Function:	selectInstructions
+ *
+ * Description:	Emit the code for the function represented by the given
+ *		flow graph, including its prologue and epilogues, which are
+ *		the same as those emitted by Function::generate.  Any
+ *		literals go into the pool shared with the generator.
+ */
+
+void selectInstructions(FlowGraph *graph)
+{
+    const string &name = graph->_id->name();
+    BasicBlock *block, *next;
+    I *following;
+    int blocks = 0;
+    unsigned k;
+
+
+    frameSize = layout(graph);
+    depth = 0;
+
+    if (haveProfile())
+	cout << textSection(name) << endl;
+
+    cout << global_prefix << name << ":" << endl;
+
+    if (!omitFramePointer) {
+	cout << "\tpushl\t%ebp" << endl;
+	cout << "\tmovl\t%esp, %ebp" << endl;
+    }
+
+    if (frameSize > 0)
+	cout << "\tsubl\t$" << frameSize << ", %esp" << endl;
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	block = graph->_blocks[i];
+	next = i + 1 < graph->_blocks.size() ? graph->_blocks[i + 1] : nullptr;
+
+	if (block->_align)
+	    cout << "\t.p2align\t4" << endl;
+
+	cout << block << ":" << endl;
+	current = block;
+
+	if (!profileGenerate.empty() && block->_index >= 0) {
+	    increment(counter(name, block->_index, false));
+	    blocks = max(blocks, block->_index + 1);
+	}
+
+	for (unsigned j = 0; j < block->_insns.size(); j ++) {
+	    k = modify(graph, block, j);
+
+	    if (k > j) {
+		j = k;
+		continue;
+	    }
+
+	    following = j + 1 < block->_insns.size() ? block->_insns[j + 1] : nullptr;
+	    emit(graph, block->_insns[j], following, next);
+	}
+    }
+
+    for (unsigned i = 0; i < stubs.size(); i ++) {
+	cout << stubs[i] << ":" << endl;
+	increment(counter(name, stubs[i]->_index, true));
+	cout << "\tjmp\t" << stubs[i]->_insns[0]->_targets[0] << endl;
+	delete stubs[i]->_insns[0];
+	delete stubs[i];
+    }
+
+    stubs.clear();
+
+    if (!profileGenerate.empty())
+	instrumentFunction(name, blocks);
+
+    cout << endl;
+    cout << "\t.globl\t" << global_prefix << name << endl << endl;
+}
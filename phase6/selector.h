@@ -0,0 +1,15 @@
+/*
+ * File:	selector.h
+ *
+ * Description:	This file contains the function declarations for the
+ *		instruction selector, which emits assembly from the
+ *		intermediate representation.
+ */
+
+# ifndef SELECTOR_H
+# define SELECTOR_H
+# include "IR.h"
+
+void selectInstructions(FlowGraph *graph);
+
+# endif /* SELECTOR_H */
@@ -0,0 +1,319 @@
+/*
+ * File:	server.cpp
+ *
+ * Description:	This file contains the function definitions for running
+ *		the compiler as a persistent server, so that a build that
+ *		compiles many small files pays for starting the compiler
+ *		and loading its precompiled declarations only once.
+ *
+ *		The server reads requests from the standard input and
+ *		writes responses to the standard output, or, if given a
+ *		path, accepts connections on a Unix domain socket there
+ *		and serves each in turn until its client closes it.  All
+ *		numbers are 32-bit unsigned integers in little-endian
+ *		order, and a string is its length followed by its bytes.
+ *		A request is the number of options, the options, and the
+ *		source.  A response is the exit status of the compilation,
+ *		the assembly, or the object with -c, and the diagnostics.
+ *
+ *		The compiler keeps its state in globals throughout, and
+ *		exits from wherever it finds an error, so each request is
+ *		compiled in a child forked from the server.  The child
+ *		starts from the state of the server, with its options as
+ *		defaults and its declarations already loaded, and nothing
+ *		the child does can leak into the next request.  Its input
+ *		and outputs are unnamed temporary files, so neither side
+ *		can block the other however large they are.
+ */
+
+# include <string>
+# include <vector>
+# include <cstdio>
+# include <cstdint>
+# include <cstdlib>
+# include <csignal>
+# include <iostream>
+# include <unistd.h>
+# include <sys/un.h>
+# include <sys/wait.h>
+# include <sys/socket.h>
+# include "server.h"
+# include "checker.h"
+# include "options.h"
+
+using namespace std;
+
+# define MAX_STRING (1u << 30)
+
+enum { CLOSED, SERVED, CHILD };
+
+static int listener = -1;
+static string preloaded;
+
+
+/*
+ * Function:	transfer (private)
+ *
+ * Description:	Read or write exactly the given number of bytes, and
+ *		return whether we could.
+ */
+
+static bool transfer(int fd, char *buf, size_t n, bool reading)
+{
+    ssize_t done;
+
+    while (n > 0) {
+	done = reading ? read(fd, buf, n) : write(fd, buf, n);
+
+	if (done <= 0)
+	    return false;
+
+	buf += done;
+	n -= done;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	receive (private)
+ *
+ * Description:	Read a number from a client.
+ */
+
+static bool receive(int fd, uint32_t &word)
+{
+    unsigned char bytes[4];
+
+    if (!transfer(fd, (char *) bytes, 4, true))
+	return false;
+
+    word = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+    return true;
+}
+
+
+/*
+ * Function:	receive (private)
+ *
+ * Description:	Read a string from a client.
+ */
+
+static bool receive(int fd, string &s)
+{
+    uint32_t length;
+
+    if (!receive(fd, length) || length > MAX_STRING)
+	return false;
+
+    s.resize(length);
+    return transfer(fd, &s[0], length, true);
+}
+
+
+/*
+ * Function:	send (private)
+ *
+ * Description:	Write a number to a client.
+ */
+
+static bool send(int fd, uint32_t word)
+{
+    unsigned char bytes[4] = {
+	(unsigned char) word, (unsigned char) (word >> 8),
+	(unsigned char) (word >> 16), (unsigned char) (word >> 24)
+    };
+
+    return transfer(fd, (char *) bytes, 4, false);
+}
+
+
+/*
+ * Function:	send (private)
+ *
+ * Description:	Write a string to a client.
+ */
+
+static bool send(int fd, const string &s)
+{
+    return send(fd, s.size()) && transfer(fd, (char *) s.data(), s.size(), false);
+}
+
+
+/*
+ * Function:	contents (private)
+ *
+ * Description:	Return the contents of a temporary file.
+ */
+
+static string contents(FILE *fp)
+{
+    string result;
+    char buf[65536];
+    size_t n;
+
+
+    rewind(fp);
+
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+	result.append(buf, n);
+
+    return result;
+}
+
+
+/*
+ * Function:	handle (private)
+ *
+ * Description:	Read a request and compile it in a child, then write the
+ *		response.  Return CLOSED once there are no more requests,
+ *		SERVED once a request has been answered, and CHILD in the
+ *		child, whose descriptors and options are set up so that it
+ *		need only compile its standard input as usual.
+ */
+
+static int handle(int in, int out)
+{
+    vector<string> args(1, "scc");
+    vector<char *> argv;
+    FILE *files[3];
+    string source, errors;
+    uint32_t count, status;
+    pid_t pid = -1;
+    int result;
+
+
+    if (!receive(in, count))
+	return CLOSED;
+
+    for (uint32_t i = 0; i < count; i ++) {
+	args.push_back("");
+
+	if (!receive(in, args.back()))
+	    return CLOSED;
+    }
+
+    if (!receive(in, source))
+	return CLOSED;
+
+    for (unsigned i = 0; i < 3; i ++)
+	files[i] = tmpfile();
+
+    if (files[0] && files[1] && files[2])
+	fwrite(source.data(), 1, source.size(), files[0]);
+
+    if (!files[0] || !files[1] || !files[2] || fflush(files[0]) != 0)
+	errors = "scc: cannot create temporary files\n";
+    else if ((pid = fork()) < 0)
+	errors = "scc: cannot fork\n";
+
+    if (pid == 0) {
+	rewind(files[0]);
+
+	for (unsigned i = 0; i < 3; i ++) {
+	    dup2(fileno(files[i]), i);
+	    fclose(files[i]);
+	}
+
+	if (in > 2)
+	    close(in);
+
+	if (out > 2 && out != in)
+	    close(out);
+
+	if (listener >= 0)
+	    close(listener);
+
+	for (unsigned i = 0; i < args.size(); i ++)
+	    argv.push_back(&args[i][0]);
+
+	argv.push_back(nullptr);
+	parseOptions(args.size(), argv.data());
+
+	if (!includePCH.empty() && includePCH != preloaded)
+	    loadDeclarations(includePCH);
+
+	return CHILD;
+    }
+
+    status = EXIT_FAILURE;
+
+    if (pid > 0 && waitpid(pid, &result, 0) == pid) {
+	status = WIFEXITED(result) ? WEXITSTATUS(result) : 128 + WTERMSIG(result);
+	source = contents(files[1]);
+	errors = contents(files[2]);
+    } else
+	source.clear();
+
+    for (unsigned i = 0; i < 3; i ++)
+	if (files[i] != nullptr)
+	    fclose(files[i]);
+
+    if (!send(out, status) || !send(out, source) || !send(out, errors))
+	return CLOSED;
+
+    return SERVED;
+}
+
+
+/*
+ * Function:	serve
+ *
+ * Description:	Serve requests on the standard input and output, or on a
+ *		Unix domain socket if a path is given.  The server itself
+ *		only returns from here in a child, which should go on to
+ *		compile as usual.  Once the standard input is exhausted,
+ *		the server exits.
+ */
+
+void serve(const string &path)
+{
+    struct sockaddr_un address;
+    int connection, result;
+
+
+    signal(SIGPIPE, SIG_IGN);
+    preloaded = includePCH;
+
+    if (path.empty()) {
+	while ((result = handle(0, 1)) == SERVED)
+	    continue;
+
+	if (result == CHILD)
+	    return;
+
+	exit(EXIT_SUCCESS);
+    }
+
+    address.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(address.sun_path)) {
+	cerr << "scc: socket path too long '" << path << "'" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    path.copy(address.sun_path, path.size());
+    address.sun_path[path.size()] = '\0';
+    unlink(path.c_str());
+
+    if ((listener = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+	    bind(listener, (struct sockaddr *) &address, sizeof(address)) < 0 ||
+	    listen(listener, SOMAXCONN) < 0) {
+	cerr << "scc: cannot listen on '" << path << "'" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    while (true) {
+	if ((connection = accept(listener, nullptr, nullptr)) < 0)
+	    continue;
+
+	while ((result = handle(connection, connection)) == SERVED)
+	    continue;
+
+	if (result == CHILD)
+	    return;
+
+	close(connection);
+    }
+}
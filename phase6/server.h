@@ -0,0 +1,14 @@
+/*
+ * File:	server.h
+ *
+ * Description:	This file contains the function declarations for running
+ *		the compiler as a persistent server.
+ */
+
+# ifndef SERVER_H
+# define SERVER_H
+# include <string>
+
+void serve(const std::string &socket);
+
+# endif /* SERVER_H */
@@ -0,0 +1,406 @@
+/*
+ * File:	ssa.cpp
+ *
+ * Description:	This file contains the functions for converting a flow
+ *		graph into and out of static single assignment form.
+ *
+ *		Dominators are computed with the iterative algorithm of
+ *		Cooper, Harvey, and Kennedy, which is simple and fast
+ *		enough for the small graphs we see.  Phi instructions are
+ *		placed at the iterated dominance frontiers of the blocks
+ *		that store to each promotable variable, and the variables
+ *		are then renamed with a walk over the dominator tree.
+ *
+ *		A variable is promotable if its address is never taken.
+ *		Parameters are promoted as well: their incoming value is
+ *		read once at the top of the entry block.
+ */
+
+# include <set>
+# include <map>
+# include <cassert>
+# include "optimizer.h"
+
+using namespace std;
+
+typedef Instruction I;
+
+
+/*
+ * Function:	number (private)
+ *
+ * Description:	Number the blocks reachable from the given block in
+ *		postorder.
+ */
+
+static void number(BasicBlock *block, BasicBlocks &order, set<BasicBlock *> &seen)
+{
+    seen.insert(block);
+
+    for (unsigned i = 0; i < block->_succs.size(); i ++)
+	if (seen.count(block->_succs[i]) == 0)
+	    number(block->_succs[i], order, seen);
+
+    block->_number = order.size();
+    order.push_back(block);
+}
+
+
+/*
+ * Function:	intersect (private)
+ *
+ * Description:	Return the nearest common dominator of two blocks.
+ */
+
+static BasicBlock *intersect(BasicBlock *b1, BasicBlock *b2)
+{
+    while (b1 != b2) {
+	while (b1->_number < b2->_number)
+	    b1 = b1->_idom;
+
+	while (b2->_number < b1->_number)
+	    b2 = b2->_idom;
+    }
+
+    return b1;
+}
+
+
+/*
+ * Function:	computeDominators
+ *
+ * Description:	Compute the immediate dominator of every block.  The
+ *		entry block is its own immediate dominator.  Blocks are
+ *		numbered in postorder as a side effect.
+ */
+
+void computeDominators(FlowGraph *graph)
+{
+    BasicBlocks order;
+    set<BasicBlock *> seen;
+    BasicBlock *entry, *idom;
+    bool changed = true;
+
+
+    graph->connect();
+    entry = graph->entry();
+    number(entry, order, seen);
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++)
+	graph->_blocks[i]->_idom = nullptr;
+
+    entry->_idom = entry;
+
+    while (changed) {
+	changed = false;
+
+	for (int i = order.size() - 1; i >= 0; i --) {
+	    BasicBlock *block = order[i];
+
+	    if (block == entry)
+		continue;
+
+	    idom = nullptr;
+
+	    for (unsigned j = 0; j < block->_preds.size(); j ++)
+		if (block->_preds[j]->_idom != nullptr)
+		    idom = idom ? intersect(block->_preds[j], idom) : block->_preds[j];
+
+	    if (block->_idom != idom) {
+		block->_idom = idom;
+		changed = true;
+	    }
+	}
+    }
+}
+
+
+/*
+ * Function:	frontiers (private)
+ *
+ * Description:	Compute the dominance frontier of every block.
+ */
+
+static void frontiers(FlowGraph *graph, map<BasicBlock *, set<BasicBlock *>> &df)
+{
+    BasicBlock *runner;
+
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	BasicBlock *block = graph->_blocks[i];
+
+	if (block->_preds.size() < 2)
+	    continue;
+
+	for (unsigned j = 0; j < block->_preds.size(); j ++) {
+	    runner = block->_preds[j];
+
+	    while (runner != block->_idom) {
+		df[runner].insert(block);
+		runner = runner->_idom;
+	    }
+	}
+    }
+}
+
+
+/*
+ * Function:	promotable (private)
+ *
+ * Description:	Return whether the given variable can be promoted.
+ */
+
+static bool promotable(FlowGraph *graph, int var)
+{
+    if (var < 0)
+	return false;
+
+    const Variable &v = graph->_vars[var];
+    return !v._addressed && (v._symbol == nullptr || v._symbol->type().isScalar());
+}
+
+
+/* The state used while renaming */
+
+struct Renamer {
+    FlowGraph *graph;
+    set<I *> initial;
+    vector<vector<int>> stacks;
+    map<int, int> replace;
+    map<BasicBlock *, vector<BasicBlock *>> children;
+};
+
+
+/*
+ * Function:	resolve (private)
+ *
+ * Description:	Return the register that now holds the given register's
+ *		value, following any loads that were removed.
+ */
+
+static int resolve(Renamer &r, int reg)
+{
+    while (r.replace.count(reg) > 0)
+	reg = r.replace[reg];
+
+    return reg;
+}
+
+
+/*
+ * Function:	rename (private)
+ *
+ * Description:	Rename the variables in a block and, recursively, in the
+ *		blocks it immediately dominates.  Loads of promoted
+ *		variables are removed and their uses replaced by the
+ *		current definition.  Stores are removed and become the
+ *		current definition.
+ */
+
+static void rename(Renamer &r, BasicBlock *block)
+{
+    vector<int> pushed;
+    Instructions kept;
+
+
+    for (unsigned i = 0; i < block->_insns.size(); i ++) {
+	I *insn = block->_insns[i];
+
+	for (unsigned j = 0; j < insn->_args.size(); j ++)
+	    if (insn->_opcode != I::PHI)
+		insn->_args[j] = resolve(r, insn->_args[j]);
+
+	if (insn->_opcode == I::PHI) {
+	    r.stacks[insn->_var].push_back(insn->_dst);
+	    pushed.push_back(insn->_var);
+
+	} else if (insn->_opcode == I::LOADVAR && promotable(r.graph, insn->_var)
+		&& r.initial.count(insn) == 0) {
+	    r.replace[insn->_dst] = r.stacks[insn->_var].back();
+	    delete insn;
+	    continue;
+
+	} else if (insn->_opcode == I::STOREVAR && promotable(r.graph, insn->_var)) {
+	    r.stacks[insn->_var].push_back(insn->_args[0]);
+	    pushed.push_back(insn->_var);
+	    delete insn;
+	    continue;
+	}
+
+	kept.push_back(insn);
+    }
+
+    block->_insns = kept;
+
+    for (unsigned i = 0; i < block->_succs.size(); i ++) {
+	Instructions &insns = block->_succs[i]->_insns;
+
+	for (unsigned j = 0; j < insns.size() && insns[j]->_opcode == I::PHI; j ++) {
+	    insns[j]->_args.push_back(r.stacks[insns[j]->_var].back());
+	    insns[j]->_sources.push_back(block);
+	}
+    }
+
+    for (unsigned i = 0; i < r.children[block].size(); i ++)
+	rename(r, r.children[block][i]);
+
+    for (unsigned i = 0; i < pushed.size(); i ++)
+	r.stacks[pushed[i]].pop_back();
+}
+
+
+/*
+ * Function:	buildSSA
+ *
+ * Description:	Convert the flow graph into SSA form by promoting every
+ *		promotable variable into virtual registers.
+ */
+
+void buildSSA(FlowGraph *graph)
+{
+    map<BasicBlock *, set<BasicBlock *>> df;
+    vector<set<BasicBlock *>> defs(graph->_vars.size());
+    Instructions entry;
+    Renamer r;
+
+
+    computeDominators(graph);
+    frontiers(graph, df);
+
+
+    /* Find the blocks that store to each variable. */
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	BasicBlock *block = graph->_blocks[i];
+
+	for (unsigned j = 0; j < block->_insns.size(); j ++)
+	    if (block->_insns[j]->_opcode == I::STOREVAR)
+		defs[block->_insns[j]->_var].insert(block);
+    }
+
+
+    /* Place phi instructions at the iterated dominance frontiers. */
+
+    for (unsigned var = 0; var < graph->_vars.size(); var ++) {
+	if (!promotable(graph, var))
+	    continue;
+
+	set<BasicBlock *> placed;
+	BasicBlocks work(defs[var].begin(), defs[var].end());
+
+	while (!work.empty()) {
+	    BasicBlock *block = work.back();
+	    work.pop_back();
+
+	    for (auto frontier : df[block])
+		if (placed.count(frontier) == 0) {
+		    I *phi = new I(I::PHI, graph->newRegister(graph->_vars[var]._real));
+		    phi->_var = var;
+		    frontier->_insns.insert(frontier->_insns.begin(), phi);
+		    placed.insert(frontier);
+		    work.push_back(frontier);
+		}
+	}
+    }
+
+
+    /* Establish the initial definition of each variable.  A parameter
+       is read from its incoming slot and anything else is undefined, so
+       we arbitrarily use zero.  These initial loads must of course
+       survive renaming. */
+
+    r.graph = graph;
+    r.stacks.resize(graph->_vars.size());
+
+    for (unsigned var = 0; var < graph->_vars.size(); var ++) {
+	if (!promotable(graph, var))
+	    continue;
+
+	I *insn;
+
+	if (graph->_vars[var]._param) {
+	    insn = new I(I::LOADVAR, graph->newRegister(graph->_vars[var]._real));
+	    insn->_var = var;
+	} else if (graph->_vars[var]._real) {
+	    insn = new I(I::FCONST, graph->newRegister(true));
+	    insn->_text = "0";
+	} else
+	    insn = new I(I::CONST, graph->newRegister(false));
+
+	r.stacks[var].push_back(insn->_dst);
+	r.initial.insert(insn);
+	entry.push_back(insn);
+    }
+
+    Instructions &insns = graph->entry()->_insns;
+    insns.insert(insns.begin(), entry.begin(), entry.end());
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	BasicBlock *block = graph->_blocks[i];
+
+	if (block != graph->entry())
+	    r.children[block->_idom].push_back(block);
+    }
+
+    rename(r, graph->entry());
+}
+
+
+/*
+ * Function:	destroySSA
+ *
+ * Description:	Convert the flow graph out of SSA form by replacing each
+ *		phi instruction with copies.  Each phi gets its own
+ *		temporary, which is written at the end of every
+ *		predecessor and read at the phi.  Since the temporaries
+ *		are distinct, the phis of a block behave as if executed in
+ *		parallel, and since a temporary is only ever read at its
+ *		phi, writing it along a critical edge is harmless.
+ *
+ *		The copies are placed before any comparison that feeds
+ *		the terminator so that the selector can still fuse the
+ *		comparison with its branch.
+ */
+
+void destroySSA(FlowGraph *graph)
+{
+    map<int, unsigned> uses;
+
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	Instructions &insns = graph->_blocks[i]->_insns;
+
+	for (unsigned j = 0; j < insns.size(); j ++)
+	    for (unsigned k = 0; k < insns[j]->_args.size(); k ++)
+		uses[insns[j]->_args[k]] ++;
+    }
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++) {
+	Instructions &insns = graph->_blocks[i]->_insns;
+
+	for (unsigned j = 0; j < insns.size() && insns[j]->_opcode == I::PHI; j ++) {
+	    I *phi = insns[j];
+	    int temp = graph->newRegister(graph->_reals[phi->_dst]);
+
+	    for (unsigned k = 0; k < phi->_args.size(); k ++) {
+		Instructions &pred = phi->_sources[k]->_insns;
+		Instructions::iterator it = pred.end() - 1;
+
+		if (it != pred.begin() && (*(it - 1))->isCompare() &&
+			(*it)->_args.size() == 1 &&
+			(*it)->_args[0] == (*(it - 1))->_dst &&
+			uses[(*(it - 1))->_dst] == 1)
+		    it --;
+
+		I *copy = new I(I::COPY, temp);
+		copy->_args.push_back(phi->_args[k]);
+		pred.insert(it, copy);
+	    }
+
+	    phi->_opcode = I::COPY;
+	    phi->_args.assign(1, temp);
+	    phi->_sources.clear();
+	    phi->_var = -1;
+	}
+    }
+}
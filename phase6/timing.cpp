@@ -0,0 +1,136 @@
+/*
+ * File:	timing.cpp
+ *
+ * Description:	This file contains the function definitions for timing
+ *		the phases of the compiler and measuring its memory use.
+ *
+ *		Since we generate code for each function as soon as it is
+ *		parsed, the phases interleave, so each phase accumulates
+ *		the time spent in it over the whole compilation.  The peak
+ *		of a phase is the largest resident set size of the process
+ *		at the end of any interval spent in it, so growth shows up
+ *		in the phase responsible.  Nothing is measured unless the
+ *		report was requested.
+ */
+
+# include <map>
+# include <algorithm>
+# include <chrono>
+# include <vector>
+# include <iomanip>
+# include <sys/resource.h>
+# include "timing.h"
+# include "options.h"
+
+using namespace std;
+using namespace std::chrono;
+
+struct PhaseTimes {
+    double _seconds;
+    long _peak;
+};
+
+static map<string, PhaseTimes> phases;
+static vector<string> order;
+static string current;
+static steady_clock::time_point started;
+
+
+/*
+ * Function:	peakSize (private)
+ *
+ * Description:	Return the largest resident set size of the process so
+ *		far, in kilobytes.
+ */
+
+static long peakSize()
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+# ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+# else
+    return usage.ru_maxrss;
+# endif
+}
+
+
+/*
+ * Function:	enterPhase
+ *
+ * Description:	Charge the time since the last call to the current phase,
+ *		make the given phase current, and return the phase that
+ *		was current before, so that the caller may return to it.
+ */
+
+string enterPhase(const string &phase)
+{
+    steady_clock::time_point now;
+    string previous = current;
+
+
+    if (timeReport) {
+	now = steady_clock::now();
+
+	if (!current.empty()) {
+	    if (phases.count(current) == 0)
+		order.push_back(current);
+
+	    PhaseTimes &times = phases[current];
+
+	    times._seconds += duration<double>(now - started).count();
+	    times._peak = max(times._peak, peakSize());
+	}
+
+	started = now;
+    }
+
+    current = phase;
+    return previous;
+}
+
+
+/*
+ * Function:	writeTimings
+ *
+ * Description:	Finish the current phase and write the time and peak size
+ *		of every phase to a stream, followed by the throughput for
+ *		the given numbers of lines and tokens.
+ */
+
+void writeTimings(ostream &ostr, unsigned lines, unsigned tokens)
+{
+    double total = 0;
+    long peak = 0;
+
+
+    enterPhase("");
+
+    for (auto &it : phases) {
+	total += it.second._seconds;
+	peak = max(peak, it.second._peak);
+    }
+
+    ostr << fixed << setprecision(3);
+    ostr << "phase         seconds       %   peak KB" << endl;
+
+    for (unsigned i = 0; i < order.size(); i ++) {
+	PhaseTimes &times = phases[order[i]];
+
+	ostr << left << setw(10) << order[i] << right;
+	ostr << setw(10) << times._seconds;
+	ostr << setw(8) << setprecision(1);
+	ostr << (total > 0 ? 100 * times._seconds / total : 0.0);
+	ostr << setw(10) << times._peak << setprecision(3) << endl;
+    }
+
+    ostr << left << setw(10) << "total" << right << setw(10) << total;
+    ostr << setw(8) << setprecision(1) << 100.0 << setw(10) << peak << endl;
+    ostr << setprecision(0);
+    ostr << setw(10) << lines << " lines " << setw(12);
+    ostr << (total > 0 ? lines / total : 0.0) << " lines/s" << endl;
+    ostr << setw(10) << tokens << " tokens" << setw(12);
+    ostr << (total > 0 ? tokens / total : 0.0) << " tokens/s" << endl;
+}
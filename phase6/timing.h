@@ -0,0 +1,16 @@
+/*
+ * File:	timing.h
+ *
+ * Description:	This file contains the function declarations for timing
+ *		the phases of the compiler and measuring its memory use.
+ */
+
+# ifndef TIMING_H
+# define TIMING_H
+# include <string>
+# include <ostream>
+
+std::string enterPhase(const std::string &phase);
+void writeTimings(std::ostream &ostr, unsigned lines, unsigned tokens);
+
+# endif /* TIMING_H */
@@ -22,6 +22,7 @@ enum {
     UNION, UNSIGNED, VOID, VOLATILE, WHILE,
 
     OR, AND, EQL, NEQ, LEQ, GEQ, INC, DEC, ARROW,
+    ADDEQ, SUBEQ, MULEQ, DIVEQ,
     ID, INTEGER, REAL, STRING, DONE = 0, ERROR = -1
 };
 
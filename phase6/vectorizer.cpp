@@ -0,0 +1,700 @@
+/*
+ * File:	vectorizer.cpp
+ *
+ * Description:	This file contains the loop vectorizer, which rewrites
+ *		simple counted loops over arrays of integers or reals to
+ *		process a whole SSE2 vector of elements per iteration.  The
+ *		pass runs on a flow graph in SSA form.
+ *
+ *		A loop is a candidate if it has the shape produced by a
+ *		while statement whose body is a single basic block:
+ *
+ *		    header:	i = phi [start, preheader], [next, body]
+ *				branch (i < limit), body, exit
+ *		    body:	...
+ *				next = i + 1
+ *				jump header
+ *
+ *		where limit is loop-invariant, every memory access in the
+ *		body is to a[i] for some loop-invariant pointer a, and the
+ *		arithmetic on the loaded elements is supported by SSE2.
+ *		Anything else, such as a call, an access to a variable in
+ *		memory, or an integer multiplication, rejects the loop.
+ *
+ *		The vectorized loop is inserted in front of the original
+ *		loop, which is left untouched and serves as the epilogue
+ *		for the remaining iterations.  Before entering the vector
+ *		loop, we check at run time that no two distinct pointers
+ *		are close enough for the accesses of a single vector
+ *		iteration to overlap, and fall back to the original loop
+ *		if they are.
+ */
+
+# include <set>
+# include <map>
+# include "optimizer.h"
+# include "machine.h"
+
+using namespace std;
+
+typedef Instruction I;
+
+# define VECTOR_SIZE 16
+
+enum { UNKNOWN, INVARIANT, INDUCTION, NEXT, SCALED, ADDRESS, VECTOR };
+
+
+/* A candidate loop and what we know about its registers */
+
+struct Loop {
+    FlowGraph *graph;
+    BasicBlock *preheader, *header, *body, *exit;
+    I *phi;
+    int start, next, limit;
+    unsigned size, stores;
+
+    map<int, I *> defs;
+    map<int, BasicBlock *> blocks;
+    map<int, unsigned> uses;
+    map<int, int> kinds, scales, bases;
+    set<int> accessed, stored;
+
+    map<int, int> hoisted, mapped, splats;
+    BasicBlock *check;
+    int index, step;
+};
+
+
+/*
+ * Function:	kind (private)
+ *
+ * Description:	Return the kind of a register within the loop.  Anything
+ *		defined outside the loop is invariant.
+ */
+
+static int kind(Loop &loop, int v)
+{
+    if (loop.blocks[v] != loop.header && loop.blocks[v] != loop.body)
+	return INVARIANT;
+
+    return loop.kinds.count(v) > 0 ? loop.kinds[v] : UNKNOWN;
+}
+
+
+/*
+ * Function:	constant (private)
+ *
+ * Description:	Return whether a register is an integer constant with the
+ *		given value.
+ */
+
+static bool constant(Loop &loop, int v, long value)
+{
+    I *def = loop.defs[v];
+    return def != nullptr && def->_opcode == I::CONST && def->_value == value;
+}
+
+
+/*
+ * Function:	element (private)
+ *
+ * Description:	Check that an element of the given size and type can be
+ *		vectorized and is the same size as every other element in
+ *		the loop.  Mixing sizes would require a different number
+ *		of lanes.
+ */
+
+static bool element(Loop &loop, unsigned size, bool real)
+{
+    if (size != (real ? SIZEOF_DOUBLE : SIZEOF_INT))
+	return false;
+
+    if (loop.size == 0)
+	loop.size = size;
+
+    return loop.size == size;
+}
+
+
+/*
+ * Function:	arithmetic (private)
+ *
+ * Description:	Classify an arithmetic instruction.  It is invariant if its
+ *		operands are, and a vector if at least one operand is a
+ *		vector and the rest are invariant and will be broadcast.
+ *		Packed integer multiplication and division are not
+ *		available in SSE2.
+ */
+
+static bool arithmetic(Loop &loop, I *insn)
+{
+    bool real = loop.graph->_reals[insn->_dst];
+    bool vector = false;
+    int k;
+
+
+    for (unsigned i = 0; i < insn->_args.size(); i ++) {
+	k = kind(loop, insn->_args[i]);
+
+	if (k == VECTOR)
+	    vector = true;
+	else if (k != INVARIANT)
+	    return false;
+    }
+
+    if (!vector) {
+	if (!real && (insn->_opcode == I::DIV || insn->_opcode == I::REM))
+	    return false;
+
+	loop.kinds[insn->_dst] = INVARIANT;
+	return true;
+    }
+
+    if (insn->_opcode == I::REM || insn->_opcode == I::NEG)
+	return false;
+
+    if (!real && (insn->_opcode == I::MUL || insn->_opcode == I::DIV))
+	return false;
+
+    loop.kinds[insn->_dst] = VECTOR;
+    return element(loop, real ? SIZEOF_DOUBLE : SIZEOF_INT, real);
+}
+
+
+/*
+ * Function:	classify (private)
+ *
+ * Description:	Determine the kind of the register defined by an
+ *		instruction in the body, returning false if the
+ *		instruction prevents vectorization.
+ */
+
+static bool classify(Loop &loop, I *insn)
+{
+    int a = insn->_args.size() > 0 ? insn->_args[0] : -1;
+    int b = insn->_args.size() > 1 ? insn->_args[1] : -1;
+    int ka = a >= 0 ? kind(loop, a) : UNKNOWN;
+    int kb = b >= 0 ? kind(loop, b) : UNKNOWN;
+
+
+    switch (insn->_opcode) {
+    case I::CONST:
+    case I::FCONST:
+    case I::STRING:
+    case I::ADDR:
+    case I::GADDR:
+	loop.kinds[insn->_dst] = INVARIANT;
+	return true;
+
+    case I::MUL:
+	if (ka == INDUCTION)
+	    swap(a, b), swap(ka, kb);
+
+	if (kb == INDUCTION && (constant(loop, a, SIZEOF_INT) ||
+		    constant(loop, a, SIZEOF_DOUBLE))) {
+	    loop.kinds[insn->_dst] = SCALED;
+	    loop.scales[insn->_dst] = loop.defs[a]->_value;
+	    return true;
+	}
+
+	return arithmetic(loop, insn);
+
+    case I::ADD:
+	if (ka == SCALED)
+	    swap(a, b), swap(ka, kb);
+
+	if (ka == INVARIANT && kb == SCALED && !loop.graph->_reals[a]) {
+	    loop.kinds[insn->_dst] = ADDRESS;
+	    loop.scales[insn->_dst] = loop.scales[b];
+	    loop.bases[insn->_dst] = a;
+	    return true;
+	}
+
+	if (ka == INDUCTION)
+	    swap(a, b), swap(ka, kb);
+
+	if (kb == INDUCTION && constant(loop, a, 1)) {
+	    loop.kinds[insn->_dst] = NEXT;
+	    return true;
+	}
+
+	return arithmetic(loop, insn);
+
+    case I::SUB:
+    case I::DIV:
+    case I::REM:
+    case I::NEG:
+	return arithmetic(loop, insn);
+
+    case I::NOT:
+    case I::LT:
+    case I::GT:
+    case I::LE:
+    case I::GE:
+    case I::EQ:
+    case I::NE:
+    case I::ITOD:
+    case I::DTOI:
+    case I::TRUNC:
+    case I::COPY:
+	if (ka != INVARIANT || (b >= 0 && kb != INVARIANT))
+	    return false;
+
+	loop.kinds[insn->_dst] = INVARIANT;
+	return true;
+
+    case I::LOAD:
+	if (ka != ADDRESS || (unsigned) loop.scales[a] != insn->_size)
+	    return false;
+
+	loop.kinds[insn->_dst] = VECTOR;
+	loop.accessed.insert(loop.bases[a]);
+	return element(loop, insn->_size, loop.graph->_reals[insn->_dst]);
+
+    case I::STORE:
+	if (ka != ADDRESS || (unsigned) loop.scales[a] != insn->_size)
+	    return false;
+
+	if (kb != VECTOR && kb != INVARIANT)
+	    return false;
+
+	loop.stores ++;
+	loop.accessed.insert(loop.bases[a]);
+	loop.stored.insert(loop.bases[a]);
+	return element(loop, insn->_size, loop.graph->_reals[b]);
+
+    case I::JUMP:
+	return true;
+
+    default:
+	return false;
+    }
+}
+
+
+/*
+ * Function:	analyze (private)
+ *
+ * Description:	Return whether the loop with the given header is a
+ *		candidate for vectorization, filling in what we know
+ *		about it.
+ */
+
+static bool analyze(Loop &loop, BasicBlock *header)
+{
+    Instructions &insns = header->_insns;
+    I *term = header->terminator(), *cmp;
+    BasicBlock *body;
+
+
+    if (term->_opcode != I::BRANCH || header->_preds.size() != 2)
+	return false;
+
+    body = term->_targets[0];
+
+    if (body == header || body->_preds.size() != 1)
+	return false;
+
+    if (body->terminator()->_opcode != I::JUMP || body->_succs[0] != header)
+	return false;
+
+    loop.header = header;
+    loop.body = body;
+    loop.exit = term->_targets[1];
+    loop.preheader = header->_preds[header->_preds[0] == body ? 1 : 0];
+
+    if (loop.preheader == body || loop.preheader->terminator()->_opcode != I::JUMP)
+	return false;
+
+
+    /* The header may only contain the induction variable, constants,
+       and the comparison against the limit. */
+
+    if (insns.size() < 3 || insns[0]->_opcode != I::PHI)
+	return false;
+
+    loop.phi = insns[0];
+    cmp = insns[insns.size() - 2];
+
+    if (loop.graph->_reals[loop.phi->_dst] || loop.phi->_args.size() != 2)
+	return false;
+
+    for (unsigned i = 1; i < insns.size() - 2; i ++)
+	if (insns[i]->_opcode != I::CONST)
+	    return false;
+	else
+	    loop.kinds[insns[i]->_dst] = INVARIANT;
+
+    loop.kinds[loop.phi->_dst] = INDUCTION;
+
+    if (term->_args[0] != cmp->_dst || loop.uses[cmp->_dst] != 1)
+	return false;
+
+    if (cmp->_opcode == I::LT && cmp->_args[0] == loop.phi->_dst)
+	loop.limit = cmp->_args[1];
+    else if (cmp->_opcode == I::GT && cmp->_args[1] == loop.phi->_dst)
+	loop.limit = cmp->_args[0];
+    else
+	return false;
+
+    if (kind(loop, loop.limit) != INVARIANT)
+	return false;
+
+    for (unsigned i = 0; i < 2; i ++)
+	if (loop.phi->_sources[i] == body)
+	    loop.next = loop.phi->_args[i];
+	else
+	    loop.start = loop.phi->_args[i];
+
+
+    /* Every instruction in the body must be understood, the induction
+       variable must be incremented by one, and something must be
+       stored. */
+
+    for (unsigned i = 0; i < body->_insns.size(); i ++)
+	if (!classify(loop, body->_insns[i]))
+	    return false;
+
+    if (kind(loop, loop.next) != NEXT || loop.uses[loop.next] != 1)
+	return false;
+
+    return loop.stores > 0;
+}
+
+
+/*
+ * Function:	emit (private)
+ *
+ * Description:	Append a new instruction to the end of a block.
+ */
+
+static int emit(Loop &loop, BasicBlock *block, I::Opcode opcode, bool real,
+	int left, int right = -1, unsigned size = 0)
+{
+    I *insn = new I(opcode, loop.graph->newRegister(real));
+
+    if (left >= 0)
+	insn->_args.push_back(left);
+
+    if (right >= 0)
+	insn->_args.push_back(right);
+
+    insn->_size = size;
+    block->_insns.push_back(insn);
+    return insn->_dst;
+}
+
+
+/*
+ * Function:	constant (private)
+ *
+ * Description:	Append an integer constant to the end of a block.
+ */
+
+static int constant(Loop &loop, BasicBlock *block, long value)
+{
+    int v = emit(loop, block, I::CONST, false, -1);
+
+    block->_insns.back()->_value = value;
+    return v;
+}
+
+
+/*
+ * Function:	value (private)
+ *
+ * Description:	Return the register to use in the vector loop in place of
+ *		the given register from the original loop.
+ */
+
+static int value(Loop &loop, int v)
+{
+    if (v == loop.phi->_dst)
+	return loop.index;
+
+    if (loop.hoisted.count(v) > 0)
+	return loop.hoisted[v];
+
+    if (loop.mapped.count(v) > 0)
+	return loop.mapped[v];
+
+    return v;
+}
+
+
+/*
+ * Function:	broadcast (private)
+ *
+ * Description:	Return a vector register for an operand, broadcasting an
+ *		invariant operand into every lane before entering the
+ *		loop.
+ */
+
+static int broadcast(Loop &loop, int v)
+{
+    if (kind(loop, v) == VECTOR)
+	return loop.mapped[v];
+
+    if (loop.splats.count(v) == 0) {
+	bool real = loop.graph->_reals[v];
+	loop.splats[v] = emit(loop, loop.check, I::VSPLAT, real, value(loop, v), -1, loop.size);
+    }
+
+    return loop.splats[v];
+}
+
+
+/*
+ * Function:	disjoint (private)
+ *
+ * Description:	Return whether two pointers are known without checking
+ *		never to cause a dependence between lanes: either they are
+ *		the addresses of two variables, which are either the same
+ *		or distinct, or they are the same register.
+ */
+
+static bool disjoint(Loop &loop, int p, int q)
+{
+    I *dp = loop.defs[p], *dq = loop.defs[q];
+
+    if (p == q)
+	return true;
+
+    if (dp == nullptr || dq == nullptr || dp->_opcode != dq->_opcode)
+	return false;
+
+    return dp->_opcode == I::GADDR || dp->_opcode == I::ADDR;
+}
+
+
+/*
+ * Function:	transform (private)
+ *
+ * Description:	Insert the vector loop in front of the given loop.  The
+ *		check block computes the vector limit and tests for
+ *		overlapping pointers; the vector header and body mirror
+ *		the original ones but step by a whole vector.
+ */
+
+static void transform(Loop &loop)
+{
+    FlowGraph *graph = loop.graph;
+    BasicBlock *check, *header, *body;
+    int lanes, limit, hazard, d, k;
+    I *phi, *term;
+    set<int> seen;
+
+
+    check = loop.check = new BasicBlock();
+    header = new BasicBlock();
+    body = new BasicBlock();
+    lanes = VECTOR_SIZE / loop.size;
+
+
+    /* Hoist the invariant computations of the loop into the check block,
+       so they are available to both the check and the vector body. */
+
+    for (unsigned i = 0; i < loop.header->_insns.size(); i ++) {
+	I *insn = loop.header->_insns[i];
+
+	if (insn->_opcode == I::CONST)
+	    loop.hoisted[insn->_dst] = constant(loop, check, insn->_value);
+    }
+
+    for (unsigned i = 0; i < loop.body->_insns.size(); i ++) {
+	I *insn = loop.body->_insns[i];
+
+	if (insn->_dst >= 0 && kind(loop, insn->_dst) == INVARIANT) {
+	    I *copy = new I(*insn);
+
+	    copy->_dst = graph->newRegister(graph->_reals[insn->_dst]);
+
+	    for (unsigned j = 0; j < copy->_args.size(); j ++)
+		copy->_args[j] = value(loop, copy->_args[j]);
+
+	    check->_insns.push_back(copy);
+	    loop.hoisted[insn->_dst] = copy->_dst;
+	    loop.defs[copy->_dst] = copy;
+	}
+    }
+
+    loop.step = constant(loop, check, lanes);
+    limit = emit(loop, check, I::SUB, false, value(loop, loop.limit),
+	constant(loop, check, lanes - 1));
+
+
+    /* The accesses of one vector iteration overlap only if two pointers
+       differ by less than a whole vector.  Pointers that are equal are
+       fine, since each lane then touches the same element. */
+
+    hazard = constant(loop, check, 0);
+
+    for (auto p : loop.stored) {
+	seen.insert(p);
+
+	for (auto q : loop.accessed) {
+	    if (seen.count(q) > 0 && loop.stored.count(q) > 0)
+		continue;
+
+	    if (disjoint(loop, value(loop, p), value(loop, q)))
+		continue;
+
+	    d = emit(loop, check, I::SUB, false, value(loop, p), value(loop, q));
+	    k = emit(loop, check, I::LT, false, d, constant(loop, check, VECTOR_SIZE));
+	    k = emit(loop, check, I::MUL, false, k,
+		emit(loop, check, I::GT, false, d, constant(loop, check, -VECTOR_SIZE)));
+	    k = emit(loop, check, I::MUL, false, k,
+		emit(loop, check, I::NE, false, d, constant(loop, check, 0)));
+	    hazard = emit(loop, check, I::ADD, false, hazard, k);
+	}
+    }
+
+
+    /* The vector header has its own induction variable. */
+
+    phi = new I(I::PHI, graph->newRegister(false));
+    header->_insns.push_back(phi);
+    loop.index = phi->_dst;
+
+    term = new I(I::BRANCH);
+    term->_args.push_back(emit(loop, header, I::LT, false, loop.index, limit));
+    term->_targets[0] = body;
+    term->_targets[1] = loop.header;
+    header->_insns.push_back(term);
+
+
+    /* The vector body performs the same operations on whole vectors.
+       Any invariant operands are broadcast in the check block. */
+
+    for (unsigned i = 0; i < loop.body->_insns.size(); i ++) {
+	I *insn = loop.body->_insns[i];
+	int v = insn->_dst;
+
+	switch (insn->_opcode) {
+	case I::LOAD:
+	    loop.mapped[v] = emit(loop, body, I::VLOAD, graph->_reals[v],
+		value(loop, insn->_args[0]), -1, loop.size);
+	    break;
+
+	case I::STORE:
+	    d = broadcast(loop, insn->_args[1]);
+	    emit(loop, body, I::VSTORE, false, value(loop, insn->_args[0]), d, loop.size);
+	    body->_insns.back()->_dst = -1;
+	    break;
+
+	case I::JUMP:
+	    term = new I(I::JUMP);
+	    term->_targets[0] = header;
+	    body->_insns.push_back(term);
+	    break;
+
+	default:
+	    k = kind(loop, v);
+
+	    if (k == VECTOR) {
+		d = broadcast(loop, insn->_args[0]);
+		loop.mapped[v] = emit(loop, body,
+		    (I::Opcode) (I::VADD + insn->_opcode - I::ADD),
+		    graph->_reals[v], d, broadcast(loop, insn->_args[1]), loop.size);
+
+	    } else if (k == NEXT) {
+		loop.mapped[v] = emit(loop, body, I::ADD, false, loop.index, loop.step);
+
+	    } else if (k == SCALED || k == ADDRESS) {
+		I *copy = new I(*insn);
+
+		copy->_dst = graph->newRegister(false);
+
+		for (unsigned j = 0; j < copy->_args.size(); j ++)
+		    copy->_args[j] = value(loop, copy->_args[j]);
+
+		body->_insns.push_back(copy);
+		loop.mapped[v] = copy->_dst;
+	    }
+
+	    break;
+	}
+    }
+
+    term = new I(I::BRANCH);
+    term->_args.push_back(hazard);
+    term->_targets[0] = loop.header;
+    term->_targets[1] = header;
+    check->_insns.push_back(term);
+
+    phi->_args.push_back(value(loop, loop.start));
+    phi->_sources.push_back(check);
+    phi->_args.push_back(loop.mapped[loop.next]);
+    phi->_sources.push_back(body);
+
+
+    /* Finally, link everything together.  The original loop is now
+       entered from both the check block and the vector header. */
+
+    loop.preheader->terminator()->_targets[0] = check;
+
+    for (unsigned i = 0; i < 2; i ++)
+	if (loop.phi->_sources[i] == loop.preheader)
+	    loop.phi->_sources[i] = check;
+
+    loop.phi->_args.push_back(loop.index);
+    loop.phi->_sources.push_back(header);
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++)
+	if (graph->_blocks[i] == loop.header) {
+	    graph->_blocks.insert(graph->_blocks.begin() + i, {check, header, body});
+	    break;
+	}
+
+    graph->connect();
+}
+
+
+/*
+ * Function:	vectorizeLoops
+ *
+ * Description:	Vectorize every candidate loop in the flow graph.
+ */
+
+void vectorizeLoops(FlowGraph *graph)
+{
+    BasicBlocks headers;
+    unsigned count = 0;
+
+
+    graph->connect();
+
+    for (unsigned i = 0; i < graph->_blocks.size(); i ++)
+	if (graph->_blocks[i]->terminator()->_opcode == I::BRANCH)
+	    headers.push_back(graph->_blocks[i]);
+
+    for (unsigned i = 0; i < headers.size(); i ++) {
+	Loop loop;
+
+	loop.graph = graph;
+	loop.size = loop.stores = 0;
+
+	for (unsigned j = 0; j < graph->_blocks.size(); j ++) {
+	    BasicBlock *block = graph->_blocks[j];
+
+	    for (unsigned k = 0; k < block->_insns.size(); k ++) {
+		I *insn = block->_insns[k];
+
+		for (unsigned l = 0; l < insn->_args.size(); l ++)
+		    loop.uses[insn->_args[l]] ++;
+
+		if (insn->_dst >= 0) {
+		    loop.defs[insn->_dst] = insn;
+		    loop.blocks[insn->_dst] = block;
+		}
+	    }
+	}
+
+	if (analyze(loop, headers[i])) {
+	    transform(loop);
+	    count ++;
+	}
+    }
+
+    addStatistic("vectorize", "loops vectorized", count);
+}
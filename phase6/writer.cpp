@@ -161,6 +161,16 @@ void LogicalOr::write(ostream &ostr) const
     ostr << "(|| " << _left << " " << _right << ")";
 }
 
+void Placeholder::write(ostream &ostr) const
+{
+    ostr << "old";
+}
+
+void Update::write(ostream &ostr) const
+{
+    ostr << (_postfix ? "(post " : "(pre ") << _left << " " << _expr << ")";
+}
+
 void Assignment::write(ostream &ostr) const
 {
     ostr << "(= " << _left << " " << _right << ")";
@@ -196,6 +206,24 @@ void If::write(ostream &ostr) const
     ostr << ")";
 }
 
+void Switch::write(ostream &ostr) const
+{
+    ostr << "(switch " << _expr << " " << _stmt << ")";
+}
+
+void Case::write(ostream &ostr) const
+{
+    if (_default)
+	ostr << "(default)";
+    else
+	ostr << "(case " << _value << ")";
+}
+
+void Break::write(ostream &ostr) const
+{
+    ostr << "(break)";
+}
+
 void Function::write(ostream &ostr) const
 {
     unsigned num = _id->type().parameters()->size();